@@ -65,6 +65,7 @@
 #include "sgx_urts.h"
 #include "App.h"
 #include "Enclave_u.h"
+#include "PeerEnclave_u.h"
 
 
 #include <unistd.h>
@@ -76,14 +77,48 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
 #include "../include/common.h"
+#include "../include/hot_calls_mux.h"
+#include "SharedMemory.h"
+#include "TransitionEmulation.h"
+#include "MeasurementStore.h"
+#include "ClockPublisher.h"
+#include "YcsbWorkload.h"
+#include "GcmCipher.h"
+#include "PerfCounters.h"
+#include "../include/hot_calls_sealed.h"
+#include "../include/hot_stream.h"
+#include "HotCallTrace.h"
+#include "OpenLoop.h"
+#include "SharedChannels.h"
+#include "CrossProcess.h"
+#include "RealtimeIsolation.h"
+#include <sys/syscall.h>
+
+#ifndef HOTCALLS_SGX_MODE
+#define HOTCALLS_SGX_MODE "unknown"
+#endif
+
+#ifndef HOTCALLS_BUILD_FLAGS
+#define HOTCALLS_BUILD_FLAGS "unknown"
+#endif
 
 sgx_enclave_id_t globalEnclaveID;
+sgx_enclave_id_t globalPeerEnclaveID;
+volatile pid_t   globalResponderTid;     //Kernel thread ID of the latest EnclaveResponderThread
 
 typedef sgx_status_t (*EcallFunction)(sgx_enclave_id_t, void* );
 
 #define PERFORMANCE_MEASUREMENT_NUM_REPEATS 10000
 #define MEASUREMENTS_ROOT_DIR               "measurments"
+#define RESPONDER_START_TIMEOUT_MS          1000
+#define STARTUP_READY_TIMEOUT_MS            10000
 
 using namespace std;
 
@@ -91,7 +126,8 @@ inline __attribute__((always_inline))  uint64_t rdtscp(void)
 {
         unsigned int low, high;
 
-        asm volatile("rdtscp" : "=a" (low), "=d" (high));
+        //RDTSCP also writes IA32_TSC_AUX into ecx
+        asm volatile("rdtscp" : "=a" (low), "=d" (high) : : "rcx");
 
         return low | ((uint64_t)high) << 32;
 }
@@ -214,12 +250,13 @@ void* EnclaveResponderThread( void* hotEcallAsVoidP )
 {
     //To be started in a new thread
     HotCall *hotEcall = (HotCall*)hotEcallAsVoidP;
+    globalResponderTid = syscall( SYS_gettid );
     EcallStartResponder( globalEnclaveID, hotEcall );
 
     return NULL;
 }
 
-void MyCustomOcall( void* data )
+void MeasureOcallRoundTrip( void* data )
 {
     //Because RDTSCP is not allowed inside an enclave in SGX 1.x, we have to issue it here,
     //in the ocall. Therefore, instead of measuring enclave-->ocall-->enclave, we will measure 
@@ -227,79 +264,2135 @@ void MyCustomOcall( void* data )
     
     static uint64_t startTime     = 0;  
 
-    OcallParams* ocallParams = (OcallParams*)data;
+    OcallParams* ocallParams = (OcallParams*)data;
+
+    *(ocallParams->cyclesCount)  = rdtscp() - startTime; //startTime was set in previous iteration (except when first called)
+    ocallParams->counter++;
+
+    startTime     = rdtscp(); //for next iteration
+}
+
+void MyCustomOcall( void* data )
+{
+    //SDK ocall entry. The emulated EEXIT lands in the current sample and the emulated
+    //EENTER in the next one, matching ocall-->enclave-->next_ocall
+    TransitionEmulation_exit();
+    MeasureOcallRoundTrip( data );
+    TransitionEmulation_enter();
+}
+
+void* OcallResponderThread( void* hotCallAsVoidP )
+{
+    void (*callbacks[1])(void*);
+    callbacks[0] = MeasureOcallRoundTrip;
+
+    HotCallTable callTable;
+    callTable.numEntries = 1;
+    callTable.callbacks  = callbacks;
+
+    HotCall_waitForCall( (HotCall *)hotCallAsVoidP, &callTable );
+
+    return NULL;
+}
+
+void OcallRelayToPeer( PeerMessage* message )
+{
+    //Relay path between the enclaves: the main enclave exits, the app enters the peer enclave
+    //with an SDK ecall, then resumes the main enclave
+    TransitionEmulation_exit();
+    TransitionEmulation_enter();
+    EcallPeerHandleMessage( globalPeerEnclaveID, message );
+    TransitionEmulation_exit();
+    TransitionEmulation_enter();
+}
+
+void* PeerEnclaveResponderThread( void* peerChannelAsVoidP )
+{
+    //To be started in a new thread
+    HotCall *peerChannel = (HotCall*)peerChannelAsVoidP;
+    EcallStartPeerResponder( globalPeerEnclaveID, peerChannel );
+
+    return NULL;
+}
+
+void* EnclaveLaneResponderThread( void* channelAsVoidP )
+{
+    //To be started in a new thread
+    HotLaneChannel *channel = (HotLaneChannel*)channelAsVoidP;
+    EcallStartLaneResponder( globalEnclaveID, channel );
+
+    return NULL;
+}
+
+typedef struct {
+    HotLaneChannel* channel;
+    uint16_t        lane;
+    BulkCallParams  params;
+    volatile bool*  keepRunning;
+} BulkCallerArgs;
+
+void* BulkCallerThread( void* argsAsVoidP )
+{
+    //Keeps its lane saturated until told to stop
+    BulkCallerArgs *args = (BulkCallerArgs*)argsAsVoidP;
+    while( *args->keepRunning ) {
+        HotLaneChannel_requestCall( args->channel, args->lane, LANE_BULK_CALL_ID, &args->params );
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    HotCall*    hotCall;
+    uint64_t    arenaSize;
+} ArenaResponderArgs;
+
+void* EnclaveArenaResponderThread( void* argsAsVoidP )
+{
+    //To be started in a new thread
+    ArenaResponderArgs *args = (ArenaResponderArgs*)argsAsVoidP;
+    EcallStartArenaResponder( globalEnclaveID, args->hotCall, args->arenaSize );
+
+    return NULL;
+}
+
+typedef struct {
+    HotCall*                hotCall;
+    uint16_t                callID;
+    AllocationWorkParams    params;
+    uint64_t*               measurements;
+    uint64_t                numMeasurements;
+} AllocationCallerArgs;
+
+void* AllocationCallerThread( void* argsAsVoidP )
+{
+    AllocationCallerArgs *args = (AllocationCallerArgs*)argsAsVoidP;
+    for( uint64_t i = 0; i < args->numMeasurements; ++i ) {
+        uint64_t startTime = rdtscp();
+        HotCall_requestCall( args->hotCall, args->callID, &args->params );
+        uint64_t endTime   = rdtscp();
+
+        args->measurements[ i ] = endTime - startTime;
+    }
+
+    return NULL;
+}
+
+typedef void (*SpinlockFunction)( void* lock, HotSpinNode* node );
+
+typedef struct {
+    const char*         name;
+    void*               lock;
+    SpinlockFunction    acquire;
+    SpinlockFunction    release;
+} SpinlockUnderTest;
+
+static void AcquireTTAS( void* lock, HotSpinNode* node )    { HotSpinTTAS_lock( (HotSpinTTAS*)lock, node ); }
+static void ReleaseTTAS( void* lock, HotSpinNode* node )    { HotSpinTTAS_unlock( (HotSpinTTAS*)lock, node ); }
+static void AcquireTicket( void* lock, HotSpinNode* node )  { HotSpinTicket_lock( (HotSpinTicket*)lock, node ); }
+static void ReleaseTicket( void* lock, HotSpinNode* node )  { HotSpinTicket_unlock( (HotSpinTicket*)lock, node ); }
+static void AcquireMCS( void* lock, HotSpinNode* node )     { HotSpinMCS_lock( (HotSpinMCS*)lock, node ); }
+static void ReleaseMCS( void* lock, HotSpinNode* node )     { HotSpinMCS_unlock( (HotSpinMCS*)lock, node ); }
+
+#define SPINLOCK_MAX_SAMPLES_PER_THREAD 100000
+
+typedef struct {
+    SpinlockUnderTest*  spinlock;
+    volatile bool*      start;
+    volatile bool*      stop;
+    uint64_t            criticalSectionPauses;
+    uint64_t            numAcquisitions;
+    vector<uint64_t>    acquireLatencies;
+} SpinlockContenderArgs;
+
+void* SpinlockContenderThread( void* argsAsVoidP )
+{
+    SpinlockContenderArgs *args = (SpinlockContenderArgs*)argsAsVoidP;
+    HotSpinNode            node;
+
+    args->acquireLatencies.reserve( SPINLOCK_MAX_SAMPLES_PER_THREAD );
+    while( ! *args->start )
+        _mm_pause();
+
+    while( ! *args->stop ) {
+        uint64_t startTime = rdtscp();
+        args->spinlock->acquire( args->spinlock->lock, &node );
+        uint64_t endTime   = rdtscp();
+
+        for( uint64_t i = 0; i < args->criticalSectionPauses; ++i )
+            _mm_pause();
+        args->spinlock->release( args->spinlock->lock, &node );
+
+        args->numAcquisitions++;
+        if( args->acquireLatencies.size() < SPINLOCK_MAX_SAMPLES_PER_THREAD )
+            args->acquireLatencies.push_back( endTime - startTime );
+
+        _mm_pause();
+    }
+
+    return NULL;
+}
+
+void* EnclaveMuxResponderThread( void* muxAsVoidP )
+{
+    //To be started in a new thread
+    HotCallMux *mux = (HotCallMux*)muxAsVoidP;
+    EcallStartMuxResponder( globalEnclaveID, mux );
+
+    return NULL;
+}
+
+typedef struct {
+    HotCallMux*         mux;            //NULL when the channel has its own responder
+    HotCall*            hotCall;
+    volatile bool*      start;
+    int                 data;
+    uint64_t            numErrors;
+    uint64_t*           measurements;
+    uint64_t            numMeasurements;
+} ChannelCallerArgs;
+
+void* ChannelCallerThread( void* argsAsVoidP )
+{
+    ChannelCallerArgs *args = (ChannelCallerArgs*)argsAsVoidP;
+
+    //Channels join the multiplexed responder while it is already running
+    int slot = -1;
+    if( args->mux != NULL )
+        slot = HotCallMux_addChannel( args->mux, args->hotCall );
+
+    while( ! *args->start )
+        _mm_pause();
+
+    int expectedData = 0;
+    for( uint64_t i = 0; i < args->numMeasurements; ++i ) {
+        uint64_t startTime = rdtscp();
+        if( args->mux != NULL )
+            HotCallMux_requestCall( args->mux, slot, 0, &args->data );
+        else
+            HotCall_requestCall( args->hotCall, 0, &args->data );
+        uint64_t endTime   = rdtscp();
+
+        args->measurements[ i ] = endTime - startTime;
+
+        expectedData++;
+        if( args->data != expectedData )
+            args->numErrors++;
+    }
+
+    if( args->mux != NULL )
+        HotCallMux_removeChannel( args->mux, slot );
+
+    return NULL;
+}
+
+void* EnclaveKvResponderThread( void* hotEcallAsVoidP )
+{
+    //To be started in a new thread
+    HotCall *hotEcall = (HotCall*)hotEcallAsVoidP;
+    EcallStartKvResponder( globalEnclaveID, hotEcall );
+
+    return NULL;
+}
+
+typedef struct {
+    HotCall*            hotCall;        //NULL for SDK ecalls
+    YcsbGenerator       generator;
+    uint32_t            valueSize;
+    volatile bool*      start;
+    uint64_t*           measurements;
+    uint64_t            numOperations;
+    uint64_t            numErrors;
+    uint64_t            numNotFound;    //latest keys whose insert had not finished yet
+} KvClientArgs;
+
+void* KvClientThread( void* argsAsVoidP )
+{
+    KvClientArgs    *args = (KvClientArgs*)argsAsVoidP;
+    vector<uint8_t> value( args->valueSize, 0 );
+    KvRequest       request;
+    request.value = &value[ 0 ];
+
+    while( ! *args->start )
+        _mm_pause();
+
+    for( uint64_t i = 0; i < args->numOperations; ++i ) {
+        YcsbGenerator_next( &args->generator, &request );
+        if( request.op == KV_OP_UPDATE || request.op == KV_OP_INSERT )
+            KvValue_fill( request.value, args->valueSize, request.key );
+
+        uint64_t startTime = rdtscp();
+        if( args->hotCall != NULL )
+            HotCall_requestCall( args->hotCall, 0, &request );
+        else {
+            TransitionEmulation_enter();
+            EcallKvExecute( globalEnclaveID, &request );
+            TransitionEmulation_exit();
+        }
+        uint64_t endTime   = rdtscp();
+
+        args->measurements[ i ] = endTime - startTime;
+
+        if( request.status == KV_STATUS_NOT_FOUND && request.key >= args->generator.recordCount )
+            args->numNotFound++;
+        else if( request.status != KV_STATUS_OK )
+            args->numErrors++;
+        else if( ( request.op == KV_OP_READ || request.op == KV_OP_READ_MODIFY_WRITE ) &&
+                 ! KvValue_check( request.value, args->valueSize, request.key ) )
+            args->numErrors++;
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    HotCall*    hotCall;
+    uint8_t     key[ HOTCALL_SEALED_KEY_SIZE ];
+    uint32_t    channelID;
+    uint64_t    maxPayloadSize;
+} SealedResponderArgs;
+
+void* EnclaveSealedResponderThread( void* argsAsVoidP )
+{
+    //To be started in a new thread
+    SealedResponderArgs *args = (SealedResponderArgs*)argsAsVoidP;
+    EcallStartSealedResponder( globalEnclaveID, args->hotCall, args->key, args->channelID, args->maxPayloadSize );
+
+    return NULL;
+}
+
+//Caller side of a sealed channel: seals plaintext into batch->payload under the next sequence
+void SealPayloadBatch( const GcmKey* gcmKey, HotSealedSession* session, HotSealedBatch* batch, const uint8_t* plaintext )
+{
+    uint8_t iv[ HOTCALL_SEALED_IV_SIZE ];
+    uint8_t aad[ HOTCALL_SEALED_AAD_SIZE ];
+
+    batch->sequence = ++session->sequence;
+    batch->status   = HOTCALL_SEALED_OK;
+    HotSealed_makeIv( iv, session->channelID, HOTCALL_SEALED_REQUEST, batch->sequence );
+    HotSealed_makeAad( aad, batch );
+    GcmCipher_encrypt( gcmKey, iv, aad, sizeof( aad ), plaintext, (size_t)batch->numSlots * batch->slotSize,
+                       batch->payload, batch->mac );
+}
+
+//Opens the responder's reply to the last batch sealed with SealPayloadBatch
+bool OpenPayloadReply( const GcmKey* gcmKey, const HotSealedSession* session, const HotSealedBatch* batch, uint8_t* plaintext )
+{
+    uint8_t iv[ HOTCALL_SEALED_IV_SIZE ];
+    uint8_t aad[ HOTCALL_SEALED_AAD_SIZE ];
+
+    if( batch->status != HOTCALL_SEALED_OK )
+        return false;
+
+    HotSealed_makeIv( iv, session->channelID, HOTCALL_SEALED_RESPONSE, batch->sequence );
+    HotSealed_makeAad( aad, batch );
+    return GcmCipher_decrypt( gcmKey, iv, aad, sizeof( aad ), batch->payload, (size_t)batch->numSlots * batch->slotSize,
+                              plaintext, batch->mac );
+}
+
+typedef struct {
+    HotStream*  stream;
+    uint64_t    numBytes;       //produced by EcallProduceStream
+    uint64_t    checksum;       //returned by EcallConsumeStream
+    sgx_status_t status;
+} EnclaveStreamArgs;
+
+void* EnclaveStreamConsumerThread( void* argsAsVoidP )
+{
+    //To be started in a new thread. If the ecall fails the stream is aborted here, so the
+    //producer does not wait for a consumer that never came.
+    EnclaveStreamArgs *args = (EnclaveStreamArgs*)argsAsVoidP;
+    args->status = EcallConsumeStream( globalEnclaveID, &args->checksum, args->stream );
+    if( args->status != SGX_SUCCESS ) {
+        HotStreamEnd consumer;
+        consumer.stream = args->stream;
+        HotStream_abort( &consumer );
+    }
+
+    return NULL;
+}
+
+void* EnclaveStreamProducerThread( void* argsAsVoidP )
+{
+    //To be started in a new thread
+    EnclaveStreamArgs *args = (EnclaveStreamArgs*)argsAsVoidP;
+    EcallProduceStream( globalEnclaveID, args->stream, args->numBytes );
+
+    return NULL;
+}
+
+//Phases of starting an enclave with its responders, see HotCallsTester::StartEnclave
+enum StartupPhase {
+    STARTUP_PHASE_CREATE,       //token I/O and sgx_create_enclave
+    STARTUP_PHASE_CHANNELS,     //allocating (and pre-faulting) the channels
+    STARTUP_PHASE_SPAWN,        //creating (and pinning) the responder threads
+    STARTUP_PHASE_READY,        //until every responder pre-faulted its heap share and serves
+    STARTUP_PHASE_WARMUP,       //warmup calls on every channel
+    STARTUP_PHASE_TOTAL,        //from the start until ready for traffic
+    STARTUP_PHASE_FIRST_CALL,   //latency of the first call after that
+    STARTUP_NUM_PHASES
+};
+
+static const char* STARTUP_PHASE_NAMES[ STARTUP_NUM_PHASES ] = {
+    "create", "channels", "spawn", "ready", "warmup", "total", "first_call"
+};
+
+typedef struct {
+    uint32_t    numResponders;
+    uint64_t    heapPrefaultBytes;  //per responder
+    uint64_t    numWarmupCalls;     //per channel
+    bool        fast;               //overlap, pin and pre-fault; otherwise the lazy order of the tests
+} StartupConfig;
+
+struct EnclaveStartup;
+
+typedef struct {
+    EnclaveStartup*     startup;
+    uint32_t            index;
+    int                 cpu;        //-1 if not pinned
+    bool                spawned;    //the thread exists and must be joined
+    uint64_t            ready;      //set by the enclave once the responder serves
+    int                 exited;     //set once the thread is done with the enclave, or never entered it
+} StartupResponderArgs;
+
+struct EnclaveStartup {
+    StartupConfig                   config;
+    sgx_enclave_id_t                enclaveID;
+    int                             enclaveStatus;      //0 while creating, 1 created, -1 failed
+    SharedMemoryArena               channelArena;
+    bool                            arenaAllocated;
+    vector<HotCall>                 heapChannels;
+    vector<HotCall*>                channels;
+    vector<int>                     data;
+    vector<pthread_t>               responderThreads;
+    vector<StartupResponderArgs>    responderArgs;
+    uint64_t                        phaseCycles[ STARTUP_NUM_PHASES ];
+};
+
+void AllocateStartupChannels( EnclaveStartup* startup )
+{
+    //Fast startup puts the channels in pre-faulted shared memory, otherwise on the heap
+    const uint32_t numChannels = startup->config.numResponders;
+    startup->arenaAllocated = startup->config.fast &&
+                              SharedMemoryArena_init( &startup->channelArena, numChannels * sizeof( HotCall ) +
+                                                      SHARED_MEMORY_CACHE_LINE_SIZE, SHARED_MEMORY_ANY_NODE );
+    if( ! startup->arenaAllocated )
+        startup->heapChannels.resize( numChannels );
+
+    startup->channels.resize( numChannels );
+    startup->data.assign( numChannels, 0 );
+    for( uint32_t c = 0; c < numChannels; ++c ) {
+        if( startup->arenaAllocated )
+            startup->channels[ c ] = (HotCall*)SharedMemoryArena_alloc( &startup->channelArena, sizeof( HotCall ) );
+        else
+            startup->channels[ c ] = &startup->heapChannels[ c ];
+        HotCall_init( startup->channels[ c ] );
+    }
+}
+
+void* StartupChannelsThread( void* startupAsVoidP )
+{
+    EnclaveStartup *startup = (EnclaveStartup*)startupAsVoidP;
+
+    uint64_t startTime = rdtscp();
+    AllocateStartupChannels( startup );
+    startup->phaseCycles[ STARTUP_PHASE_CHANNELS ] = rdtscp() - startTime;
+
+    return NULL;
+}
+
+void* StartupResponderThread( void* argsAsVoidP )
+{
+    //May be spawned before the enclave and the channels exist; enters as soon as they do
+    StartupResponderArgs *args    = (StartupResponderArgs*)argsAsVoidP;
+    EnclaveStartup       *startup = args->startup;
+    int enclaveStatus;
+    while( ( enclaveStatus = __atomic_load_n( &startup->enclaveStatus, __ATOMIC_ACQUIRE ) ) == 0 )
+        sched_yield();
+    if( enclaveStatus < 0 ) {
+        __atomic_store_n( &args->exited, 1, __ATOMIC_RELEASE );
+        return NULL;
+    }
+
+    sgx_status_t ret = EcallStartWarmResponder( startup->enclaveID,
+                                                startup->channels[ args->index ],
+                                                startup->config.heapPrefaultBytes,
+                                                &args->ready );
+    if( ret != SGX_SUCCESS ) {
+        printf( "Error! Startup responder %u could not enter the enclave:\n", args->index );
+        print_error_message( ret );
+    }
+    __atomic_store_n( &args->exited, 1, __ATOMIC_RELEASE );
+
+    return NULL;
+}
+
+void* EnclaveReplayResponderThread( void* hotEcallAsVoidP )
+{
+    //To be started in a new thread
+    HotCall *hotEcall = (HotCall*)hotEcallAsVoidP;
+    EcallStartReplayResponder( globalEnclaveID, hotEcall );
+
+    return NULL;
+}
+
+//Requests of one traced thread, reissued on a channel of its own
+typedef struct {
+    HotCall*                    hotCall;
+    const HotCallTraceRecord*   records;
+    uint64_t                    numRecords;
+    uint64_t                    traceStartTsc;
+    double                      cyclesPerTraceCycle;    //0: as fast as possible
+    const uint8_t*              payload;                //all ones, as long as the largest payload
+    volatile bool*              start;
+    volatile uint64_t*          replayStartTsc;
+    uint64_t*                   measurements;
+    uint64_t                    numErrors;
+    ReplayCall                  call;
+} ReplayCallerArgs;
+
+void* ReplayCallerThread( void* argsAsVoidP )
+{
+    ReplayCallerArgs *args = (ReplayCallerArgs*)argsAsVoidP;
+    args->call.payload  = args->payload;
+    args->call.numCalls = 0;
+
+    while( ! *args->start )
+        _mm_pause();
+
+    const uint64_t replayStartTsc = *args->replayStartTsc;
+    for( uint64_t i = 0; i < args->numRecords; ++i ) {
+        const HotCallTraceRecord* record = &args->records[ i ];
+
+        //With the original timing the latency counts from the due time, as in App/OpenLoop.h
+        uint64_t startTime = rdtscp();
+        if( args->cyclesPerTraceCycle > 0 ) {
+            uint64_t dueTime = replayStartTsc +
+                               (uint64_t)( ( record->tsc - args->traceStartTsc ) * args->cyclesPerTraceCycle );
+            while( startTime < dueTime ) {
+                _mm_pause();
+                startTime = rdtscp();
+            }
+            startTime = dueTime;
+        }
+
+        args->call.payloadSize = record->payloadSize;
+        HotCall_requestCallSized( args->hotCall, record->callID % REPLAY_NUM_STUBS, &args->call, record->payloadSize );
+        uint64_t endTime = rdtscp();
+
+        args->measurements[ i ] = endTime - startTime;
+
+        if( args->call.checksum != record->payloadSize )
+            args->numErrors++;
+    }
+
+    return NULL;
+}
+
+//One caller of the open-loop load: calls are issued when due, not when the previous one ends
+typedef struct {
+    HotCall*            hotCall;        //NULL for SDK ecalls
+    OpenLoopSchedule    schedule;
+    volatile bool*      start;
+    uint64_t*           measurements;
+    uint64_t            numCalls;
+    uint64_t            endTsc;
+    uint64_t            numErrors;
+    int                 data;
+} OpenLoopCallerArgs;
+
+void* OpenLoopCallerThread( void* argsAsVoidP )
+{
+    OpenLoopCallerArgs *args = (OpenLoopCallerArgs*)argsAsVoidP;
+
+    while( ! *args->start )
+        _mm_pause();
+
+    int expectedData = args->data;
+    for( uint64_t i = 0; i < args->numCalls; ++i ) {
+        //Once behind schedule the next call starts right away, still timed from its due time
+        const uint64_t dueTime = OpenLoopSchedule_next( &args->schedule );
+        while( rdtscp() < dueTime )
+            _mm_pause();
+
+        if( args->hotCall != NULL )
+            HotCall_requestCall( args->hotCall, 0, &args->data );
+        else {
+            TransitionEmulation_enter();
+            MyCustomEcall( globalEnclaveID, &args->data );
+            TransitionEmulation_exit();
+        }
+        uint64_t endTime = rdtscp();
+
+        args->measurements[ i ] = endTime - dueTime;
+
+        expectedData++;
+        if( args->data != expectedData )
+            args->numErrors++;
+    }
+    args->endTsc = rdtscp();
+
+    return NULL;
+}
+
+void* EnclaveSharedResponderThread( void* channelAsVoidP )
+{
+    //To be started in a new thread
+    HotSharedChannel *channel = (HotSharedChannel*)channelAsVoidP;
+    EcallStartSharedResponder( globalEnclaveID, channel );
+
+    return NULL;
+}
+
+//What a request from another process costs without shared channels: after the socket hop,
+//an SDK ecall
+void ForwardToSDKEcall( void* data )
+{
+    TransitionEmulation_enter();
+    MyCustomEcall( globalEnclaveID, data );
+    TransitionEmulation_exit();
+}
+
+class HotCallsTesterError {};
+
+
+
+class HotCallsTester {
+public:
+    HotCallsTester( const map<string, string>& options ) : m_options( options ) {
+        m_enclaveID = 0;
+
+        if( initialize_enclave( ENCLAVE_FILENAME, TOKEN_FILENAME, &m_enclaveID ) < 0){
+            printf("Enter a character before exit ...\n");
+            getchar();
+            throw HotCallsTesterError(); 
+        }
+
+        m_numRepeats = GetOption( "iterations", PERFORMANCE_MEASUREMENT_NUM_REPEATS );
+
+        CreateMeasurementsDirectory();
+        ConfigureTransitionEmulation();
+        ConfigureRealtimeIsolation();
+        CollectMetadata();
+    }
+
+    ~HotCallsTester() {
+        /* Destroy the enclave */
+        sgx_destroy_enclave( m_enclaveID );
+    }
+
+    void Run( const vector<string>& testNames ) {
+        vector<string> tests = testNames;
+        if( tests.empty() ) {
+            tests.push_back( "hot-ecalls" );
+            tests.push_back( "hot-ocalls" );
+
+            tests.push_back( "sdk-ecalls" );
+            tests.push_back( "sdk-ocalls" );
+        }
+
+        const bool recordTrace = StartTraceRecording();
+        for( size_t i = 0; i < tests.size(); ++i ) {
+            try {
+                if( ! RunCountedTest( tests[ i ] ) ) {
+                    printf( "Unknown test %s\n", tests[ i ].c_str() );
+                    PrintUsage();
+                }
+            }
+            catch( const HotCallsTesterError& ) {
+                printf( "Error! Test %s failed, skipping it\n", tests[ i ].c_str() );
+            }
+        }
+        if( recordTrace )
+            WriteTraceRecording();
+
+        WriteProfile();
+        WritePerfCounts();
+
+        string referenceProfile = GetStringOption( "reference-profile", "" );
+        if( ! referenceProfile.empty() )
+            CompareWithReferenceProfile( referenceProfile );
+    }
+
+    //With --record-trace, every hot call request the app issues during the tests goes into
+    //a trace file (App/HotCallTrace.h) that the trace-replay test can reissue
+    bool StartTraceRecording()
+    {
+        if( GetStringOption( "record-trace", "" ).empty() )
+            return false;
+
+#ifdef HOTCALL_TRACE
+        HotCallTrace_start( GetOption( "trace-max-records", HOTCALL_TRACE_DEFAULT_MAX_RECORDS ) );
+        return true;
+#else
+        printf( "Error! --record-trace needs a build with HOTCALL_TRACE=1\n" );
+        return false;
+#endif
+    }
+
+    void WriteTraceRecording()
+    {
+        HotCallTrace_stop();
+
+        string tracePath = GetStringOption( "record-trace", "1" );
+        if( tracePath == "1" )
+            tracePath = m_measurementsDir + "/hotcalls" + HOTCALL_TRACE_EXTENSION;
+
+        if( ! HotCallTrace_write( tracePath.c_str(), m_metadata.fields.tscFrequencyHz ) ) {
+            printf( "Error! Cannot write the trace to %s\n", tracePath.c_str() );
+            return;
+        }
+
+        cout << "Trace of " << HotCallTrace_numRecords() << " requests written to " << tracePath << "\n";
+    }
+
+    //With --perf, counts hardware and software events over the whole test: for the caller
+    //thread alone, and for the caller plus every thread the test starts (responders)
+    bool RunCountedTest( const string& testName ) {
+        if( GetOption( "perf", 0 ) == 0 )
+            return RunTest( testName );
+
+        PerfTestCounters counters;
+        PerfTestCounters_start( &counters, GetOption( "perf-hitm-event", 0 ) );
+        bool known         = RunTest( testName );
+        bool threadsExited = PerfTestCounters_stop( &counters );
+
+        if( known ) {
+            if( ! threadsExited )
+                printf( "Warning: threads of %s still running, their events are not counted\n", testName.c_str() );
+            RecordPerfCounts( testName, &counters.caller, &counters.process );
+        }
+
+        PerfTestCounters_close( &counters );
+        return known;
+    }
+
+    void RecordPerfCounts( const string& testName, const PerfCounterSet* callerCounters, const PerfCounterSet* processCounters )
+    {
+        ostringstream callerLine, respondersLine;
+        for( int counter = 0; counter < PERF_COUNTERS_NUM; ++counter ) {
+            const PerfCounter* caller  = &callerCounters->counters[ counter ];
+            const PerfCounter* process = &processCounters->counters[ counter ];
+
+            PerfCountEntry entry;
+            entry.test    = testName;
+            entry.counter = caller->name;
+            entry.event   = caller->event != NULL ? caller->event : "n/a";
+            entry.scope   = "caller";
+            entry.value   = caller->value;
+            entry.valid   = caller->event != NULL;
+            m_perfCounts.push_back( entry );
+
+            entry.event   = process->event != NULL ? process->event : "n/a";
+            entry.scope   = "responders";
+            entry.value   = process->value > caller->value ? process->value - caller->value : 0;
+            entry.valid   = process->event != NULL && caller->event != NULL;
+            m_perfCounts.push_back( entry );
+
+            callerLine     << " " << caller->name << " " << ( caller->event  != NULL ? to_string( caller->value ) : "n/a" );
+            respondersLine << " " << caller->name << " " << ( entry.valid ? to_string( entry.value ) : "n/a" );
+        }
+
+        printf( "%s events, caller:%s\n", testName.c_str(), callerLine.str().c_str() );
+        printf( "%s events, responders:%s\n", testName.c_str(), respondersLine.str().c_str() );
+    }
+
+    //perf_counters.txt: "<test> <scope> <counter> <value> <event>", value n/a when unavailable
+    void WritePerfCounts()
+    {
+        if( m_perfCounts.empty() )
+            return;
+
+        string fileFullPath = m_measurementsDir + "/perf_counters.txt";
+        ofstream countsFile( fileFullPath.c_str() );
+        countsFile << "# test scope counter value event\n";
+        for( size_t i = 0; i < m_perfCounts.size(); ++i ) {
+            const PerfCountEntry& entry = m_perfCounts[ i ];
+            countsFile << entry.test << " " << entry.scope << " " << entry.counter << " ";
+            if( entry.valid )
+                countsFile << entry.value;
+            else
+                countsFile << "n/a";
+            countsFile << " " << entry.event << "\n";
+        }
+
+        cout << "Event counts written to " << fileFullPath << "\n";
+    }
+
+    bool RunTest( const string& testName ) {
+        if( testName == "hot-ecalls" )
+            TestHotEcalls();
+        else if( testName == "hot-ocalls" )
+            TestHotOcalls();
+        else if( testName == "sdk-ecalls" )
+            TestSDKEcalls();
+        else if( testName == "sdk-ocalls" )
+            TestSDKOcalls();
+        else if( testName == "priority-lanes" )
+            TestPriorityLanes();
+        else if( testName == "numa-placement" )
+            TestNumaPlacement();
+        else if( testName == "trusted-arena" )
+            TestTrustedArena();
+        else if( testName == "spinlock-contention" )
+            TestSpinlockContention();
+        else if( testName == "hot-batches" )
+            TestHotBatches();
+        else if( testName == "mux-channels" )
+            TestMuxChannels();
+        else if( testName == "kv-store" )
+            TestKvStore();
+        else if( testName == "sealed-payloads" )
+            TestSealedPayloads();
+        else if( testName == "peer-enclaves" )
+            TestPeerEnclaves();
+        else if( testName == "startup" )
+            TestStartup();
+        else if( testName == "stream" )
+            TestStream();
+        else if( testName == "trace-replay" )
+            TestTraceReplay();
+        else if( testName == "open-loop" )
+            TestOpenLoop();
+        else if( testName == "cross-process" )
+            TestCrossProcess();
+        else
+            return false;
+
+        return true;
+    }
+
+    static void PrintUsage() {
+        printf( "Usage: test_hotcalls [--option=value ...] [test ...]\n" );
+        printf( "Tests: hot-ecalls hot-ocalls sdk-ecalls sdk-ocalls priority-lanes numa-placement trusted-arena\n" );
+        printf( "       spinlock-contention hot-batches mux-channels kv-store sealed-payloads peer-enclaves\n" );
+        printf( "       startup stream trace-replay open-loop cross-process\n" );
+        printf( "Without tests, runs hot-ecalls hot-ocalls sdk-ecalls sdk-ocalls\n" );
+        printf( "Transition emulation (for SGX_MODE=SIM): --emulate-transitions [--eenter-cycles=N --eexit-cycles=N\n" );
+        printf( "       --flush-bytes=N --tlb-pages=N --aex-interval=N --aex-cycles=N]\n" );
+        printf( "Compare against a hardware run: --reference-profile=measurments/<timestamp>/profile.txt\n" );
+        printf( "Samples of the basic tests: --iterations=N. Also write CSV files: --csv\n" );
+        printf( "CPU of the clock publisher for enclave-side ocall round trips: --clock-cpu=N\n" );
+        printf( "Count events of every test (perf_event_open): --perf [--perf-hitm-event=<raw event>]\n" );
+        printf( "Record hot call requests (make HOTCALL_TRACE=1): --record-trace[=path] [--trace-max-records=N]\n" );
+        printf( "Replay a recorded trace: trace-replay --replay-trace=path [--replay-speed=S, 0 as fast as possible]\n" );
+        printf( "Open-loop load sweep: open-loop [--load-arrivals=poisson|fixed --load-callers=N --load-duration-ms=N\n" );
+        printf( "       --load-min-qps=N --load-max-qps=N --load-qps-step=X]\n" );
+        printf( "Calls from other processes: cross-process [--cross-process-clients=N --cross-process-iterations=N]\n" );
+        printf( "Real-time basic tests (SCHED_FIFO, mlockall): --rt [--rt-priority=N --rt-caller-cpu=N --rt-responder-cpu=N]\n" );
+        printf( "Attribute hot/SDK ecall outliers to preemption: --classify-outliers [--outlier-factor=N]\n" );
+    }
+
+    void TestHotEcalls()
+    {
+        MeasurementColumn column                 = OpenMeasurementColumn( "HotEcall_latencies_in_cycles", m_numRepeats );
+        uint64_t*         performaceMeasurements = column.rows;
+
+        uint64_t    startTime       = 0;
+        uint64_t    endTime         = 0;
+        int         data            = 0;
+        int         expectedData    = 0;
+        HotCall     hotEcall        = HOTCALL_INITIALIZER;
+        hotEcall.data               = &data; 
+
+        globalEnclaveID    = m_enclaveID;
+        globalResponderTid = 0;
+        if( RealtimeIsolation_createResponder( &hotEcall.responderThread, EnclaveResponderThread, (void*)&hotEcall ) != 0 ) {
+            printf( "Error! Cannot start the hot ecall responder\n" );
+            throw HotCallsTesterError();
+        }
+        const pid_t responderTid = GetOption( "classify-outliers", 0 ) != 0 ? WaitForResponderTid() : 0;
+
+        OutlierClassifier classifier( this, "HotEcall", m_numRepeats, responderTid );
+        RealtimeIsolation_enterCaller();
+
+        const uint16_t requestedCallID = 0;
+        for( uint64_t i=0; i < m_numRepeats; ++i ) {
+            classifier.BeforeSample();
+            startTime = rdtscp();
+            HotCall_requestCall( &hotEcall, requestedCallID, &data );
+            endTime   = rdtscp();
+            classifier.AfterSample( i );
+        
+            performaceMeasurements[ i ] = endTime       - startTime;
+
+            expectedData++;
+            if( data != expectedData ){
+                printf( "Error! Data is different than expected: %d != %d\n", data, expectedData );
+            }
+        }
+
+        RealtimeIsolation_leaveCaller();
+        StopResponder( &hotEcall );
+        classifier.Classify( performaceMeasurements );
+        CloseMeasurementColumn( &column, m_numRepeats );
+    }
+
+    //EnclaveResponderThread publishes its thread ID once it runs; 0 if it did not in time
+    pid_t WaitForResponderTid()
+    {
+        for( int waitedMs = 0; waitedMs < RESPONDER_START_TIMEOUT_MS; ++waitedMs ) {
+            if( globalResponderTid != 0 )
+                return globalResponderTid;
+            usleep( 1000 );
+        }
+
+        printf( "Warning: the responder did not start within %d ms, its context switches are not counted\n",
+                RESPONDER_START_TIMEOUT_MS );
+        return 0;
+    }
+
+    void TestSDKEcalls()
+    {
+        MeasurementColumn column                 = OpenMeasurementColumn( "SDKEcall_latencies_in_cycles", m_numRepeats );
+        uint64_t*         performaceMeasurements = column.rows;
+
+        uint64_t    startTime       = 0;
+        uint64_t    endTime         = 0;
+        int         data            = 0;
+        int         expectedData    = 0;
+
+        globalEnclaveID = m_enclaveID;        
+
+        OutlierClassifier classifier( this, "SDKEcall", m_numRepeats, 0 );
+        RealtimeIsolation_enterCaller();
+
+        const uint16_t requestedCallID = 0;
+        for( uint64_t i=0; i < m_numRepeats; ++i ) {
+            classifier.BeforeSample();
+            startTime = rdtscp();
+            TransitionEmulation_enter();
+            MyCustomEcall( m_enclaveID, &data );
+            TransitionEmulation_exit();
+            endTime   = rdtscp();
+            classifier.AfterSample( i );
+        
+            performaceMeasurements[ i ] = endTime       - startTime;
+
+            expectedData++;
+            if( data != expectedData ){
+                printf( "Error! Data is different than expected: %d != %d\n", data, expectedData );
+            }
+        }
+
+        RealtimeIsolation_leaveCaller();
+        classifier.Classify( performaceMeasurements );
+        CloseMeasurementColumn( &column, m_numRepeats );
+    }
+
+    void TestHotOcalls()
+    {
+        MeasurementColumn column                 = OpenMeasurementColumn( "HotOcall_latencies_in_cycles", m_numRepeats );
+        uint64_t*         performaceMeasurements = column.rows;
+
+        OcallParams ocallParams;
+        ocallParams.counter     = 0;
+        HotCall     hotOcall    = HOTCALL_INITIALIZER;
+        hotOcall.data           = &ocallParams;
+        
+        if( RealtimeIsolation_createResponder( &hotOcall.responderThread, OcallResponderThread, (void*)&hotOcall ) != 0 ) {
+            printf( "Error! Cannot start the hot ocall responder\n" );
+            throw HotCallsTesterError();
+        }
+       
+        //The enclave is the caller, on this thread
+        RealtimeIsolation_enterCaller();
+        EcallMeasureHotOcallsPerformance( 
+                m_enclaveID, 
+                performaceMeasurements, 
+                m_numRepeats,
+                &hotOcall );
+        RealtimeIsolation_leaveCaller();
+        CloseMeasurementColumn( &column, m_numRepeats );
+
+        MeasureEnclaveRoundTrips( "HotOcall", &hotOcall, &ocallParams );
+        StopResponder( &hotOcall );
+    }
+
+    void TestSDKOcalls()
+    {
+        MeasurementColumn column                 = OpenMeasurementColumn( "SDKOcall_latencies_in_cycles", m_numRepeats );
+        uint64_t*         performaceMeasurements = column.rows;
+
+        OcallParams ocallParams;
+        ocallParams.counter     = 0;
+        HotCall     hotOcall    = HOTCALL_INITIALIZER;
+        hotOcall.data           = &ocallParams;
+        
+        RealtimeIsolation_enterCaller();
+        EcallMeasureSDKOcallsPerformance( 
+                m_enclaveID, 
+                performaceMeasurements, 
+                m_numRepeats,
+                &ocallParams );
+        RealtimeIsolation_leaveCaller();
+        
+        CloseMeasurementColumn( &column, m_numRepeats );
+
+        MeasureEnclaveRoundTrips( "SDKOcall", NULL, &ocallParams );
+    }
+
+    void MeasureEnclaveRoundTrips( const string& prefix, HotCall* hotOcall, OcallParams* ocallParams )
+    {
+        //The latencies above are ocall-->enclave-->next_ocall, timed outside the enclave.
+        //With a clock page the enclave times its own enclave-->ocall-->enclave round trips.
+        //Each timestamp waits for a fresh clock update, which the clock overhead column measures.
+        //The hot ocall responder is still running: skip, rather than throw, if a column fails
+        MeasurementColumn roundTrips;
+        MeasurementColumn overheads;
+        if( ! TryOpenMeasurementColumn( prefix + "_enclave_round_trip_in_cycles", m_numRepeats, &roundTrips ) )
+            return;
+        if( ! TryOpenMeasurementColumn( prefix + "_clock_overhead_in_cycles", m_numRepeats, &overheads ) ) {
+            MeasurementColumn_close( &roundTrips, 0 );
+            return;
+        }
+
+        HotClockPage   clockPage;
+        ClockPublisher publisher;
+        if( ! ClockPublisher_start( &publisher, &clockPage, (int)GetOption( "clock-cpu", (uint64_t)-1 ) ) ) {
+            printf( "Error! Cannot start the clock publisher\n" );
+            MeasurementColumn_close( &roundTrips, 0 );
+            MeasurementColumn_close( &overheads,  0 );
+            return;
+        }
+
+        uint64_t scratchCycles   = 0;
+        ocallParams->cyclesCount = &scratchCycles;
+        EcallMeasureOcallRoundTrips(
+                m_enclaveID,
+                roundTrips.rows,
+                m_numRepeats,
+                hotOcall,
+                ocallParams,
+                &clockPage,
+                overheads.rows );
+        ClockPublisher_stop( &publisher );
+
+        CloseMeasurementColumn( &roundTrips, m_numRepeats );
+        CloseMeasurementColumn( &overheads,  m_numRepeats );
+    }
+
+    void TestHotBatches()
+    {
+        //Batches of 1, 2, 4 ... max-batch-size hot ecalls, each batch posted with one request
+        const uint64_t numBatches   = GetOption( "batch-iterations", PERFORMANCE_MEASUREMENT_NUM_REPEATS );
+        const uint64_t maxBatchSize = GetOption( "max-batch-size",   256 );
+
+        HotCall hotEcall = HOTCALL_INITIALIZER;
+        globalEnclaveID  = m_enclaveID;
+        pthread_create( &hotEcall.responderThread, NULL, EnclaveResponderThread, (void*)&hotEcall );
+
+        for( uint64_t batchSize = 1; batchSize <= maxBatchSize; batchSize *= 2 )
+            RunHotBatchScenario( &hotEcall, batchSize, numBatches );
+
+        StopResponder( &hotEcall );
+        pthread_join( hotEcall.responderThread, NULL );
+    }
+
+    void RunHotBatchScenario( HotCall* hotEcall, uint64_t batchSize, uint64_t numBatches )
+    {
+        vector<uint64_t>            performaceMeasurements( numBatches );
+        vector<int>                 data( batchSize, 0 );
+        vector<HotCallBatchEntry>   entries( batchSize );
+        for( uint64_t j = 0; j < batchSize; ++j ) {
+            entries[ j ].callID = 0;
+            entries[ j ].data   = &data[ j ];
+        }
+
+        HotCallBatch batch;
+        batch.numEntries  = batchSize;
+        batch.numRejected = 0;
+        batch.entries     = &entries[ 0 ];
+
+        int expectedData = 0;
+        for( uint64_t i = 0; i < numBatches; ++i ) {
+            uint64_t startTime = rdtscp();
+            HotCall_requestBatch( hotEcall, &batch );
+            uint64_t endTime   = rdtscp();
+
+            performaceMeasurements[ i ] = endTime - startTime;
+
+            expectedData++;
+            for( uint64_t j = 0; j < batchSize; ++j ) {
+                if( data[ j ] != expectedData ) {
+                    printf( "Error! Data is different than expected: %d != %d (entry %lu)\n", data[ j ], expectedData, j );
+                    break;
+                }
+            }
+        }
+        if( batch.numRejected != 0 )
+            printf( "Error! %u batch entries were rejected\n", batch.numRejected );
+
+        uint64_t median = Percentile( performaceMeasurements, 50 );
+        printf( "Batch of %3lu: p50 %lu cycles per batch, %.1f cycles per call\n",
+                batchSize, median, (double)median / batchSize );
+
+        ostringstream filename;
+        filename << "HotBatch_" << batchSize << "_latencies_in_cycles";
+        WriteMeasurementsToFile( filename.str(),
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+    }
+
+    void TestMuxChannels()
+    {
+        //1, 2, 4 ... max-channels channels, each with its own caller thread: all served by one
+        //multiplexed responder, then each served by a dedicated responder thread
+        const uint64_t maxChannels = min<uint64_t>( GetOption( "max-channels", 16 ), HOTCALL_MUX_MAX_CHANNELS );
+        for( uint64_t numChannels = 1; numChannels <= maxChannels; numChannels *= 2 ) {
+            RunChannelScenario( "MuxChannels_mux",       numChannels, true );
+            RunChannelScenario( "MuxChannels_dedicated", numChannels, false );
+        }
+    }
+
+    void RunChannelScenario( const string& scenarioPrefix, uint64_t numChannels, bool multiplexed )
+    {
+        vector<HotCall>           channels( numChannels );
+        vector<ChannelCallerArgs> callerArgs( numChannels );
+        vector<pthread_t>         callerThreads( numChannels );
+        vector<uint64_t>          performaceMeasurements( numChannels * PERFORMANCE_MEASUREMENT_NUM_REPEATS, 0 );
+        volatile bool             start = false;
+        HotCallMux                mux;
+
+        globalEnclaveID = m_enclaveID;
+        HotCallMux_init( &mux );
+        if( multiplexed )
+            pthread_create( &mux.responderThread, NULL, EnclaveMuxResponderThread, (void*)&mux );
+
+        for( size_t c = 0; c < numChannels; ++c ) {
+            HotCall_init( &channels[ c ] );
+            if( ! multiplexed )
+                pthread_create( &channels[ c ].responderThread, NULL, EnclaveResponderThread, (void*)&channels[ c ] );
+
+            callerArgs[ c ].mux             = multiplexed ? &mux : NULL;
+            callerArgs[ c ].hotCall         = &channels[ c ];
+            callerArgs[ c ].start           = &start;
+            callerArgs[ c ].data            = 0;
+            callerArgs[ c ].numErrors       = 0;
+            callerArgs[ c ].measurements    = &performaceMeasurements[ c * PERFORMANCE_MEASUREMENT_NUM_REPEATS ];
+            callerArgs[ c ].numMeasurements = PERFORMANCE_MEASUREMENT_NUM_REPEATS;
+            pthread_create( &callerThreads[ c ], NULL, ChannelCallerThread, (void*)&callerArgs[ c ] );
+        }
+
+        start = true;
+        uint64_t numErrors = 0;
+        for( size_t c = 0; c < numChannels; ++c ) {
+            pthread_join( callerThreads[ c ], NULL );
+            numErrors += callerArgs[ c ].numErrors;
+        }
+
+        if( multiplexed ) {
+            HotCallMux_stop( &mux );
+            pthread_join( mux.responderThread, NULL );
+        }
+        else {
+            for( size_t c = 0; c < numChannels; ++c ) {
+                StopResponder( &channels[ c ] );
+                pthread_join( channels[ c ].responderThread, NULL );
+            }
+        }
+
+        if( numErrors != 0 )
+            printf( "Error! Data is different than expected in %lu calls\n", numErrors );
+
+        ostringstream scenarioName;
+        scenarioName << scenarioPrefix << "_" << numChannels;
+        printf( "%s: %lu channels, %lu responder threads, p50 %lu p99 %lu cycles\n",
+                scenarioName.str().c_str(), numChannels, multiplexed ? 1 : numChannels,
+                Percentile( performaceMeasurements, 50 ), Percentile( performaceMeasurements, 99 ) );
+
+        WriteMeasurementsToFile( scenarioName.str() + "_latencies_in_cycles",
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+    }
+
+    enum PayloadMode {
+        PAYLOAD_PLAIN_HOT,          //plaintext in untrusted memory
+        PAYLOAD_SEALED_BATCH_HOT,   //one GCM pass per batch on each side
+        PAYLOAD_SEALED_SLOT_HOT,    //one GCM pass per slot, the slots posted as one HotCallBatch
+        PAYLOAD_SDK_INOUT,          //SDK ecall, payload copied [in, out]
+    };
+
+    void TestSealedPayloads()
+    {
+        //Batches of sealed-slots slots, 64 bytes to max-slot-size bytes each, in all four modes,
+        //through one sealed responder whose session lasts for the whole test
+        const uint64_t numSlots    = GetOption( "sealed-slots",  16 );
+        const uint64_t maxSlotSize = GetOption( "max-slot-size", 4096 );
+        if( ! GcmCipher_isSupported() ) {
+            printf( "AES-NI or PCLMULQDQ is not available, skipping sealed payloads\n" );
+            return;
+        }
+
+        SealedResponderArgs responderArgs;
+        HotSealedSession    session;
+        GcmKey              gcmKey;
+        HotCall             hotEcall = HOTCALL_INITIALIZER;
+        ifstream            randomSource( "/dev/urandom", ios::binary );
+        if( ! randomSource.read( (char*)session.key, sizeof( session.key ) ) ) {
+            printf( "Error! Cannot read a session key from /dev/urandom\n" );
+            return;
+        }
+        session.channelID = 1;
+        session.sequence  = 0;
+        GcmKey_init( &gcmKey, session.key );
+
+        globalEnclaveID = m_enclaveID;
+        responderArgs.hotCall        = &hotEcall;
+        responderArgs.channelID      = session.channelID;
+        responderArgs.maxPayloadSize = numSlots * maxSlotSize;
+        memcpy( responderArgs.key, session.key, sizeof( session.key ) );
+        pthread_create( &hotEcall.responderThread, NULL, EnclaveSealedResponderThread, (void*)&responderArgs );
+
+        for( uint64_t slotSize = 64; slotSize <= maxSlotSize; slotSize *= 4 ) {
+            RunPayloadScenario( "SealedPayloads_plain_hot",  PAYLOAD_PLAIN_HOT,        &hotEcall, &gcmKey, &session, numSlots, slotSize );
+            RunPayloadScenario( "SealedPayloads_batch_hot",  PAYLOAD_SEALED_BATCH_HOT, &hotEcall, &gcmKey, &session, numSlots, slotSize );
+            RunPayloadScenario( "SealedPayloads_slot_hot",   PAYLOAD_SEALED_SLOT_HOT,  &hotEcall, &gcmKey, &session, numSlots, slotSize );
+            RunPayloadScenario( "SealedPayloads_sdk_inout",  PAYLOAD_SDK_INOUT,        &hotEcall, &gcmKey, &session, numSlots, slotSize );
+        }
+
+        StopResponder( &hotEcall );
+        pthread_join( hotEcall.responderThread, NULL );
+        memset( &session, 0, sizeof( session ) );
+        memset( &gcmKey,  0, sizeof( gcmKey ) );
+    }
+
+    void RunPayloadScenario( const string& scenarioPrefix, PayloadMode mode, HotCall* hotEcall, const GcmKey* gcmKey,
+                             HotSealedSession* session, uint64_t numSlots, uint64_t slotSize )
+    {
+        const uint64_t numIterations = GetOption( "sealed-iterations", PERFORMANCE_MEASUREMENT_NUM_REPEATS );
+        const uint64_t payloadSize   = numSlots * slotSize;
+
+        vector<uint64_t>          performaceMeasurements( numIterations, 0 );
+        vector<uint8_t>           plaintext( payloadSize, 0xA5 );
+        vector<uint8_t>           ciphertext( payloadSize, 0 );
+        vector<HotSealedBatch>    slotBatches( numSlots );
+        vector<HotCallBatchEntry> entries( numSlots );
+        HotSealedBatch            batch;
+        HotCallBatch              callBatch;
+
+        batch.numSlots = numSlots;
+        batch.slotSize = slotSize;
+        batch.payload  = mode == PAYLOAD_PLAIN_HOT ? &plaintext[ 0 ] : &ciphertext[ 0 ];
+        for( uint64_t slot = 0; slot < numSlots; ++slot ) {
+            *(uint64_t*)&plaintext[ slot * slotSize ] = 0;
+            slotBatches[ slot ].numSlots = 1;
+            slotBatches[ slot ].slotSize = slotSize;
+            slotBatches[ slot ].payload  = &ciphertext[ slot * slotSize ];
+            entries[ slot ].callID       = SEALED_BATCH_CALL_ID;
+            entries[ slot ].data         = &slotBatches[ slot ];
+        }
+        callBatch.numEntries  = numSlots;
+        callBatch.numRejected = 0;
+        callBatch.entries     = &entries[ 0 ];
+
+        uint64_t numErrors = 0;
+        for( uint64_t i = 0; i < numIterations; ++i ) {
+            bool     opened    = true;
+            uint64_t startTime = rdtscp();
+            switch( mode ) {
+                case PAYLOAD_PLAIN_HOT:
+                    HotCall_requestCall( hotEcall, SEALED_PLAIN_CALL_ID, &batch );
+                    break;
+                case PAYLOAD_SEALED_BATCH_HOT:
+                    SealPayloadBatch( gcmKey, session, &batch, &plaintext[ 0 ] );
+                    HotCall_requestCall( hotEcall, SEALED_BATCH_CALL_ID, &batch );
+                    opened = OpenPayloadReply( gcmKey, session, &batch, &plaintext[ 0 ] );
+                    break;
+                case PAYLOAD_SEALED_SLOT_HOT:
+                    for( uint64_t slot = 0; slot < numSlots; ++slot )
+                        SealPayloadBatch( gcmKey, session, &slotBatches[ slot ], &plaintext[ slot * slotSize ] );
+                    HotCall_requestBatch( hotEcall, &callBatch );
+                    for( uint64_t slot = 0; slot < numSlots; ++slot ) {
+                        if( ! OpenPayloadReply( gcmKey, session, &slotBatches[ slot ], &plaintext[ slot * slotSize ] ) )
+                            opened = false;
+                    }
+                    break;
+                case PAYLOAD_SDK_INOUT:
+                    TransitionEmulation_enter();
+                    EcallProcessPayloads( m_enclaveID, &plaintext[ 0 ], payloadSize, slotSize );
+                    TransitionEmulation_exit();
+                    break;
+            }
+            uint64_t endTime   = rdtscp();
+
+            performaceMeasurements[ i ] = endTime - startTime;
+
+            bool correct = opened;
+            for( uint64_t slot = 0; slot < numSlots && correct; ++slot )
+                correct = *(uint64_t*)&plaintext[ slot * slotSize ] == i + 1;
+            if( ! correct )
+                numErrors++;
+        }
+
+        if( numErrors > 0 )
+            printf( "Error! Data is different than expected in %lu of %lu batches\n", numErrors, numIterations );
+
+        uint64_t median = Percentile( performaceMeasurements, 50 );
+        printf( "%-26s %2lu slots of %5lu bytes: p50 %8lu cycles per batch, %8.1f per slot, p99 %8lu\n",
+                scenarioPrefix.c_str(), numSlots, slotSize, median, (double)median / numSlots,
+                Percentile( performaceMeasurements, 99 ) );
+
+        ostringstream filename;
+        filename << scenarioPrefix << "_" << slotSize << "_latencies_in_cycles";
+        WriteMeasurementsToFile( filename.str(),
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+    }
+
+    void TestPeerEnclaves()
+    {
+        //The main enclave sends messages to a second enclave (PeerEnclave/) loaded in the same
+        //process: over a HotCall channel in untrusted memory, served by a responder inside the
+        //peer, and relayed by the app as an SDK ocall followed by an SDK ecall into the peer.
+        //Both are timed inside the main enclave with the clock page.
+        sgx_enclave_id_t peerEnclaveID = 0;
+        if( initialize_enclave( PEER_ENCLAVE_FILENAME, PEER_TOKEN_FILENAME, &peerEnclaveID ) < 0 ) {
+            printf( "Error! Cannot load %s\n", PEER_ENCLAVE_FILENAME );
+            return;
+        }
+        globalPeerEnclaveID = peerEnclaveID;
+
+        HotClockPage   clockPage;
+        ClockPublisher publisher;
+        if( ! ClockPublisher_start( &publisher, &clockPage, (int)GetOption( "clock-cpu", (uint64_t)-1 ) ) ) {
+            printf( "Error! Cannot start the clock publisher\n" );
+            sgx_destroy_enclave( peerEnclaveID );
+            return;
+        }
+
+        MeasurementColumn hotRoundTrips   = OpenMeasurementColumn( "PeerEnclave_hot_round_trip_in_cycles",   m_numRepeats );
+        MeasurementColumn relayRoundTrips = OpenMeasurementColumn( "PeerEnclave_relay_round_trip_in_cycles", m_numRepeats );
+        MeasurementColumn overheads       = OpenMeasurementColumn( "PeerEnclave_clock_overhead_in_cycles",   m_numRepeats );
+
+        PeerMessage message;
+        HotCall     peerChannel = HOTCALL_INITIALIZER;
+        pthread_create( &peerChannel.responderThread, NULL, PeerEnclaveResponderThread, (void*)&peerChannel );
+
+        EcallMeasurePeerRoundTrips( m_enclaveID, hotRoundTrips.rows, m_numRepeats, &peerChannel, &message, &clockPage, overheads.rows );
+        StopResponder( &peerChannel );
+        pthread_join( peerChannel.responderThread, NULL );
+
+        EcallMeasurePeerRoundTrips( m_enclaveID, relayRoundTrips.rows, m_numRepeats, NULL, &message, &clockPage, NULL );
+        ClockPublisher_stop( &publisher );
+
+        CloseMeasurementColumn( &hotRoundTrips,   m_numRepeats );
+        CloseMeasurementColumn( &relayRoundTrips, m_numRepeats );
+        CloseMeasurementColumn( &overheads,       m_numRepeats );
+
+        sgx_destroy_enclave( peerEnclaveID );
+    }
+
+    //Creates an enclave with config.numResponders hot ecall responders, ready for traffic.
+    //Fast: the channels are allocated and pre-faulted, and the responders spawned and pinned,
+    //while the enclave is being created. Each responder then pre-faults its share of the
+    //trusted heap, and warmup calls run on all channels at once. Otherwise the enclave comes
+    //first and the responders are spawned without waiting for them, like the tests do.
+    bool StartEnclave( const StartupConfig& config, EnclaveStartup* startup )
+    {
+        startup->config         = config;
+        startup->enclaveID      = 0;
+        startup->enclaveStatus  = 0;
+        startup->arenaAllocated = false;
+        startup->responderThreads.resize( config.numResponders );
+        startup->responderArgs.resize( config.numResponders );
+        memset( startup->phaseCycles, 0, sizeof( startup->phaseCycles ) );
+
+        uint64_t  startTime = rdtscp();
+        pthread_t channelsThread;
+        if( config.fast ) {
+            pthread_create( &channelsThread, NULL, StartupChannelsThread, (void*)startup );
+            SpawnStartupResponders( startup );
+        }
+
+        uint64_t phaseStart = rdtscp();
+        int      ret        = initialize_enclave( ENCLAVE_FILENAME, TOKEN_FILENAME, &startup->enclaveID );
+        startup->phaseCycles[ STARTUP_PHASE_CREATE ] = rdtscp() - phaseStart;
+
+        if( config.fast )
+            pthread_join( channelsThread, NULL );
+        else
+            StartupChannelsThread( startup );
+
+        __atomic_store_n( &startup->enclaveStatus, ret < 0 ? -1 : 1, __ATOMIC_RELEASE );
+        if( ret < 0 ) {
+            ShutdownEnclave( startup );
+            return false;
+        }
+
+        if( ! config.fast ) {
+            bool spawned = SpawnStartupResponders( startup );
+            startup->phaseCycles[ STARTUP_PHASE_TOTAL ] = rdtscp() - startTime;
+            if( ! spawned )
+                ShutdownEnclave( startup );
+            return spawned;
+        }
+
+        phaseStart = rdtscp();
+        if( ! WaitForStartupResponders( startup ) ) {
+            ShutdownEnclave( startup );
+            return false;
+        }
+        startup->phaseCycles[ STARTUP_PHASE_READY ] = rdtscp() - phaseStart;
+
+        phaseStart = rdtscp();
+        for( uint64_t i = 0; i < config.numWarmupCalls; ++i ) {
+            for( uint32_t c = 0; c < config.numResponders; ++c )
+                HotCall_postCall( startup->channels[ c ], 0, &startup->data[ c ] );
+            for( uint32_t c = 0; c < config.numResponders; ++c )
+                HotCall_waitForResult( startup->channels[ c ] );
+        }
+        startup->phaseCycles[ STARTUP_PHASE_WARMUP ] = rdtscp() - phaseStart;
+
+        for( uint32_t c = 0; c < config.numResponders; ++c ) {
+            if( startup->data[ c ] != (int)config.numWarmupCalls )
+                printf( "Error! Data is different than expected: %d != %lu (channel %u)\n",
+                        startup->data[ c ], config.numWarmupCalls, c );
+        }
+
+        startup->phaseCycles[ STARTUP_PHASE_TOTAL ] = rdtscp() - startTime;
+        return true;
+    }
+
+    //Returns false if a thread could not be created; the others are still spawned
+    bool SpawnStartupResponders( EnclaveStartup* startup )
+    {
+        //Fast startup pins responder r to the allowed CPU after the r-th, leaving the first
+        //one to the caller. A thread that cannot be pinned there runs unpinned.
+        vector<int> cpus;
+        cpu_set_t   allowed;
+        if( startup->config.fast && sched_getaffinity( 0, sizeof( allowed ), &allowed ) == 0 ) {
+            for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+                if( CPU_ISSET( cpu, &allowed ) )
+                    cpus.push_back( cpu );
+            }
+        }
+
+        bool     allSpawned = true;
+        uint64_t phaseStart = rdtscp();
+        for( uint32_t r = 0; r < startup->config.numResponders; ++r ) {
+            StartupResponderArgs* args = &startup->responderArgs[ r ];
+            args->startup = startup;
+            args->index   = r;
+            args->cpu     = cpus.empty() ? -1 : cpus[ ( r + 1 ) % cpus.size() ];
+            args->ready   = 0;
+            args->exited  = 0;
+
+            pthread_t* thread = &startup->responderThreads[ r ];
+            args->spawned = args->cpu >= 0 &&
+                            CreatePinnedThread( thread, args->cpu, StartupResponderThread, (void*)args ) == 0;
+            if( ! args->spawned ) {
+                args->cpu     = -1;
+                args->spawned = pthread_create( thread, NULL, StartupResponderThread, (void*)args ) == 0;
+            }
+            if( ! args->spawned ) {
+                printf( "Error! Cannot create startup responder %u\n", r );
+                args->exited = 1;
+                allSpawned   = false;
+            }
+        }
+        startup->phaseCycles[ STARTUP_PHASE_SPAWN ] = rdtscp() - phaseStart;
+
+        return allSpawned;
+    }
+
+    //Waits for every fast startup responder to serve. False if one failed to enter the
+    //enclave (e.g. out of TCS) or was not ready within STARTUP_READY_TIMEOUT_MS.
+    bool WaitForStartupResponders( EnclaveStartup* startup )
+    {
+        struct timespec start, now;
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        for( uint32_t r = 0; r < startup->config.numResponders; ++r ) {
+            StartupResponderArgs* args = &startup->responderArgs[ r ];
+            while( __atomic_load_n( &args->ready, __ATOMIC_ACQUIRE ) == 0 ) {
+                if( __atomic_load_n( &args->exited, __ATOMIC_ACQUIRE ) != 0 ) {
+                    printf( "Error! Startup responder %u exited before serving\n", r );
+                    return false;
+                }
+
+                clock_gettime( CLOCK_MONOTONIC, &now );
+                if( ( now.tv_sec - start.tv_sec ) * 1000 + ( now.tv_nsec - start.tv_nsec ) / 1000000 > STARTUP_READY_TIMEOUT_MS ) {
+                    printf( "Error! Startup responder %u was not ready within %d ms\n", r, STARTUP_READY_TIMEOUT_MS );
+                    return false;
+                }
+                _mm_pause();
+            }
+        }
+
+        return true;
+    }
+
+    void ShutdownEnclave( EnclaveStartup* startup )
+    {
+        const bool spawned = startup->config.fast || startup->enclaveStatus > 0;
+        for( uint32_t r = 0; spawned && r < startup->config.numResponders; ++r ) {
+            if( ! startup->responderArgs[ r ].spawned )
+                continue;
+            StopResponder( startup->channels[ r ] );
+            pthread_join( startup->responderThreads[ r ], NULL );
+        }
+
+        if( startup->enclaveStatus > 0 )
+            sgx_destroy_enclave( startup->enclaveID );
+        if( startup->arenaAllocated )
+            SharedMemoryArena_destroy( &startup->channelArena );
+    }
+
+    void TestStartup()
+    {
+        //Starts of a new instance of the enclave, each followed by one hot ecall: in the lazy
+        //order the tests use and in fast startup mode. Every phase gets a column with one row
+        //per start. After the first start the enclave file comes from the page cache.
+        StartupConfig config;
+        config.numResponders     = max<uint64_t>( GetOption( "startup-responders", 2 ), 1 );
+        config.heapPrefaultBytes = GetOption( "startup-heap", 16 << 20 );
+        config.numWarmupCalls    = GetOption( "startup-warmup", 1000 );
+        const uint64_t numStarts = max<uint64_t>( GetOption( "startup-iterations", 10 ), 1 );
+
+        config.fast = false;
+        RunStartupScenario( "Startup_lazy", config, numStarts );
+        config.fast = true;
+        RunStartupScenario( "Startup_fast", config, numStarts );
+    }
+
+    void RunStartupScenario( const string& scenarioPrefix, const StartupConfig& config, uint64_t numStarts )
+    {
+        vector< vector<uint64_t> > phaseMeasurements( STARTUP_NUM_PHASES, vector<uint64_t>( numStarts, 0 ) );
+        for( uint64_t i = 0; i < numStarts; ++i ) {
+            EnclaveStartup startup;
+            if( ! StartEnclave( config, &startup ) ) {
+                printf( "Error! Cannot start the enclave\n" );
+                return;
+            }
+
+            int      expectedData = startup.data[ 0 ] + 1;
+            uint64_t startTime    = rdtscp();
+            HotCall_requestCall( startup.channels[ 0 ], 0, &startup.data[ 0 ] );
+            startup.phaseCycles[ STARTUP_PHASE_FIRST_CALL ] = rdtscp() - startTime;
+
+            if( startup.data[ 0 ] != expectedData )
+                printf( "Error! Data is different than expected: %d != %d\n", startup.data[ 0 ], expectedData );
+
+            ShutdownEnclave( &startup );
+            for( int phase = 0; phase < STARTUP_NUM_PHASES; ++phase )
+                phaseMeasurements[ phase ][ i ] = startup.phaseCycles[ phase ];
+        }
+
+        ostringstream summary;
+        for( int phase = 0; phase < STARTUP_NUM_PHASES; ++phase ) {
+            summary << " " << STARTUP_PHASE_NAMES[ phase ] << " " << Percentile( phaseMeasurements[ phase ], 50 );
+            WriteMeasurementsToFile( scenarioPrefix + "_" + STARTUP_PHASE_NAMES[ phase ] + "_in_cycles",
+                                     &phaseMeasurements[ phase ][ 0 ],
+                                     numStarts );
+        }
+        printf( "%s p50 cycles:%s\n", scenarioPrefix.c_str(), summary.str().c_str() );
+    }
+
+    enum StreamMode {
+        STREAM_HOT_IN,      //app produces into a stream ring, the enclave consumes
+        STREAM_SDK_IN,      //one SDK ecall per chunk, copied [in]
+        STREAM_HOT_OUT,     //the enclave produces into a stream ring, the app consumes
+        STREAM_SDK_OUT,     //one SDK ecall per chunk, copied [out]
+        STREAM_NUM_MODES
+    };
+
+    void TestStream()
+    {
+        //stream-bytes into and out of the enclave, through a ring of stream-chunks chunks
+        //(include/hot_stream.h) and through one SDK ecall per chunk, for chunks of 4KB, 16KB ...
+        //max-chunk-size. Every transfer is checked against the stream checksum.
+        const uint64_t numBytes     = GetOption( "stream-bytes", 64 << 20 ) & ~7ULL;
+        const uint64_t numChunks    = GetOption( "stream-chunks", 8 );
+        const uint64_t maxChunkSize = GetOption( "max-chunk-size", 1 << 20 );
+        if( ! HotStream_validLayout( numChunks, maxChunkSize ) || numBytes == 0 ) {
+            printf( "Error! --stream-chunks must be a power of two up to %d\n", HOTSTREAM_MAX_CHUNKS );
+            return;
+        }
+
+        vector<uint8_t> source( numBytes );
+        vector<uint8_t> destination( numBytes );
+        StreamData_fill( &source[ 0 ], numBytes, 0 );
+
+        string   summaryPath = m_measurementsDir + "/stream_throughput.txt";
+        ofstream summaryFile( summaryPath.c_str() );
+        summaryFile << "# mechanism direction chunk_size GB_per_sec\n";
+
+        globalEnclaveID = m_enclaveID;
+        for( uint64_t chunkSize = 4096; chunkSize <= maxChunkSize; chunkSize *= 4 ) {
+            for( int mode = 0; mode < STREAM_NUM_MODES; ++mode )
+                RunStreamScenario( (StreamMode)mode, numChunks, chunkSize, source, destination, summaryFile );
+        }
+
+        cout << "Throughput summary written to " << summaryPath << "\n";
+    }
+
+    void RunStreamScenario( StreamMode mode, uint64_t numChunks, uint64_t chunkSize,
+                            const vector<uint8_t>& source, vector<uint8_t>& destination, ofstream& summaryFile )
+    {
+        static const char* MODE_MECHANISMS[ STREAM_NUM_MODES ] = { "HotStream", "SDK", "HotStream", "SDK" };
+        static const char* MODE_DIRECTIONS[ STREAM_NUM_MODES ] = { "in", "in", "out", "out" };
+        const uint64_t numBytes         = source.size();
+        const uint64_t numIterations    = GetOption( "stream-iterations", 5 );
+        const uint64_t expectedChecksum = StreamData_expectedChecksum( numBytes );
+
+        SharedMemoryArena arena;
+        if( ! SharedMemoryArena_init( &arena, sizeof( HotStream ) + numChunks * chunkSize + SHARED_MEMORY_CACHE_LINE_SIZE,
+                                      SharedMemory_currentNumaNode() ) ) {
+            printf( "Error! Cannot allocate a stream of %lu chunks of %lu bytes\n", numChunks, chunkSize );
+            return;
+        }
+        HotStream* stream = (HotStream*)SharedMemoryArena_alloc( &arena, sizeof( HotStream ) );
+        uint8_t*   chunks = (uint8_t*)  SharedMemoryArena_alloc( &arena, numChunks * chunkSize );
+
+        vector<uint64_t> performaceMeasurements( numIterations );
+        for( uint64_t i = 0; i < numIterations; ++i ) {
+            memset( &destination[ 0 ], 0, numBytes );
+            HotStream_init( stream, chunks, numChunks, chunkSize );
+
+            EnclaveStreamArgs args;
+            args.stream   = stream;
+            args.numBytes = numBytes;
+            args.checksum = 0;
+            args.status   = SGX_SUCCESS;
+
+            uint64_t  checksum  = 0;
+            uint64_t  startTime = rdtscp();
+            pthread_t enclaveThread;
+            if( mode == STREAM_HOT_IN ) {
+                pthread_create( &enclaveThread, NULL, EnclaveStreamConsumerThread, (void*)&args );
+                HotStreamEnd producer;
+                HotStreamEnd_attach( &producer, stream );
+                for( uint64_t offset = 0; offset < numBytes; offset += chunkSize ) {
+                    uint32_t length = (uint32_t)min( numBytes - offset, chunkSize );
+                    uint8_t* chunk  = HotStream_acquire( &producer );
+                    if( chunk == NULL )
+                        break;
+                    memcpy( chunk, &source[ offset ], length );
+                    HotStream_publish( &producer, length );
+                }
+                HotStream_close( &producer );
+                pthread_join( enclaveThread, NULL );
+                if( args.status != SGX_SUCCESS ) {
+                    printf( "Error! The enclave stream consumer failed:\n" );
+                    print_error_message( args.status );
+                }
+                checksum = args.checksum;
+            }
+            else if( mode == STREAM_HOT_OUT ) {
+                pthread_create( &enclaveThread, NULL, EnclaveStreamProducerThread, (void*)&args );
+                HotStreamEnd   consumer;
+                const uint8_t* chunk;
+                uint32_t       length;
+                uint64_t       offset = 0;
+                HotStreamEnd_attach( &consumer, stream );
+                while( HotStream_next( &consumer, &chunk, &length ) == HOTSTREAM_OK ) {
+                    if( offset + length <= numBytes )
+                        memcpy( &destination[ offset ], chunk, length );
+                    offset += length;
+                    HotStream_release( &consumer );
+                }
+                pthread_join( enclaveThread, NULL );
+                if( offset != numBytes )
+                    printf( "Error! Streamed %lu bytes instead of %lu\n", offset, numBytes );
+            }
+            else {
+                for( uint64_t offset = 0; offset < numBytes; offset += chunkSize ) {
+                    uint64_t length        = min( numBytes - offset, chunkSize );
+                    uint64_t chunkChecksum = 0;
+                    TransitionEmulation_enter();
+                    if( mode == STREAM_SDK_IN )
+                        EcallConsumeChunk( m_enclaveID, &chunkChecksum, &source[ offset ], length );
+                    else
+                        EcallProduceChunk( m_enclaveID, &destination[ offset ], length, offset );
+                    TransitionEmulation_exit();
+                    checksum += chunkChecksum;
+                }
+            }
+            uint64_t endTime = rdtscp();
+
+            if( mode == STREAM_HOT_OUT || mode == STREAM_SDK_OUT )
+                checksum = StreamData_checksum( &destination[ 0 ], numBytes );
+            if( checksum != expectedChecksum )
+                printf( "Error! Stream checksum is different than expected: %lu != %lu\n", checksum, expectedChecksum );
+
+            performaceMeasurements[ i ] = endTime - startTime;
+        }
+        SharedMemoryArena_destroy( &arena );
+
+        const double gbPerSec = (double)numBytes * m_metadata.fields.tscFrequencyHz /
+                                Percentile( performaceMeasurements, 50 ) / 1e9;
+        printf( "%-9s %-3s %8lu byte chunks: %.2f GB/s\n", MODE_MECHANISMS[ mode ], MODE_DIRECTIONS[ mode ], chunkSize, gbPerSec );
+        summaryFile << MODE_MECHANISMS[ mode ] << " " << MODE_DIRECTIONS[ mode ] << " " << chunkSize << " " << gbPerSec << "\n";
 
-    *(ocallParams->cyclesCount)  = rdtscp() - startTime; //startTime was set in previous iteration (except when first called)
-    ocallParams->counter++;
+        ostringstream filename;
+        filename << MODE_MECHANISMS[ mode ] << "_" << MODE_DIRECTIONS[ mode ] << "_" << chunkSize << "_transfer_in_cycles";
+        WriteMeasurementsToFile( filename.str(),
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+    }
 
-    startTime     = rdtscp(); //for next iteration
-}
+    void TestTraceReplay()
+    {
+        //Reissues the requests of a trace recorded with --record-trace (App/HotCallTrace.h),
+        //one caller and channel per traced thread, against stub handlers in the enclave.
+        //replay-speed 1 keeps the recorded timing, 2 replays twice as fast, 0 as fast as possible.
+        const string tracePath   = GetStringOption( "replay-trace", "" );
+        const double replaySpeed = strtod( GetStringOption( "replay-speed", "1" ).c_str(), NULL );
+        HotCallTraceFile trace;
+        if( tracePath.empty() || ! HotCallTrace_open( &trace, tracePath.c_str() ) ) {
+            printf( "Error! --replay-trace=<path> must name a trace written by --record-trace\n" );
+            return;
+        }
 
-void* OcallResponderThread( void* hotCallAsVoidP )
-{
-    void (*callbacks[1])(void*);
-    callbacks[0] = MyCustomOcall;
+        const uint64_t numRecords = trace.header->fields.numRecords;
+        const uint32_t numThreads = trace.header->fields.numThreads;
+        if( numRecords == 0 || numThreads == 0 ) {
+            printf( "Error! %s holds no requests\n", tracePath.c_str() );
+            HotCallTrace_release( &trace );
+            return;
+        }
 
-    HotCallTable callTable;
-    callTable.numEntries = 1;
-    callTable.callbacks  = callbacks;
+        //Recorded cycles are converted to cycles of this machine, then scaled by the speed
+        const uint64_t traceFrequencyHz    = trace.header->fields.tscFrequencyHz;
+        double         cyclesPerTraceCycle = 0;
+        if( replaySpeed > 0 ) {
+            cyclesPerTraceCycle = 1.0 / replaySpeed;
+            if( traceFrequencyHz > 0 )
+                cyclesPerTraceCycle *= (double)m_metadata.fields.tscFrequencyHz / traceFrequencyHz;
+        }
 
-    HotCall_waitForCall( (HotCall *)hotCallAsVoidP, &callTable );
+        vector< vector<HotCallTraceRecord> > threadRecords( numThreads );
+        uint32_t                             maxPayloadSize = 0;
+        for( uint64_t r = 0; r < numRecords; ++r ) {
+            const HotCallTraceRecord& record = trace.records[ r ];
+            if( record.thread < numThreads )
+                threadRecords[ record.thread ].push_back( record );
+            maxPayloadSize = max( maxPayloadSize, record.payloadSize );
+        }
+        const uint64_t traceStartTsc = trace.records[ 0 ].tsc;
+        const uint64_t traceCycles   = trace.records[ numRecords - 1 ].tsc - traceStartTsc;
+        HotCallTrace_release( &trace );
+
+        vector<uint8_t>          payload( max<uint32_t>( maxPayloadSize, 1 ), 1 );
+        vector<HotCall>          channels( numThreads );
+        vector<ReplayCallerArgs> callerArgs( numThreads );
+        vector<pthread_t>        callerThreads( numThreads );
+        vector<uint64_t>         performaceMeasurements( numRecords, 0 );
+        volatile bool            start          = false;
+        volatile uint64_t        replayStartTsc = 0;
 
-    return NULL;
-}
+        globalEnclaveID = m_enclaveID;
+        uint64_t offset = 0;
+        for( size_t t = 0; t < numThreads; ++t ) {
+            HotCall_init( &channels[ t ] );
+            pthread_create( &channels[ t ].responderThread, NULL, EnclaveReplayResponderThread, (void*)&channels[ t ] );
+
+            callerArgs[ t ].hotCall             = &channels[ t ];
+            callerArgs[ t ].records             = threadRecords[ t ].empty() ? NULL : &threadRecords[ t ][ 0 ];
+            callerArgs[ t ].numRecords          = threadRecords[ t ].size();
+            callerArgs[ t ].traceStartTsc       = traceStartTsc;
+            callerArgs[ t ].cyclesPerTraceCycle = cyclesPerTraceCycle;
+            callerArgs[ t ].payload             = &payload[ 0 ];
+            callerArgs[ t ].start               = &start;
+            callerArgs[ t ].replayStartTsc      = &replayStartTsc;
+            callerArgs[ t ].measurements        = &performaceMeasurements[ offset ];
+            callerArgs[ t ].numErrors           = 0;
+            offset += threadRecords[ t ].size();
+            pthread_create( &callerThreads[ t ], NULL, ReplayCallerThread, (void*)&callerArgs[ t ] );
+        }
 
-class HotCallsTesterError {};
+        replayStartTsc = rdtscp();
+        start          = true;
+        uint64_t numErrors = 0;
+        for( size_t t = 0; t < numThreads; ++t ) {
+            pthread_join( callerThreads[ t ], NULL );
+            StopResponder( &channels[ t ] );
+            pthread_join( channels[ t ].responderThread, NULL );
+            numErrors += callerArgs[ t ].numErrors;
+            if( callerArgs[ t ].call.numCalls != callerArgs[ t ].numRecords )
+                numErrors++;
+        }
+        const uint64_t replayCycles = rdtscp() - replayStartTsc;
 
+        if( numErrors > 0 )
+            printf( "Error! Data is different than expected in %lu replayed calls\n", numErrors );
 
+        printf( "Replayed %lu requests of %u threads in %lu cycles (recorded in %lu): p50 %lu p99 %lu cycles\n",
+                offset, numThreads, replayCycles, traceCycles,
+                Percentile( performaceMeasurements, 50 ), Percentile( performaceMeasurements, 99 ) );
 
-class HotCallsTester {
-public:
-    HotCallsTester() {
-        m_enclaveID = 0;
+        WriteMeasurementsToFile( "TraceReplay_latencies_in_cycles",
+                                 &performaceMeasurements[ 0 ],
+                                 offset );
+    }
 
-        if( initialize_enclave() < 0){
-            printf("Enter a character before exit ...\n");
-            getchar();
-            throw HotCallsTesterError(); 
+    void TestOpenLoop()
+    {
+        //Open-loop latency vs. load of hot and SDK ecalls: load-callers callers together issue
+        //calls at a target rate (fixed or Poisson load-arrivals) for load-duration-ms each. The
+        //rate starts at load-min-qps and grows by load-qps-step until the achieved rate falls
+        //below 90% of the target (saturation) or passes load-max-qps.
+        const uint64_t numCallers = max<uint64_t>( GetOption( "load-callers", 1 ), 1 );
+        const uint64_t durationMs = GetOption( "load-duration-ms", 200 );
+        const uint64_t minQps     = max<uint64_t>( GetOption( "load-min-qps", 10000 ), 1 );
+        const uint64_t maxQps     = GetOption( "load-max-qps", 100000000 );
+        const double   qpsStep    = strtod( GetStringOption( "load-qps-step", "2" ).c_str(), NULL );
+        OpenLoopArrivals arrivals;
+        if( ! OpenLoopArrivals_parse( GetStringOption( "load-arrivals", "poisson" ).c_str(), &arrivals ) || qpsStep <= 1 ) {
+            printf( "Error! --load-arrivals must be fixed or poisson and --load-qps-step above 1\n" );
+            return;
         }
 
-        CreateMeasurementsDirectory();
+        string   summaryPath = m_measurementsDir + "/open_loop.txt";
+        ofstream summaryFile( summaryPath.c_str() );
+        summaryFile << "# mechanism arrivals callers target_qps achieved_qps p50 p99 p99.9 (cycles)\n";
+
+        for( int hotEcalls = 1; hotEcalls >= 0; --hotEcalls ) {
+            for( double qps = minQps; qps <= maxQps; qps *= qpsStep ) {
+                if( ! RunOpenLoopScenario( hotEcalls != 0, arrivals, numCallers, qps, durationMs, summaryFile ) )
+                    break;
+            }
+        }
+
+        cout << "Latency vs. load written to " << summaryPath << "\n";
     }
 
-    ~HotCallsTester() {
-        /* Destroy the enclave */
-        sgx_destroy_enclave( m_enclaveID );
+    //Returns false once the mechanism is saturated
+    bool RunOpenLoopScenario( bool hotEcalls, OpenLoopArrivals arrivals, uint64_t numCallers, double qps,
+                              uint64_t durationMs, ofstream& summaryFile )
+    {
+        const uint64_t tscFrequencyHz = m_metadata.fields.tscFrequencyHz;
+        const uint64_t callsPerCaller = max<uint64_t>( (uint64_t)( qps * durationMs / 1000 / numCallers ), 1 );
+
+        vector<HotCall>            channels( numCallers );
+        vector<OpenLoopCallerArgs> callerArgs( numCallers );
+        vector<pthread_t>          callerThreads( numCallers );
+        vector<uint64_t>           performaceMeasurements( numCallers * callsPerCaller, 0 );
+        volatile bool              start = false;
+
+        globalEnclaveID = m_enclaveID;
+        for( size_t c = 0; c < numCallers; ++c ) {
+            HotCall_init( &channels[ c ] );
+            if( hotEcalls )
+                pthread_create( &channels[ c ].responderThread, NULL, EnclaveResponderThread, (void*)&channels[ c ] );
+
+            callerArgs[ c ].hotCall      = hotEcalls ? &channels[ c ] : NULL;
+            callerArgs[ c ].start        = &start;
+            callerArgs[ c ].measurements = &performaceMeasurements[ c * callsPerCaller ];
+            callerArgs[ c ].numCalls     = callsPerCaller;
+            callerArgs[ c ].numErrors    = 0;
+            callerArgs[ c ].data         = 0;
+            pthread_create( &callerThreads[ c ], NULL, OpenLoopCallerThread, (void*)&callerArgs[ c ] );
+        }
+
+        //Every caller gets an equal share of the rate; the sum of Poisson processes is Poisson.
+        //The first calls are due after the callers had time to start spinning.
+        const uint64_t startTsc = rdtscp() + tscFrequencyHz / 1000;
+        for( size_t c = 0; c < numCallers; ++c )
+            OpenLoopSchedule_init( &callerArgs[ c ].schedule, arrivals, qps / numCallers, tscFrequencyHz,
+                                   startTsc, c + 1 );
+        start = true;
+
+        uint64_t numErrors = 0;
+        uint64_t endTsc    = startTsc;
+        for( size_t c = 0; c < numCallers; ++c ) {
+            pthread_join( callerThreads[ c ], NULL );
+            numErrors += callerArgs[ c ].numErrors;
+            endTsc     = max( endTsc, callerArgs[ c ].endTsc );
+        }
+
+        if( hotEcalls ) {
+            for( size_t c = 0; c < numCallers; ++c ) {
+                StopResponder( &channels[ c ] );
+                pthread_join( channels[ c ].responderThread, NULL );
+            }
+        }
+
+        if( numErrors > 0 )
+            printf( "Error! Data is different than expected in %lu open-loop calls\n", numErrors );
+
+        const double achievedQps = (double)performaceMeasurements.size() * tscFrequencyHz / ( endTsc - startTsc );
+        uint64_t     p50         = Percentile( performaceMeasurements, 50 );
+        uint64_t     p99         = Percentile( performaceMeasurements, 99 );
+        uint64_t     p999        = Percentile( performaceMeasurements, 99.9 );
+        const char*  mechanism   = hotEcalls ? "hot" : "sdk";
+        const bool   saturated   = achievedQps < 0.9 * qps;
+
+        printf( "Open loop %s ecalls, %s %.0f calls/s: achieved %.0f calls/s, p50 %lu p99 %lu p99.9 %lu cycles%s\n",
+                mechanism, OpenLoopArrivals_name( arrivals ), qps, achievedQps, p50, p99, p999,
+                saturated ? " (saturated)" : "" );
+        summaryFile << mechanism << " " << OpenLoopArrivals_name( arrivals ) << " " << numCallers << " "
+                    << (uint64_t)qps << " " << (uint64_t)achievedQps << " " << p50 << " " << p99 << " " << p999 << "\n";
+
+        ostringstream scenarioName;
+        scenarioName << "OpenLoop_" << mechanism << "_" << (uint64_t)qps << "_latencies_in_cycles";
+        WriteMeasurementsToFile( scenarioName.str(),
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+
+        return ! saturated;
     }
 
-    void Run( void ) {
-        TestHotEcalls();
-        TestHotOcalls();
+    void TestCrossProcess()
+    {
+        //Calls from other processes: forked clients attach to shared channels by name and post
+        //hot ecalls directly (include/hot_calls_shared.h), against forwarding every call over a
+        //Unix socket to an SDK ecall
+        const uint32_t numClients = min<uint64_t>( max<uint64_t>( GetOption( "cross-process-clients", 1 ), 1 ),
+                                                   CROSS_PROCESS_MAX_CLIENTS );
+        const uint64_t numCalls   = GetOption( "cross-process-iterations", m_numRepeats );
+        char segmentName[ SHARED_CHANNELS_NAME_SIZE ];
+        char socketPath[ CROSS_PROCESS_PATH_SIZE ];
+        snprintf( segmentName, sizeof( segmentName ), "/hotcalls-%d", (int)getpid() );
+        snprintf( socketPath,  sizeof( socketPath ),  "/tmp/hotcalls-%d.sock", (int)getpid() );
+
+        SharedChannels channels;
+        if( ! SharedChannels_create( &channels, segmentName, numClients ) ) {
+            printf( "Error! Cannot create the shared channels %s\n", segmentName );
+            return;
+        }
+
+        string   summaryPath = m_measurementsDir + "/cross_process.txt";
+        ofstream summaryFile( summaryPath.c_str() );
+        summaryFile << "# mechanism clients calls_per_sec p50 p99 (cycles)\n";
+
+        globalEnclaveID = m_enclaveID;
+        RunCrossProcessScenario( CROSS_PROCESS_HOT, segmentName, &channels, numClients, numCalls, summaryFile );
+        if( SharedChannels_reapDeadCallers( &channels ) != 0 )
+            printf( "Error! A client process died with its shared channel claimed\n" );
+        RunCrossProcessScenario( CROSS_PROCESS_SOCKET, socketPath, NULL, numClients, numCalls, summaryFile );
 
-        TestSDKEcalls();
-        TestSDKOcalls();
+        SharedChannels_close( &channels );
+        cout << "Throughput summary written to " << summaryPath << "\n";
     }
 
-    void TestHotEcalls()
+    void RunCrossProcessScenario( CrossProcessMode mode, const char* target, SharedChannels* channels,
+                                  uint32_t numClients, uint64_t numCalls, ofstream& summaryFile )
+    {
+        const char*         mechanism = mode == CROSS_PROCESS_HOT ? "hot" : "socket";
+        vector<uint64_t>    performaceMeasurements( numClients * numCalls, 0 );
+        vector<pthread_t>   responders( numClients );
+        SocketForwarder     forwarder;
+        CrossProcessClients clients;
+
+        //The clients are forked before any responder or forwarder thread exists
+        if( ! CrossProcess_spawn( &clients, mode, target, numClients, numCalls, &performaceMeasurements[ 0 ] ) ) {
+            printf( "Error! Cannot start %u client processes\n", numClients );
+            return;
+        }
+
+        if( mode == CROSS_PROCESS_HOT ) {
+            for( uint32_t c = 0; c < numClients; ++c )
+                pthread_create( &responders[ c ], NULL, EnclaveSharedResponderThread, &channels->segment->channels[ c ] );
+        }
+        else if( ! SocketForwarder_start( &forwarder, target, ForwardToSDKEcall ) ) {
+            printf( "Error! Cannot listen on %s\n", target );
+            CrossProcess_collect( &clients, &performaceMeasurements[ 0 ] );
+            return;
+        }
+
+        CrossProcess_go( &clients );
+        bool ok = CrossProcess_collect( &clients, &performaceMeasurements[ 0 ] );
+
+        if( mode == CROSS_PROCESS_HOT ) {
+            for( uint32_t c = 0; c < numClients; ++c ) {
+                HotSharedChannel_stop( &channels->segment->channels[ c ] );
+                pthread_join( responders[ c ], NULL );
+            }
+        }
+        else
+            SocketForwarder_stop( &forwarder );
+
+        if( ! ok ) {
+            printf( "Error! A %s client process could not finish its calls\n", mechanism );
+            return;
+        }
+        if( clients.numErrors > 0 )
+            printf( "Error! Data is different than expected in %lu cross-process calls\n", clients.numErrors );
+
+        uint64_t p50 = Percentile( performaceMeasurements, 50 );
+        uint64_t p99 = Percentile( performaceMeasurements, 99 );
+        printf( "Cross-process %s calls, %u clients: %.0f calls/s, p50 %lu p99 %lu cycles\n",
+                mechanism, numClients, clients.callsPerSecond, p50, p99 );
+        summaryFile << mechanism << " " << numClients << " " << (uint64_t)clients.callsPerSecond << " "
+                    << p50 << " " << p99 << "\n";
+
+        WriteMeasurementsToFile( string( "CrossProcess_" ) + mechanism + "_latencies_in_cycles",
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+    }
+
+    void TestKvStore()
+    {
+        //YCSB workloads against the in-enclave key-value store, through hot ecalls (one
+        //responder per client thread) and SDK ecalls, with 1, 2, 4 ... kv-max-threads clients
+        const string   workloadNames = GetStringOption( "kv-workloads", "ABCDEF" );
+        const uint64_t recordCount   = GetOption( "kv-records",     100000 );
+        const uint64_t maxThreads    = GetOption( "kv-max-threads", 4 );
+
+        ZipfianGenerator zipfian;
+        ZipfianGenerator_init( &zipfian, recordCount, YCSB_ZIPFIAN_CONSTANT );
+
+        string   summaryPath = m_measurementsDir + "/kv_throughput.txt";
+        ofstream summaryFile( summaryPath.c_str() );
+        summaryFile << "# workload mechanism threads ops_per_sec p50 p99 p99.9\n";
+
+        for( size_t w = 0; w < workloadNames.size(); ++w ) {
+            const YcsbWorkload* workload = YcsbWorkload_find( workloadNames[ w ] );
+            if( workload == NULL ) {
+                printf( "Unknown YCSB workload %c\n", workloadNames[ w ] );
+                continue;
+            }
+
+            for( uint64_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2 ) {
+                RunKvScenario( workload, &zipfian, numThreads, true,  summaryFile );
+                RunKvScenario( workload, &zipfian, numThreads, false, summaryFile );
+            }
+        }
+
+        EcallKvDestroy( m_enclaveID );
+        cout << "Throughput summary written to " << summaryPath << "\n";
+    }
+
+    void RunKvScenario( const YcsbWorkload* workload, const ZipfianGenerator* zipfian, uint64_t numThreads,
+                        bool hotEcalls, ofstream& summaryFile )
+    {
+        const uint64_t recordCount   = zipfian->numItems;
+        const uint64_t numOperations = GetOption( "kv-operations", PERFORMANCE_MEASUREMENT_NUM_REPEATS );
+        const uint32_t valueSize     = max<uint64_t>( GetOption( "kv-value-size", 100 ), KV_VALUE_COUNTER_SIZE );
+        const uint32_t numStripes    = GetOption( "kv-stripes",    64 );
+        const uint32_t maxScanLength = GetOption( "kv-max-scan",   YCSB_DEFAULT_MAX_SCAN );
+
+        //Every scenario starts from the same freshly loaded store, with room for its inserts
+        uint64_t capacity = recordCount;
+        if( workload->insertProportion > 0 )
+            capacity += numThreads * numOperations;
+        int ret = -1;
+        EcallKvInit( m_enclaveID, &ret, capacity, recordCount, valueSize, numStripes );
+        if( ret != 0 ) {
+            printf( "Error! Cannot load %lu records into the enclave key-value store\n", recordCount );
+            return;
+        }
+
+        vector<HotCall>      channels( numThreads );
+        vector<KvClientArgs> clientArgs( numThreads );
+        vector<pthread_t>    clientThreads( numThreads );
+        vector<uint64_t>     performaceMeasurements( numThreads * numOperations, 0 );
+        volatile bool        start        = false;
+        uint64_t             insertCursor = recordCount;
+
+        globalEnclaveID = m_enclaveID;
+        for( size_t c = 0; c < numThreads; ++c ) {
+            HotCall_init( &channels[ c ] );
+            if( hotEcalls )
+                pthread_create( &channels[ c ].responderThread, NULL, EnclaveKvResponderThread, (void*)&channels[ c ] );
+
+            clientArgs[ c ].hotCall       = hotEcalls ? &channels[ c ] : NULL;
+            clientArgs[ c ].valueSize     = valueSize;
+            clientArgs[ c ].start         = &start;
+            clientArgs[ c ].measurements  = &performaceMeasurements[ c * numOperations ];
+            clientArgs[ c ].numOperations = numOperations;
+            clientArgs[ c ].numErrors     = 0;
+            clientArgs[ c ].numNotFound   = 0;
+            YcsbGenerator_init( &clientArgs[ c ].generator, workload, zipfian, recordCount, &insertCursor,
+                                maxScanLength, c + 1 );
+            pthread_create( &clientThreads[ c ], NULL, KvClientThread, (void*)&clientArgs[ c ] );
+        }
+
+        struct timespec startTime, endTime;
+        clock_gettime( CLOCK_MONOTONIC, &startTime );
+        start = true;
+        uint64_t numErrors   = 0;
+        uint64_t numNotFound = 0;
+        for( size_t c = 0; c < numThreads; ++c ) {
+            pthread_join( clientThreads[ c ], NULL );
+            numErrors   += clientArgs[ c ].numErrors;
+            numNotFound += clientArgs[ c ].numNotFound;
+        }
+        clock_gettime( CLOCK_MONOTONIC, &endTime );
+
+        if( hotEcalls ) {
+            for( size_t c = 0; c < numThreads; ++c ) {
+                StopResponder( &channels[ c ] );
+                pthread_join( channels[ c ].responderThread, NULL );
+            }
+        }
+
+        if( numErrors > 0 )
+            printf( "Error! Data is different than expected in %lu key-value operations\n", numErrors );
+
+        double   elapsedSeconds = ( endTime.tv_sec - startTime.tv_sec ) + ( endTime.tv_nsec - startTime.tv_nsec ) * 1e-9;
+        double   opsPerSecond   = performaceMeasurements.size() / elapsedSeconds;
+        uint64_t p50            = Percentile( performaceMeasurements, 50 );
+        uint64_t p99            = Percentile( performaceMeasurements, 99 );
+        uint64_t p999           = Percentile( performaceMeasurements, 99.9 );
+        const char* mechanism   = hotEcalls ? "hot" : "sdk";
+
+        printf( "KV workload %c, %s ecalls, %lu threads: %.0f ops/s, p50 %lu p99 %lu p99.9 %lu cycles (%lu not yet inserted)\n",
+                workload->name, mechanism, numThreads, opsPerSecond, p50, p99, p999, numNotFound );
+        summaryFile << workload->name << " " << mechanism << " " << numThreads << " " << (uint64_t)opsPerSecond << " "
+                    << p50 << " " << p99 << " " << p999 << "\n";
+
+        ostringstream scenarioName;
+        scenarioName << "Kv_" << workload->name << "_" << mechanism << "_" << numThreads << "_latencies_in_cycles";
+        WriteMeasurementsToFile( scenarioName.str(),
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+    }
+
+    void TestPriorityLanes()
+    {
+        //Same traffic twice: first with every stream sharing one lane, as with a plain HotCall,
+        //then with the critical stream in lane 0 and the bulk streams in lane 1
+        RunPriorityLanesScenario( "PriorityLanes_shared",      1 );
+        RunPriorityLanesScenario( "PriorityLanes_prioritized", 2 );
+    }
+
+    void RunPriorityLanesScenario( const string& scenarioName, uint16_t numLanes )
     {
-        uint64_t performaceMeasurements[ PERFORMANCE_MEASUREMENT_NUM_REPEATS ]= {0};
+        const uint16_t criticalLane     = 0;
+        const uint16_t bulkLane         = numLanes - 1;
+        const uint64_t numBulkThreads   = GetOption( "bulk-threads",     2 );
+        const uint64_t bulkSize         = GetOption( "bulk-size",        64 * 1024 );
+        const uint64_t criticalGap      = GetOption( "critical-gap",     20000 ); //cycles between critical calls
+        const uint64_t starvationLimit  = GetOption( "starvation-limit", HOTCALL_DEFAULT_STARVATION_LIMIT );
+
+        vector<uint64_t> performaceMeasurements( PERFORMANCE_MEASUREMENT_NUM_REPEATS, 0 );
 
         uint64_t    startTime       = 0;
         uint64_t    endTime         = 0;
         int         data            = 0;
         int         expectedData    = 0;
-        HotCall     hotEcall        = HOTCALL_INITIALIZER;
-        hotEcall.data               = &data; 
+        HotLaneChannel channel;
+        HotLaneChannel_init( &channel, numLanes, starvationLimit );
 
         globalEnclaveID = m_enclaveID;
-        pthread_create(&hotEcall.responderThread, NULL, EnclaveResponderThread, (void*)&hotEcall);
+        pthread_create( &channel.responderThread, NULL, EnclaveLaneResponderThread, (void*)&channel );
+
+        volatile bool             keepRunning = true;
+        vector< vector<uint8_t> > bulkBuffers( numBulkThreads, vector<uint8_t>( bulkSize, 1 ) );
+        vector<BulkCallerArgs>    bulkArgs( numBulkThreads );
+        vector<pthread_t>         bulkThreads( numBulkThreads );
+        for( size_t t = 0; t < numBulkThreads; ++t ) {
+            bulkArgs[ t ].channel       = &channel;
+            bulkArgs[ t ].lane          = bulkLane;
+            bulkArgs[ t ].params.buffer = &bulkBuffers[ t ][ 0 ];
+            bulkArgs[ t ].params.size   = bulkSize;
+            bulkArgs[ t ].keepRunning   = &keepRunning;
+            pthread_create( &bulkThreads[ t ], NULL, BulkCallerThread, (void*)&bulkArgs[ t ] );
+        }
 
-        const uint16_t requestedCallID = 0;
         for( uint64_t i=0; i < PERFORMANCE_MEASUREMENT_NUM_REPEATS; ++i ) {
+            uint64_t gapEnd = rdtscp() + criticalGap;
+            while( rdtscp() < gapEnd )
+                _mm_pause();
+
+            //A rejected request is retried, so its latency includes the time spent waiting for the lane
             startTime = rdtscp();
-            HotCall_requestCall( &hotEcall, requestedCallID, &data );
+            while( HotLaneChannel_requestCall( &channel, criticalLane, LANE_CRITICAL_CALL_ID, &data ) == -1 )
+                ;
             endTime   = rdtscp();
-        
+
             performaceMeasurements[ i ] = endTime       - startTime;
 
             expectedData++;
@@ -308,91 +2401,257 @@ public:
             }
         }
 
-        StopResponder( &hotEcall );
-        ostringstream filename;
-        filename <<  "HotEcall_latencies_in_cycles.csv";
-        WriteMeasurementsToFile( filename.str(), 
-                                 (uint64_t*)performaceMeasurements, 
-                                 PERFORMANCE_MEASUREMENT_NUM_REPEATS ) ;
+        keepRunning = false;
+        for( size_t t = 0; t < numBulkThreads; ++t )
+            pthread_join( bulkThreads[ t ], NULL );
+        HotLaneChannel_stop( &channel );
+        pthread_join( channel.responderThread, NULL );
+
+        printf( "%s: critical p50 %lu p99 %lu cycles\n", scenarioName.c_str(),
+                Percentile( performaceMeasurements, 50 ), Percentile( performaceMeasurements, 99 ) );
+        for( uint16_t lane = 0; lane < numLanes; ++lane ) {
+            const HotLaneCounters& counters = channel.lanes[ lane ].counters;
+            printf( "  lane %u: requests %lu served %lu retries %lu rejected %lu starvation grants %lu\n",
+                    lane, counters.numRequests, counters.numServed, counters.numRetries,
+                    counters.numRejected, counters.numStarvationGrants );
+        }
+
+        WriteMeasurementsToFile( scenarioName + "_critical_latencies_in_cycles",
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
     }
 
-    void TestSDKEcalls()
+    void TestNumaPlacement()
+    {
+        //Caller and responder are pinned to the same node; only the channel moves between nodes
+        const int numCpus      = sysconf( _SC_NPROCESSORS_ONLN );
+        const int callerCpu    = GetOption( "caller-cpu", 0 );
+        const int callerNode   = SharedMemory_numaNodeOfCpu( callerCpu );
+        int       responderCpu = callerCpu;
+        for( int cpu = 0; cpu < numCpus; ++cpu ) {
+            if( cpu != callerCpu && SharedMemory_numaNodeOfCpu( cpu ) == callerNode ) {
+                responderCpu = cpu;
+                break;
+            }
+        }
+        responderCpu = GetOption( "responder-cpu", responderCpu );
+
+        int remoteNode = SharedMemory_otherNumaNode( callerNode );
+        remoteNode     = GetOption( "remote-node", remoteNode );
+
+        cpu_set_t originalAffinity;
+        pthread_getaffinity_np( pthread_self(), sizeof( originalAffinity ), &originalAffinity );
+        PinCurrentThreadToCpu( callerCpu );
+
+        printf( "Caller on cpu %d, responder on cpu %d (node %d)\n", callerCpu, responderCpu, callerNode );
+        RunNumaPlacementScenario( "NumaPlacement_local", callerNode, responderCpu );
+        if( remoteNode != callerNode )
+            RunNumaPlacementScenario( "NumaPlacement_remote", remoteNode, responderCpu );
+        else
+            printf( "Only one NUMA node, skipping remote placement\n" );
+
+        pthread_setaffinity_np( pthread_self(), sizeof( originalAffinity ), &originalAffinity );
+    }
+
+    void RunNumaPlacementScenario( const string& scenarioName, int numaNode, int responderCpu )
     {
-        uint64_t performaceMeasurements[ PERFORMANCE_MEASUREMENT_NUM_REPEATS ]= {0};
+        vector<uint64_t> performaceMeasurements( PERFORMANCE_MEASUREMENT_NUM_REPEATS, 0 );
+
+        uint64_t          startTime       = 0;
+        uint64_t          endTime         = 0;
+        int               expectedData    = 0;
+        SharedMemoryArena arena;
+        if( ! SharedMemoryArena_init( &arena, SHARED_MEMORY_HUGE_PAGE_SIZE, numaNode ) ) {
+            printf( "%s: failed to allocate shared memory\n", scenarioName.c_str() );
+            return;
+        }
 
-        uint64_t    startTime       = 0;
-        uint64_t    endTime         = 0;
-        int         data            = 0;
-        int         expectedData    = 0;
+        HotCall *hotEcall = (HotCall*)SharedMemoryArena_alloc( &arena, sizeof( HotCall ) );
+        int     *data     = (int*)    SharedMemoryArena_alloc( &arena, sizeof( int ) );
+        HotCall_init( hotEcall );
+        *data          = 0;
+        hotEcall->data = data;
 
-        globalEnclaveID = m_enclaveID;        
+        globalEnclaveID = m_enclaveID;
+        CreatePinnedThread( &hotEcall->responderThread, responderCpu, EnclaveResponderThread, (void*)hotEcall );
 
         const uint16_t requestedCallID = 0;
         for( uint64_t i=0; i < PERFORMANCE_MEASUREMENT_NUM_REPEATS; ++i ) {
             startTime = rdtscp();
-            MyCustomEcall( m_enclaveID, &data );
+            HotCall_requestCall( hotEcall, requestedCallID, data );
             endTime   = rdtscp();
-        
+
             performaceMeasurements[ i ] = endTime       - startTime;
 
             expectedData++;
-            if( data != expectedData ){
-                printf( "Error! Data is different than expected: %d != %d\n", data, expectedData );
+            if( *data != expectedData ){
+                printf( "Error! Data is different than expected: %d != %d\n", *data, expectedData );
             }
         }
 
-        ostringstream filename;
-        filename <<  "SDKEcall_latencies_in_cycles.csv";
-        WriteMeasurementsToFile( filename.str(), 
-                                 (uint64_t*)performaceMeasurements, 
-                                 PERFORMANCE_MEASUREMENT_NUM_REPEATS ) ;
+        StopResponder( hotEcall );
+        pthread_join( hotEcall->responderThread, NULL );
+
+        printf( "%s: channel on node %d (%s pages), p50 %lu p99 %lu cycles\n",
+                scenarioName.c_str(), arena.region.numaNode, arena.region.hugePages ? "huge" : "regular",
+                Percentile( performaceMeasurements, 50 ), Percentile( performaceMeasurements, 99 ) );
+        SharedMemoryArena_destroy( &arena );
+
+        WriteMeasurementsToFile( scenarioName + "_latencies_in_cycles",
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
     }
 
-    void TestHotOcalls()
+    void TestTrustedArena()
     {
-        uint64_t performaceMeasurements[ PERFORMANCE_MEASUREMENT_NUM_REPEATS ]= {0};
+        //Every responder owns a channel and an arena, and has one caller.
+        //With malloc all responders share the tlibc heap lock, with the arena they share nothing.
+        const uint64_t numResponders  = GetOption( "arena-responders", 2 );
+        const uint64_t arenaSize      = GetOption( "arena-size",       16 * 1024 * 1024 );
+        const uint64_t maxAllocSize   = GetOption( "max-alloc-size",   4096 );
+        if( maxAllocSize == 0 || maxAllocSize > UINT32_MAX ) {
+            printf( "Error! --max-alloc-size must be between 1 and %u\n", UINT32_MAX );
+            return;
+        }
 
-        OcallParams ocallParams;
-        ocallParams.counter     = 0;
-        HotCall     hotOcall    = HOTCALL_INITIALIZER;
-        hotOcall.data           = &ocallParams;
-        
-        pthread_create( &hotOcall.responderThread, NULL, OcallResponderThread, (void*)&hotOcall );
-       
-        EcallMeasureHotOcallsPerformance( 
-                m_enclaveID, 
-                (uint64_t*)performaceMeasurements, 
-                PERFORMANCE_MEASUREMENT_NUM_REPEATS,
-                &hotOcall );
-        StopResponder( &hotOcall );
+        vector<HotCall>              channels( numResponders );
+        vector<ArenaResponderArgs>   responderArgs( numResponders );
+        vector<AllocationWorkParams> warmupParams( numResponders );
 
-        ostringstream filename;
-        filename <<  "HotOcall_latencies_in_cycles.csv";
-        WriteMeasurementsToFile( filename.str(), 
-                                 (uint64_t*)performaceMeasurements, 
-                                 PERFORMANCE_MEASUREMENT_NUM_REPEATS ) ;
+        globalEnclaveID = m_enclaveID;
+        for( size_t r = 0; r < numResponders; ++r ) {
+            HotCall_init( &channels[ r ] );
+            responderArgs[ r ].hotCall   = &channels[ r ];
+            responderArgs[ r ].arenaSize = arenaSize;
+            pthread_create( &channels[ r ].responderThread, NULL, EnclaveArenaResponderThread, (void*)&responderArgs[ r ] );
+
+            //Returns once the responder finished pre-touching its arena and is polling
+            warmupParams[ r ].numAllocations = 1;
+            warmupParams[ r ].maxSize        = 1;
+            HotCall_requestCall( &channels[ r ], ALLOC_ARENA_CALL_ID, &warmupParams[ r ] );
+        }
+
+        uint64_t mallocChecksum = RunAllocationScenario( "TrustedArena_malloc", channels, ALLOC_MALLOC_CALL_ID );
+        uint64_t arenaChecksum  = RunAllocationScenario( "TrustedArena_arena",  channels, ALLOC_ARENA_CALL_ID );
+        if( mallocChecksum != arenaChecksum )
+            printf( "Error! Arena checksum is different than malloc checksum: %lu != %lu\n", arenaChecksum, mallocChecksum );
+
+        for( size_t r = 0; r < numResponders; ++r ) {
+            StopResponder( &channels[ r ] );
+            pthread_join( channels[ r ].responderThread, NULL );
+        }
     }
 
-    void TestSDKOcalls()
+    uint64_t RunAllocationScenario( const string& scenarioName, vector<HotCall>& channels, uint16_t callID )
     {
-        uint64_t performaceMeasurements[ PERFORMANCE_MEASUREMENT_NUM_REPEATS ]= {0};
+        const uint64_t numAllocations = GetOption( "allocations",    64 );
+        const uint64_t maxSize        = GetOption( "max-alloc-size", 4096 );
+        const size_t   numCallers     = channels.size();
+
+        vector<uint64_t>             performaceMeasurements( numCallers * PERFORMANCE_MEASUREMENT_NUM_REPEATS, 0 );
+        vector<AllocationCallerArgs> callerArgs( numCallers );
+        vector<pthread_t>            callerThreads( numCallers );
+        for( size_t c = 0; c < numCallers; ++c ) {
+            callerArgs[ c ].hotCall                 = &channels[ c ];
+            callerArgs[ c ].callID                  = callID;
+            callerArgs[ c ].params.numAllocations   = numAllocations;
+            callerArgs[ c ].params.maxSize          = maxSize;
+            callerArgs[ c ].params.checksum         = 0;
+            callerArgs[ c ].measurements            = &performaceMeasurements[ c * PERFORMANCE_MEASUREMENT_NUM_REPEATS ];
+            callerArgs[ c ].numMeasurements         = PERFORMANCE_MEASUREMENT_NUM_REPEATS;
+            pthread_create( &callerThreads[ c ], NULL, AllocationCallerThread, (void*)&callerArgs[ c ] );
+        }
 
-        OcallParams ocallParams;
-        ocallParams.counter     = 0;
-        HotCall     hotOcall    = HOTCALL_INITIALIZER;
-        hotOcall.data           = &ocallParams;
-        
-        EcallMeasureSDKOcallsPerformance( 
-                m_enclaveID, 
-                (uint64_t*)performaceMeasurements, 
-                PERFORMANCE_MEASUREMENT_NUM_REPEATS,
-                &ocallParams );
-        
-        ostringstream filename;
-        filename <<  "SDKOcall_latencies_in_cycles.csv";
-        WriteMeasurementsToFile( filename.str(), 
-                                 (uint64_t*)performaceMeasurements, 
-                                 PERFORMANCE_MEASUREMENT_NUM_REPEATS ) ;
+        for( size_t c = 0; c < numCallers; ++c )
+            pthread_join( callerThreads[ c ], NULL );
+
+        printf( "%s: %lu responders, %lu allocations per call, p50 %lu p99 %lu cycles\n",
+                scenarioName.c_str(), (uint64_t)numCallers, numAllocations,
+                Percentile( performaceMeasurements, 50 ), Percentile( performaceMeasurements, 99 ) );
+
+        WriteMeasurementsToFile( scenarioName + "_latencies_in_cycles",
+                                 &performaceMeasurements[ 0 ],
+                                 performaceMeasurements.size() );
+
+        return callerArgs[ 0 ].params.checksum;
+    }
+
+    void TestSpinlockContention()
+    {
+        printf( "HotCall protocol is built with the %s lock\n", HOTSPIN_LOCK_NAME );
+
+        const uint64_t maxThreads = GetOption( "max-lock-threads", sysconf( _SC_NPROCESSORS_ONLN ) );
+        HotSpinTTAS    ttas       = HOTSPIN_TTAS_INITIALIZER;
+        HotSpinTicket  ticket     = HOTSPIN_TICKET_INITIALIZER;
+        HotSpinMCS     mcs        = HOTSPIN_MCS_INITIALIZER;
+        SpinlockUnderTest spinlocks[] = {
+            { "TTAS",   &ttas,   AcquireTTAS,   ReleaseTTAS   },
+            { "Ticket", &ticket, AcquireTicket, ReleaseTicket },
+            { "MCS",    &mcs,    AcquireMCS,    ReleaseMCS    },
+        };
+
+        for( size_t l = 0; l < sizeof( spinlocks ) / sizeof( spinlocks[ 0 ] ); ++l ) {
+            for( uint64_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+                RunSpinlockScenario( &spinlocks[ l ], numThreads );
+        }
+    }
+
+    void RunSpinlockScenario( SpinlockUnderTest* spinlock, uint64_t numThreads )
+    {
+        //Threads are pinned one per cpu; oversubscribing a FIFO spinlock measures the scheduler, not the lock
+        const int      numCpus          = sysconf( _SC_NPROCESSORS_ONLN );
+        const uint64_t durationMs       = GetOption( "lock-duration-ms", 200 );
+        const uint64_t criticalSection  = GetOption( "critical-section", 10 );
+
+        volatile bool                 start = false;
+        volatile bool                 stop  = false;
+        vector<SpinlockContenderArgs> contenderArgs( numThreads );
+        vector<pthread_t>             contenderThreads( numThreads );
+        for( size_t t = 0; t < numThreads; ++t ) {
+            contenderArgs[ t ].spinlock              = spinlock;
+            contenderArgs[ t ].start                 = &start;
+            contenderArgs[ t ].stop                  = &stop;
+            contenderArgs[ t ].criticalSectionPauses = criticalSection;
+            contenderArgs[ t ].numAcquisitions       = 0;
+            CreatePinnedThread( &contenderThreads[ t ], t % numCpus, SpinlockContenderThread, (void*)&contenderArgs[ t ] );
+        }
+
+        start = true;
+        usleep( durationMs * 1000 );
+        stop  = true;
+
+        vector<uint64_t> acquireLatencies;
+        vector<uint64_t> acquisitionsPerThread( numThreads, 0 );
+        double           sumAcquisitions        = 0;
+        double           sumSquaredAcquisitions = 0;
+        for( size_t t = 0; t < numThreads; ++t ) {
+            pthread_join( contenderThreads[ t ], NULL );
+            acquireLatencies.insert( acquireLatencies.end(),
+                                     contenderArgs[ t ].acquireLatencies.begin(),
+                                     contenderArgs[ t ].acquireLatencies.end() );
+            acquisitionsPerThread[ t ] = contenderArgs[ t ].numAcquisitions;
+            sumAcquisitions           += acquisitionsPerThread[ t ];
+            sumSquaredAcquisitions    += (double)acquisitionsPerThread[ t ] * acquisitionsPerThread[ t ];
+        }
+
+        //Jain's index: 1.0 when every thread got the lock equally often, 1/n when one thread got it every time
+        double jainIndex  = sumSquaredAcquisitions > 0 ? sumAcquisitions * sumAcquisitions / ( numThreads * sumSquaredAcquisitions ) : 0;
+        uint64_t minCount = *min_element( acquisitionsPerThread.begin(), acquisitionsPerThread.end() );
+        uint64_t maxCount = *max_element( acquisitionsPerThread.begin(), acquisitionsPerThread.end() );
+        printf( "%-6s %3lu threads: %10.0f acquisitions, acquire p50 %6lu p99 %8lu cycles, Jain %.3f, min/max %.3f\n",
+                spinlock->name, numThreads, sumAcquisitions,
+                Percentile( acquireLatencies, 50 ), Percentile( acquireLatencies, 99 ),
+                jainIndex, maxCount > 0 ? (double)minCount / maxCount : 0 );
+
+        ostringstream scenarioName;
+        scenarioName << "Spinlock_" << spinlock->name << "_" << numThreads << "threads";
+        WriteMeasurementsToFile( scenarioName.str() + "_acquire_latencies_in_cycles",
+                                 &acquireLatencies[ 0 ],
+                                 acquireLatencies.size() );
+        WriteMeasurementsToFile( scenarioName.str() + "_acquisitions_per_thread",
+                                 &acquisitionsPerThread[ 0 ],
+                                 acquisitionsPerThread.size(),
+                                 true );
     }
 
 private:
@@ -401,30 +2660,347 @@ private:
 
     int              m_sgxDriver;
     string           m_measurementsDir;
+    map<string, string> m_options;
+    uint64_t         m_numRepeats;
+    MeasurementHeader m_metadata;   //Copied into the header of every measurement column
+
+    //Median and 99th percentile of every measurement file written in this run, in order
+    struct ProfileEntry {
+        string      name;
+        uint64_t    median;
+        uint64_t    p99;
+    };
+    vector<ProfileEntry> m_profile;
+
+    //Event counts of every test run with --perf, in order
+    struct PerfCountEntry {
+        string      test;
+        string      scope;
+        string      counter;
+        string      event;
+        uint64_t    value;
+        bool        valid;
+    };
+    vector<PerfCountEntry> m_perfCounts;
+
+    //--classify-outliers: counts the context switches of the caller and the responder around
+    //every sample, outside the timed region, and charges each sample above outlier-factor x
+    //median to the scheduler or, when neither thread was switched out, to interrupts/AEX/SMIs
+    class OutlierClassifier {
+    public:
+        OutlierClassifier( HotCallsTester* tester, const string& prefix, uint64_t numSamples, pid_t responderTid )
+            : m_tester( tester ), m_prefix( prefix ), m_enabled( tester->GetOption( "classify-outliers", 0 ) != 0 )
+        {
+            if( ! m_enabled )
+                return;
+
+            if( ! SwitchProbe_open( &m_probe, responderTid ) )
+                printf( "Warning: cannot read the context switches of responder %d\n", (int)responderTid );
+            m_callerSwitches.resize( numSamples );
+            m_responderSwitches.resize( numSamples );
+        }
+
+        ~OutlierClassifier()
+        {
+            if( m_enabled )
+                SwitchProbe_close( &m_probe );
+        }
+
+        inline void BeforeSample()
+        {
+            if( m_enabled )
+                SwitchProbe_read( &m_probe, &m_before );
+        }
+
+        inline void AfterSample( uint64_t sampleIdx )
+        {
+            if( ! m_enabled )
+                return;
+
+            SwitchCounts after;
+            SwitchProbe_read( &m_probe, &after );
+            m_callerSwitches[ sampleIdx ]    = after.callerSwitches    - m_before.callerSwitches;
+            m_responderSwitches[ sampleIdx ] = after.responderSwitches - m_before.responderSwitches;
+        }
+
+        //Writes the switch columns and appends the counts of every class to outliers.txt
+        void Classify( const uint64_t* latencies )
+        {
+            if( ! m_enabled )
+                return;
+
+            const uint64_t numSamples = m_callerSwitches.size();
+            vector<uint64_t> samples( latencies, latencies + numSamples );
+            const uint64_t threshold  = Percentile( samples, 50 ) * m_tester->GetOption( "outlier-factor", 10 );
+
+            uint64_t numOutliers = 0, numCaller = 0, numResponder = 0, numBoth = 0, numUnexplained = 0;
+            for( uint64_t i = 0; i < numSamples; ++i ) {
+                if( latencies[ i ] <= threshold )
+                    continue;
+
+                numOutliers++;
+                if( m_callerSwitches[ i ] != 0 && m_responderSwitches[ i ] != 0 )
+                    numBoth++;
+                else if( m_callerSwitches[ i ] != 0 )
+                    numCaller++;
+                else if( m_responderSwitches[ i ] != 0 )
+                    numResponder++;
+                else
+                    numUnexplained++;
+            }
+
+            printf( "%s outliers above %lu cycles: %lu of %lu, caller preempted %lu, responder switched out %lu, both %lu, "
+                    "unexplained (interrupt/AEX/SMI) %lu\n", m_prefix.c_str(), threshold, numOutliers, numSamples,
+                    numCaller, numResponder, numBoth, numUnexplained );
+
+            m_tester->WriteMeasurementsToFile( m_prefix + "_caller_switches",    &m_callerSwitches[ 0 ],    numSamples );
+            m_tester->WriteMeasurementsToFile( m_prefix + "_responder_switches", &m_responderSwitches[ 0 ], numSamples );
+
+            string summaryPath = m_tester->m_measurementsDir + "/outliers.txt";
+            bool   newFile     = access( summaryPath.c_str(), F_OK ) != 0;
+            FILE*  summaryFile = fopen( summaryPath.c_str(), "a" );
+            if( summaryFile == NULL ) {
+                printf( "Error! Cannot write %s\n", summaryPath.c_str() );
+                return;
+            }
+            if( newFile )
+                fprintf( summaryFile, "# test threshold samples outliers caller responder both unexplained\n" );
+            fprintf( summaryFile, "%s %lu %lu %lu %lu %lu %lu %lu\n", m_prefix.c_str(), threshold, numSamples,
+                     numOutliers, numCaller, numResponder, numBoth, numUnexplained );
+            fclose( summaryFile );
+        }
+
+    private:
+        HotCallsTester*     m_tester;
+        string              m_prefix;
+        bool                m_enabled;
+        SwitchProbe         m_probe;
+        SwitchCounts        m_before;
+        vector<uint64_t>    m_callerSwitches;
+        vector<uint64_t>    m_responderSwitches;
+    };
+
+    uint64_t GetOption( const string& name, uint64_t defaultValue ) const
+    {
+        map<string, string>::const_iterator it = m_options.find( name );
+        if( it == m_options.end() )
+            return defaultValue;
+
+        return strtoull( it->second.c_str(), NULL, 0 );
+    }
+
+    string GetStringOption( const string& name, const string& defaultValue ) const
+    {
+        map<string, string>::const_iterator it = m_options.find( name );
+        if( it == m_options.end() )
+            return defaultValue;
+
+        return it->second;
+    }
+
+    void ConfigureRealtimeIsolation()
+    {
+        RealtimeIsolationConfig config;
+        RealtimeIsolation_defaultConfig( &config );
+
+        config.enabled      = GetOption( "rt", 0 ) != 0;
+        config.priority     = GetOption( "rt-priority",      config.priority );
+        config.callerCpu    = GetOption( "rt-caller-cpu",    config.callerCpu );
+        config.responderCpu = GetOption( "rt-responder-cpu", config.responderCpu );
+        if( ! RealtimeIsolation_configure( &config ) )
+            throw HotCallsTesterError();
+
+        if( config.enabled )
+            printf( "Real-time isolation: SCHED_FIFO priority %d, caller on cpu %d, responders on cpu %d\n",
+                    config.priority, config.callerCpu, config.responderCpu );
+    }
+
+    void ConfigureTransitionEmulation()
+    {
+        TransitionEmulationConfig config;
+        TransitionEmulation_defaultConfig( &config );
+
+        config.enabled           = GetOption( "emulate-transitions", 0 ) != 0;
+        config.enterCycles       = GetOption( "eenter-cycles", config.enterCycles );
+        config.exitCycles        = GetOption( "eexit-cycles",  config.exitCycles );
+        config.flushBytes        = GetOption( "flush-bytes",   config.flushBytes );
+        config.tlbPages          = GetOption( "tlb-pages",     config.tlbPages );
+        config.aexIntervalCycles = GetOption( "aex-interval",  config.aexIntervalCycles );
+        config.aexCycles         = GetOption( "aex-cycles",    config.aexCycles );
+        TransitionEmulation_configure( &config );
+
+        if( ! config.enabled )
+            return;
+
+        printf( "Transition emulation: EENTER %lu EEXIT %lu cycles, flush %lu bytes + %lu pages, AEX %lu cycles every %lu\n",
+                config.enterCycles, config.exitCycles, config.flushBytes, config.tlbPages,
+                config.aexCycles, config.aexIntervalCycles );
+        if( strcmp( HOTCALLS_SGX_MODE, "HW" ) == 0 )
+            printf( "Warning: transition emulation is meant for SGX_MODE=SIM, on hardware it adds to the real cost\n" );
+    }
+
+    //profile.txt: one line per measurement, "<name> <median> <p99>", after '#' header lines
+    void WriteProfile()
+    {
+        if( m_profile.empty() )
+            return;
+
+        string fileFullPath = m_measurementsDir + "/profile.txt";
+        ofstream profileFile( fileFullPath.c_str() );
+        profileFile << "# sgx-mode " << HOTCALLS_SGX_MODE << "\n";
+        profileFile << "# transition-emulation " << ( TransitionEmulation_isEnabled() ? "on" : "off" ) << "\n";
+        for( size_t i = 0; i < m_profile.size(); ++i )
+            profileFile << m_profile[ i ].name << " " << m_profile[ i ].median << " " << m_profile[ i ].p99 << "\n";
+
+        cout << "Profile written to " << fileFullPath << "\n";
+    }
+
+    void CompareWithReferenceProfile( const string& path )
+    {
+        ifstream referenceFile( path.c_str() );
+        if( ! referenceFile.is_open() ) {
+            printf( "Error! Cannot open reference profile %s\n", path.c_str() );
+            return;
+        }
+
+        map<string, uint64_t> referenceMedians;
+        string line;
+        while( getline( referenceFile, line ) ) {
+            if( line.empty() || line[ 0 ] == '#' )
+                continue;
+
+            istringstream fields( line );
+            string   name;
+            uint64_t median = 0;
+            if( fields >> name >> median )
+                referenceMedians[ name ] = median;
+        }
+
+        map<string, uint64_t> medians;
+        for( size_t i = 0; i < m_profile.size(); ++i )
+            medians[ m_profile[ i ].name ] = m_profile[ i ].median;
+
+        printf( "Comparison with reference profile %s (medians, cycles)\n", path.c_str() );
+        printf( "%-56s %12s %12s %8s\n", "measurement", "reference", "this run", "ratio" );
+        for( size_t i = 0; i < m_profile.size(); ++i ) {
+            map<string, uint64_t>::const_iterator it = referenceMedians.find( m_profile[ i ].name );
+            if( it == referenceMedians.end() || it->second == 0 )
+                continue;
+
+            printf( "%-56s %12lu %12lu %8.2f\n", m_profile[ i ].name.c_str(), it->second,
+                    m_profile[ i ].median, (double)m_profile[ i ].median / it->second );
+        }
+
+        //What the emulation is meant to predict: how much faster hot calls are than SDK calls
+        for( map<string, uint64_t>::const_iterator it = medians.begin(); it != medians.end(); ++it ) {
+            if( it->first.compare( 0, 3, "SDK" ) != 0 )
+                continue;
+
+            string hotName = "Hot" + it->first.substr( 3 );
+            if( medians.count( hotName ) == 0 || referenceMedians.count( hotName ) == 0 ||
+                referenceMedians.count( it->first ) == 0 )
+                continue;
+            if( medians[ hotName ] == 0 || referenceMedians[ hotName ] == 0 )
+                continue;
+
+            printf( "%s / %s speedup: reference %.2fx, this run %.2fx\n", it->first.c_str(), hotName.c_str(),
+                    (double)referenceMedians[ it->first ] / referenceMedians[ hotName ],
+                    (double)it->second / medians[ hotName ] );
+        }
+    }
 
-    void WriteMeasurementsToFile( string fileName, uint64_t* measurementsMatrix, size_t numRows )
+    static uint64_t Percentile( vector<uint64_t> samples, double percentile )
     {
-        string fileFullPath = m_measurementsDir + "/" + fileName;
+        if( samples.empty() )
+            return 0;
+
+        size_t idx = (size_t)( percentile / 100.0 * ( samples.size() - 1 ) );
+        nth_element( samples.begin(), samples.begin() + idx, samples.end() );
+        return samples[ idx ];
+    }
+
+    void CollectMetadata()
+    {
+        MeasurementHeader_collect( &m_metadata, HOTCALLS_SGX_MODE, HOTCALLS_BUILD_FLAGS );
+        MeasurementHeader_addExtra( &m_metadata, "transition-emulation", TransitionEmulation_isEnabled() ? "on" : "off" );
+        RealtimeIsolation_describe( &m_metadata );
+        for( map<string, string>::const_iterator it = m_options.begin(); it != m_options.end(); ++it )
+            MeasurementHeader_addExtra( &m_metadata, ( "option." + it->first ).c_str(), it->second.c_str() );
+    }
+
+    //Samples are stored straight into the mapped, pre-faulted column; nothing is written
+    //to disk until CloseMeasurementColumn, outside the measured loop
+    //Throws HotCallsTesterError, which skips the test: only open columns this way before the
+    //test starts any thread
+    MeasurementColumn OpenMeasurementColumn( const string& name, uint64_t capacity )
+    {
+        MeasurementColumn column;
+        if( ! TryOpenMeasurementColumn( name, capacity, &column ) )
+            throw HotCallsTesterError();
+
+        return column;
+    }
+
+    //Reports the error and returns false instead
+    bool TryOpenMeasurementColumn( const string& name, uint64_t capacity, MeasurementColumn* column )
+    {
+        string path = m_measurementsDir + "/" + name + MEASUREMENT_STORE_EXTENSION;
+        if( ! MeasurementColumn_create( column, path.c_str(), name.c_str(), capacity, &m_metadata ) ) {
+            printf( "Error! Cannot create measurement column %s\n", path.c_str() );
+            return false;
+        }
+
+        return true;
+    }
+
+    void CloseMeasurementColumn( MeasurementColumn* column, uint64_t numRows )
+    {
+        string name = column->header->fields.name;
         cout << "Writing results.. ";
-        cout << fileFullPath << " ";
-        ofstream measurementsFile;
-        measurementsFile.open( fileFullPath, ios::app );
-        for( size_t rowIdx = 0; rowIdx < numRows; ++rowIdx ) {
-            measurementsFile << measurementsMatrix[ rowIdx ] << " ";
-            measurementsFile << "\n";
+        cout << m_measurementsDir << "/" << name << MEASUREMENT_STORE_EXTENSION << " ";
+
+        vector<uint64_t> samples( column->rows, column->rows + numRows );
+        ProfileEntry entry;
+        entry.name   = name;
+        entry.median = Percentile( samples, 50 );
+        entry.p99    = Percentile( samples, 99 );
+        m_profile.push_back( entry );
+
+        if( GetOption( "csv", 0 ) != 0 ) {
+            column->header->fields.numRows = numRows;
+            string csvPath = m_measurementsDir + "/" + name + ".csv";
+            if( ! MeasurementColumn_exportCsv( column, csvPath.c_str() ) )
+                printf( "Error! Cannot write %s\n", csvPath.c_str() );
         }
-        
-        measurementsFile.close();
+
+        MeasurementColumn_close( column, numRows );
 
         cout << "Done\n";
     }
 
+    //For measurements collected elsewhere (per-thread vectors, enclave counters). Often called
+    //while responders still run, so a column that cannot be created is reported and skipped.
+    //higherIsBetter marks throughput columns for hotcalls_compare.
+    void WriteMeasurementsToFile( const string& name, uint64_t* measurementsMatrix, size_t numRows,
+                                  bool higherIsBetter = false )
+    {
+        MeasurementColumn column;
+        if( ! TryOpenMeasurementColumn( name, numRows, &column ) )
+            return;
+
+        if( higherIsBetter )
+            MeasurementHeader_addExtra( column.header, MEASUREMENT_BETTER_KEY, MEASUREMENT_HIGHER_IS_BETTER );
+
+        memcpy( column.rows, measurementsMatrix, numRows * sizeof( uint64_t ) );
+        CloseMeasurementColumn( &column, numRows );
+    }
+
     /* Initialize the enclave:
      *   Step 1: try to retrieve the launch token saved by last transaction
      *   Step 2: call sgx_create_enclave to initialize an enclave instance
      *   Step 3: save the launch token if it is updated
      */
-    int initialize_enclave(void)
+    int initialize_enclave( const char* enclaveFilename, const char* tokenFilename, sgx_enclave_id_t* enclaveID )
     {
         char token_path[MAX_PATH] = {'\0'};
         sgx_launch_token_t token = {0};
@@ -438,14 +3014,14 @@ private:
         const char *home_dir = getpwuid(getuid())->pw_dir;
         
         if (home_dir != NULL && 
-            (strlen(home_dir)+strlen("/")+sizeof(TOKEN_FILENAME)+1) <= MAX_PATH) {
+            (strlen(home_dir)+strlen("/")+strlen(tokenFilename)+2) <= MAX_PATH) {
             /* compose the token path */
             strncpy(token_path, home_dir, strlen(home_dir));
             strncat(token_path, "/", strlen("/"));
-            strncat(token_path, TOKEN_FILENAME, sizeof(TOKEN_FILENAME)+1);
+            strncat(token_path, tokenFilename, strlen(tokenFilename)+1);
         } else {
             /* if token path is too long or $HOME is NULL */
-            strncpy(token_path, TOKEN_FILENAME, sizeof(TOKEN_FILENAME));
+            strncpy(token_path, tokenFilename, MAX_PATH-1);
         }
         
         FILE *fp = fopen(token_path, "rb");
@@ -465,7 +3041,7 @@ private:
         
         /* Step 2: call sgx_create_enclave to initialize an enclave instance */
         /* Debug Support: set 2nd parameter to 1 */
-        ret = sgx_create_enclave(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token, &updated, &m_enclaveID, NULL);
+        ret = sgx_create_enclave(enclaveFilename, SGX_DEBUG_FLAG, &token, &updated, enclaveID, NULL);
         if (ret != SGX_SUCCESS) {
             printf("sgx_create_enclave returned 0x%x\n", ret);
             print_error_message(ret);
@@ -530,11 +3106,35 @@ private:
 /* Application entry */
 int SGX_CDECL main(int argc, char *argv[])
 {
-    (void)(argc);
-    (void)(argv);
+    //Arguments are test names, or options in the form --name=value
+    map<string, string> options;
+    vector<string>      testNames;
+    for( int i = 1; i < argc; ++i ) {
+        string arg = argv[ i ];
+        if( arg == "--help" ) {
+            HotCallsTester::PrintUsage();
+            return 0;
+        }
+
+        if( arg.compare( 0, 2, "--" ) != 0 ) {
+            testNames.push_back( arg );
+            continue;
+        }
 
-    HotCallsTester hotCallsTester;
-    hotCallsTester.Run();
+        size_t separator = arg.find( '=' );
+        if( separator == string::npos )
+            options[ arg.substr( 2 ) ] = "1";
+        else
+            options[ arg.substr( 2, separator - 2 ) ] = arg.substr( separator + 1 );
+    }
+
+    try {
+        HotCallsTester hotCallsTester( options );
+        hotCallsTester.Run( testNames );
+    }
+    catch( const HotCallsTesterError& ) {
+        return 1;
+    }
 
     return 0;
 }
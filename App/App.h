@@ -76,6 +76,9 @@
 # define TOKEN_FILENAME   "enclave.token"
 # define ENCLAVE_FILENAME "enclave.signed.so"
 
+# define PEER_TOKEN_FILENAME   "peer_enclave.token"
+# define PEER_ENCLAVE_FILENAME "peer_enclave.signed.so"
+
 extern sgx_enclave_id_t global_eid;    /* global enclave id */
 
 #if defined(__cplusplus)
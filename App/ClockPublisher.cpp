@@ -0,0 +1,152 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <string.h>
+#include <time.h>
+
+#include "ClockPublisher.h"
+#include "SharedMemory.h"
+
+#define CLOCK_PUBLISHER_CALIBRATION_NS      10000000
+#define CLOCK_PUBLISHER_RATE_INTERVAL_NS    1000000000ULL
+#define CLOCK_PUBLISHER_MAX_ANCHOR_TSC      20000
+#define CLOCK_PUBLISHER_ANCHOR_TRIES        16
+
+static inline uint64_t ReadTsc( void )
+{
+    unsigned int low, high;
+
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+
+    return low | ((uint64_t)high) << 32;
+}
+
+static uint64_t NowNs( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//Pairs a TSC value with CLOCK_MONOTONIC by bracketing clock_gettime between two RDTSCs and
+//taking the midpoint. A wide bracket means the thread was preempted or interrupted between
+//the reads, so the narrowest of several tries is kept and the round is repeated until one is
+//within CLOCK_PUBLISHER_MAX_ANCHOR_TSC ticks.
+static void ReadAnchor( uint64_t* tsc, uint64_t* ns )
+{
+    uint64_t bestWindow = UINT64_MAX;
+
+    while( bestWindow > CLOCK_PUBLISHER_MAX_ANCHOR_TSC ) {
+        for( int i = 0; i < CLOCK_PUBLISHER_ANCHOR_TRIES; ++i ) {
+            uint64_t before = ReadTsc();
+            uint64_t now    = NowNs();
+            uint64_t after  = ReadTsc();
+            if( after - before < bestWindow ) {
+                bestWindow = after - before;
+                *tsc       = before + bestWindow / 2;
+                *ns        = now;
+            }
+        }
+    }
+}
+
+static void Publish( HotClockPage* page, uint64_t tsc, uint64_t ns )
+{
+    uint32_t sequence = page->sequence;
+
+    __atomic_store_n( &page->sequence, sequence + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    __atomic_store_n( &page->tsc, tsc, __ATOMIC_RELAXED );
+    __atomic_store_n( &page->ns,  ns,  __ATOMIC_RELAXED );
+    __atomic_store_n( &page->sequence, sequence + 2, __ATOMIC_RELEASE );
+}
+
+static void* PublisherThread( void* publisherAsVoidP )
+{
+    ClockPublisher* publisher = (ClockPublisher*)publisherAsVoidP;
+    HotClockPage*   page      = publisher->page;
+
+    //Initial rate from a short calibration between two bracketed anchors. The rate is only
+    //refined over CLOCK_PUBLISHER_RATE_INTERVAL_NS afterwards: anchor jitter over a short
+    //interval would skew it far more than the TSC drifts.
+    uint64_t rateTsc, rateNs;
+    ReadAnchor( &rateTsc, &rateNs );
+    while( NowNs() - rateNs < CLOCK_PUBLISHER_CALIBRATION_NS )
+        ;
+    uint64_t anchorTsc, anchorNs;
+    ReadAnchor( &anchorTsc, &anchorNs );
+    double   nsPerTsc  = (double)( anchorNs - rateNs ) / ( anchorTsc - rateTsc );
+    uint64_t lastNs    = anchorNs;
+
+    Publish( page, anchorTsc, anchorNs );
+    __atomic_store_n( &page->publisherRunning, true, __ATOMIC_RELEASE );
+
+    uint64_t update = 0;
+    while( publisher->keepPublishing ) {
+        uint64_t tsc;
+        uint64_t ns;
+
+        if( ++update % CLOCK_PUBLISHER_ANCHOR_INTERVAL == 0 ) {
+            ReadAnchor( &anchorTsc, &anchorNs );
+            if( anchorNs - rateNs >= CLOCK_PUBLISHER_RATE_INTERVAL_NS ) {
+                nsPerTsc = (double)( anchorNs - rateNs ) / ( anchorTsc - rateTsc );
+                rateTsc  = anchorTsc;
+                rateNs   = anchorNs;
+            }
+            tsc = anchorTsc;
+            ns  = anchorNs;
+        }
+        else {
+            tsc = ReadTsc();
+            ns  = anchorNs + (uint64_t)( ( tsc - anchorTsc ) * nsPerTsc );
+        }
+
+        //Extrapolation error must not make the published time go backwards
+        if( ns < lastNs )
+            ns = lastNs;
+        lastNs = ns;
+
+        Publish( page, tsc, ns );
+    }
+
+    publisher->numUpdates = update;
+    return NULL;
+}
+
+bool ClockPublisher_start( ClockPublisher* publisher, HotClockPage* page, int cpu )
+{
+    memset( page, 0, sizeof( HotClockPage ) );
+    publisher->page           = page;
+    publisher->keepPublishing = true;
+    publisher->numUpdates     = 0;
+
+    if( CreatePinnedThread( &publisher->thread, cpu, PublisherThread, publisher ) != 0 )
+        return false;
+
+    while( ! __atomic_load_n( &page->publisherRunning, __ATOMIC_ACQUIRE ) )
+        __asm__ __volatile__( "pause" ::: "memory" );
+
+    return true;
+}
+
+void ClockPublisher_stop( ClockPublisher* publisher )
+{
+    __atomic_store_n( &publisher->page->publisherRunning, false, __ATOMIC_RELEASE );
+    publisher->keepPublishing = false;
+    pthread_join( publisher->thread, NULL );
+}
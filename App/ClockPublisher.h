@@ -0,0 +1,47 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Publisher side of the clock page (include/hot_clock.h). The publisher thread spins,
+//writing the TSC on every update. The ns time is extrapolated from the TSC and
+//re-anchored to CLOCK_MONOTONIC every CLOCK_PUBLISHER_ANCHOR_INTERVAL updates, so an
+//update costs about one RDTSC and the page keeps close to TSC resolution. The TSC rate
+//is measured over about a second between anchors, never over a single anchor interval.
+
+#ifndef _CLOCK_PUBLISHER_H_
+#define _CLOCK_PUBLISHER_H_
+
+#include <pthread.h>
+
+#include "../include/hot_clock.h"
+
+#define CLOCK_PUBLISHER_ANCHOR_INTERVAL 4096
+
+typedef struct {
+    HotClockPage*   page;
+    pthread_t       thread;
+    volatile bool   keepPublishing;
+    uint64_t        numUpdates;
+} ClockPublisher;
+
+//Starts publishing into page from a thread pinned to cpu (unpinned for cpu < 0), and
+//returns once the first update is visible. Returns false if the thread could not start.
+bool ClockPublisher_start( ClockPublisher* publisher, HotClockPage* page, int cpu );
+//Stops the thread; readers get HOTCLOCK_ERROR_STOPPED from then on
+void ClockPublisher_stop( ClockPublisher* publisher );
+
+#endif /* !_CLOCK_PUBLISHER_H_ */
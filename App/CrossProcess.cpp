@@ -0,0 +1,317 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "CrossProcess.h"
+#include "SharedChannels.h"
+
+typedef struct {
+    uint64_t    failed;
+    uint64_t    numErrors;
+    uint64_t    elapsedNs;
+} CrossProcessResult;
+
+static inline uint64_t ReadTscp( void )
+{
+    unsigned int low, high;
+
+    asm volatile("rdtscp" : "=a" (low), "=d" (high) : : "rcx");
+
+    return low | ((uint64_t)high) << 32;
+}
+
+static uint64_t NowNs( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static bool WriteAll( int fd, const void* buffer, size_t size )
+{
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    while( size > 0 ) {
+        ssize_t written = write( fd, bytes, size );
+        if( written <= 0 )
+            return false;
+        bytes += written;
+        size  -= written;
+    }
+    return true;
+}
+
+static bool ReadAll( int fd, void* buffer, size_t size )
+{
+    uint8_t* bytes = (uint8_t*)buffer;
+    while( size > 0 ) {
+        ssize_t numRead = read( fd, bytes, size );
+        if( numRead <= 0 )
+            return false;
+        bytes += numRead;
+        size  -= numRead;
+    }
+    return true;
+}
+
+static bool SocketAddress( struct sockaddr_un* address, const char* path )
+{
+    memset( address, 0, sizeof( *address ) );
+    address->sun_family = AF_UNIX;
+    if( strlen( path ) >= sizeof( address->sun_path ) )
+        return false;
+    strcpy( address->sun_path, path );
+    return true;
+}
+
+// ---------- socket forwarder ----------
+
+typedef struct {
+    int     fd;
+    void    (*forward)( void* data );
+} ForwarderConnection;
+
+static void* ForwarderConnectionThread( void* connectionAsVoidP )
+{
+    ForwarderConnection connection = *(ForwarderConnection*)connectionAsVoidP;
+    delete (ForwarderConnection*)connectionAsVoidP;
+
+    int data;
+    while( ReadAll( connection.fd, &data, sizeof( data ) ) ) {
+        connection.forward( &data );
+        if( ! WriteAll( connection.fd, &data, sizeof( data ) ) )
+            break;
+    }
+    close( connection.fd );
+
+    return NULL;
+}
+
+static void* ForwarderAcceptThread( void* forwarderAsVoidP )
+{
+    SocketForwarder *forwarder = (SocketForwarder*)forwarderAsVoidP;
+    while( true ) {
+        int fd = accept( forwarder->listenFd, NULL, NULL );
+        if( fd < 0 )
+            break;
+
+        ForwarderConnection* connection = new ForwarderConnection;
+        connection->fd      = fd;
+        connection->forward = forwarder->forward;
+
+        pthread_t thread;
+        if( pthread_create( &thread, NULL, ForwarderConnectionThread, connection ) != 0 ) {
+            close( fd );
+            delete connection;
+            continue;
+        }
+        pthread_detach( thread );
+    }
+
+    return NULL;
+}
+
+bool SocketForwarder_start( SocketForwarder* forwarder, const char* path, void (*forward)( void* data ) )
+{
+    struct sockaddr_un address;
+    if( ! SocketAddress( &address, path ) )
+        return false;
+
+    snprintf( forwarder->path, sizeof( forwarder->path ), "%s", path );
+    forwarder->forward  = forward;
+    forwarder->listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( forwarder->listenFd < 0 )
+        return false;
+
+    unlink( path );
+    if( bind( forwarder->listenFd, (struct sockaddr*)&address, sizeof( address ) ) != 0 ||
+        listen( forwarder->listenFd, CROSS_PROCESS_MAX_CLIENTS ) != 0 ||
+        pthread_create( &forwarder->acceptThread, NULL, ForwarderAcceptThread, forwarder ) != 0 ) {
+        close( forwarder->listenFd );
+        unlink( path );
+        return false;
+    }
+
+    return true;
+}
+
+void SocketForwarder_stop( SocketForwarder* forwarder )
+{
+    //Connection threads end when their client closes the connection
+    shutdown( forwarder->listenFd, SHUT_RDWR );
+    pthread_join( forwarder->acceptThread, NULL );
+    close( forwarder->listenFd );
+    unlink( forwarder->path );
+}
+
+// ---------- clients ----------
+
+static void RunHotClient( const char* segmentName, uint64_t numCalls, uint64_t* latencies, CrossProcessResult* result )
+{
+    SharedChannels channels;
+    if( ! SharedChannels_attach( &channels, segmentName ) )
+        return;
+
+    HotSharedChannel* channel = SharedChannels_claim( &channels );
+    if( channel != NULL ) {
+        int* data = (int*)channel->payload;
+        *data = 0;
+
+        uint64_t startNs = NowNs();
+        for( uint64_t i = 0; i < numCalls; ++i ) {
+            uint64_t startTime = ReadTscp();
+            int      status    = SharedChannels_requestCall( &channels, channel, 0, sizeof( int ) );
+            latencies[ i ]     = ReadTscp() - startTime;
+
+            if( status != SHARED_CHANNELS_OK )
+                break;
+            if( *data != (int)( i + 1 ) )
+                result->numErrors++;
+        }
+        result->elapsedNs = NowNs() - startNs;
+        result->failed    = *data != (int)numCalls;
+
+        SharedChannels_release( channel );
+    }
+
+    SharedChannels_close( &channels );
+}
+
+static void RunSocketClient( const char* path, uint64_t numCalls, uint64_t* latencies, CrossProcessResult* result )
+{
+    struct sockaddr_un address;
+    int                fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( fd < 0 )
+        return;
+    if( ! SocketAddress( &address, path ) || connect( fd, (struct sockaddr*)&address, sizeof( address ) ) != 0 ) {
+        close( fd );
+        return;
+    }
+
+    int      data    = 0;
+    uint64_t startNs = NowNs();
+    for( uint64_t i = 0; i < numCalls; ++i ) {
+        uint64_t startTime = ReadTscp();
+        if( ! WriteAll( fd, &data, sizeof( data ) ) || ! ReadAll( fd, &data, sizeof( data ) ) )
+            break;
+        latencies[ i ] = ReadTscp() - startTime;
+
+        if( data != (int)( i + 1 ) )
+            result->numErrors++;
+    }
+    result->elapsedNs = NowNs() - startNs;
+    result->failed    = data != (int)numCalls;
+
+    close( fd );
+}
+
+bool CrossProcess_spawn( CrossProcessClients* clients, CrossProcessMode mode, const char* target,
+                         uint32_t numClients, uint64_t numCalls, uint64_t* latencies )
+{
+    int goPipe[ 2 ];
+    if( numClients > CROSS_PROCESS_MAX_CLIENTS || pipe( goPipe ) != 0 )
+        return false;
+
+    clients->numClients = 0;
+    clients->numCalls   = numCalls;
+    clients->goFd       = goPipe[ 1 ];
+    for( uint32_t c = 0; c < numClients; ++c ) {
+        int resultPipe[ 2 ];
+        if( pipe( resultPipe ) != 0 )
+            break;
+
+        pid_t pid = fork();
+        if( pid == 0 ) {
+            //Client: fills its copy of latencies and leaves with _exit, the parent's exit handlers
+            //(e.g. destroying the enclave) must not run here
+            uint64_t*          clientLatencies = latencies + c * numCalls;
+            CrossProcessResult result          = { 1, 0, 0 };
+            char               go;
+            close( goPipe[ 1 ] );
+            close( resultPipe[ 0 ] );
+            if( read( goPipe[ 0 ], &go, 1 ) == 0 ) {
+                if( mode == CROSS_PROCESS_HOT )
+                    RunHotClient( target, numCalls, clientLatencies, &result );
+                else
+                    RunSocketClient( target, numCalls, clientLatencies, &result );
+            }
+
+            WriteAll( resultPipe[ 1 ], &result, sizeof( result ) );
+            WriteAll( resultPipe[ 1 ], clientLatencies, numCalls * sizeof( uint64_t ) );
+            _exit( 0 );
+        }
+
+        close( resultPipe[ 1 ] );
+        if( pid < 0 ) {
+            close( resultPipe[ 0 ] );
+            break;
+        }
+        clients->pids[ c ]      = pid;
+        clients->resultFds[ c ] = resultPipe[ 0 ];
+        clients->numClients++;
+    }
+    close( goPipe[ 0 ] );
+
+    if( clients->numClients < numClients ) {
+        CrossProcess_go( clients );
+        CrossProcess_collect( clients, latencies );
+        return false;
+    }
+
+    return true;
+}
+
+void CrossProcess_go( CrossProcessClients* clients )
+{
+    //Closing the pipe releases every client at once
+    close( clients->goFd );
+    clients->goFd = -1;
+}
+
+bool CrossProcess_collect( CrossProcessClients* clients, uint64_t* latencies )
+{
+    bool ok = true;
+
+    if( clients->goFd >= 0 )
+        CrossProcess_go( clients );
+
+    clients->numErrors      = 0;
+    clients->callsPerSecond = 0;
+    for( uint32_t c = 0; c < clients->numClients; ++c ) {
+        CrossProcessResult result;
+        if( ! ReadAll( clients->resultFds[ c ], &result, sizeof( result ) ) ||
+            ! ReadAll( clients->resultFds[ c ], latencies + c * clients->numCalls, clients->numCalls * sizeof( uint64_t ) ) )
+            result.failed = 1;
+
+        close( clients->resultFds[ c ] );
+        waitpid( clients->pids[ c ], NULL, 0 );
+
+        ok = ok && ! result.failed;
+        clients->numErrors += result.numErrors;
+        if( result.elapsedNs > 0 )
+            clients->callsPerSecond += clients->numCalls * 1e9 / result.elapsedNs;
+    }
+
+    return ok;
+}
@@ -0,0 +1,73 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Two-process benchmark of cross-process hot calls (App/SharedChannels.h) against forwarding
+//over a Unix socket, the path a request from another process takes without them: a socket
+//hop to the process that owns the enclave, then an SDK ecall. Clients are forked processes
+//that attach to the segment by name, or connect to the socket, like an unrelated process
+//would. Each client makes numCalls calls of MyCustomEcall's shape, an int that the callee
+//increments, and reports the latency of every call.
+
+#ifndef _CROSS_PROCESS_H_
+#define _CROSS_PROCESS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define CROSS_PROCESS_MAX_CLIENTS   64
+#define CROSS_PROCESS_PATH_SIZE     108     //sun_path
+
+typedef enum {
+    CROSS_PROCESS_HOT,          //target is the name of a shared channels segment
+    CROSS_PROCESS_SOCKET,       //target is the path of a SocketForwarder
+} CrossProcessMode;
+
+typedef struct {
+    uint32_t    numClients;
+    uint64_t    numCalls;       //per client
+    pid_t       pids[ CROSS_PROCESS_MAX_CLIENTS ];
+    int         resultFds[ CROSS_PROCESS_MAX_CLIENTS ];
+    int         goFd;
+    uint64_t    numErrors;      //set by CrossProcess_collect
+    double      callsPerSecond; //sum over the clients, set by CrossProcess_collect
+} CrossProcessClients;
+
+//Owner side of the socket path: every connection gets a thread that receives an int,
+//passes it to forward and sends it back
+typedef struct {
+    int         listenFd;
+    char        path[ CROSS_PROCESS_PATH_SIZE ];
+    void        (*forward)( void* data );
+    pthread_t   acceptThread;
+} SocketForwarder;
+
+bool SocketForwarder_start( SocketForwarder* forwarder, const char* path, void (*forward)( void* data ) );
+void SocketForwarder_stop( SocketForwarder* forwarder );
+
+//Forks the clients, which wait for CrossProcess_go. latencies (numClients * numCalls) must be
+//allocated before, the clients fill their copy and send it back. Fork before starting threads
+//that the clients could inherit in a locked state.
+bool CrossProcess_spawn( CrossProcessClients* clients, CrossProcessMode mode, const char* target,
+                         uint32_t numClients, uint64_t numCalls, uint64_t* latencies );
+void CrossProcess_go( CrossProcessClients* clients );
+//Waits for every client. False if a client could not attach or connect, or died.
+bool CrossProcess_collect( CrossProcessClients* clients, uint64_t* latencies );
+
+#endif /* !_CROSS_PROCESS_H_ */
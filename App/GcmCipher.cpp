@@ -0,0 +1,276 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#pragma GCC target( "aes,pclmul,sse4.1" )
+
+#include <string.h>
+#include <immintrin.h>
+
+#include "GcmCipher.h"
+
+#define GCM_BLOCK_SIZE          16
+#define GCM_PARALLEL_BLOCKS     8
+
+bool GcmCipher_isSupported( void )
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "aes" ) && __builtin_cpu_supports( "pclmul" ) &&
+           __builtin_cpu_supports( "sse4.1" );
+}
+
+static inline __m128i ByteReflect( __m128i value )
+{
+    const __m128i reverseBytes = _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+    return _mm_shuffle_epi8( value, reverseBytes );
+}
+
+#define EXPAND_ROUND_KEY( roundKeys, i, rcon ) \
+    roundKeys[ i ] = ExpandRoundKey( roundKeys[ i - 1 ], _mm_aeskeygenassist_si128( roundKeys[ i - 1 ], rcon ) )
+
+static inline __m128i ExpandRoundKey( __m128i key, __m128i generated )
+{
+    generated = _mm_shuffle_epi32( generated, 0xFF );
+    key       = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    key       = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    key       = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    return _mm_xor_si128( key, generated );
+}
+
+static inline __m128i EncryptBlock( const __m128i* roundKeys, __m128i block )
+{
+    block = _mm_xor_si128( block, roundKeys[ 0 ] );
+    for( int round = 1; round < 10; ++round )
+        block = _mm_aesenc_si128( block, roundKeys[ round ] );
+    return _mm_aesenclast_si128( block, roundKeys[ 10 ] );
+}
+
+//Carry-less product of two byte reflected values, left unreduced in (low, high), so several
+//products can be summed before one reduction
+static inline void MultiplyAccumulate( __m128i a, __m128i b, __m128i* low, __m128i* high )
+{
+    __m128i lowProduct  = _mm_clmulepi64_si128( a, b, 0x00 );
+    __m128i highProduct = _mm_clmulepi64_si128( a, b, 0x11 );
+    __m128i middle      = _mm_xor_si128( _mm_clmulepi64_si128( a, b, 0x10 ), _mm_clmulepi64_si128( a, b, 0x01 ) );
+
+    *low  = _mm_xor_si128( *low,  _mm_xor_si128( lowProduct,  _mm_slli_si128( middle, 8 ) ) );
+    *high = _mm_xor_si128( *high, _mm_xor_si128( highProduct, _mm_srli_si128( middle, 8 ) ) );
+}
+
+//Reduces modulo the GCM polynomial, following Gueron and Kounavis, "Intel Carry-Less
+//Multiplication Instruction and its Usage for Computing the GCM Mode"
+static inline __m128i Reduce( __m128i low, __m128i high )
+{
+    //Shift the 256 bit product left by one, for the reflected bit order
+    __m128i lowCarry  = _mm_srli_epi32( low, 31 );
+    __m128i highCarry = _mm_srli_epi32( high, 31 );
+    low  = _mm_slli_epi32( low, 1 );
+    high = _mm_slli_epi32( high, 1 );
+    __m128i crossCarry = _mm_srli_si128( lowCarry, 12 );
+    highCarry = _mm_slli_si128( highCarry, 4 );
+    lowCarry  = _mm_slli_si128( lowCarry, 4 );
+    low  = _mm_or_si128( low, lowCarry );
+    high = _mm_or_si128( high, highCarry );
+    high = _mm_or_si128( high, crossCarry );
+
+    __m128i first = _mm_xor_si128( _mm_xor_si128( _mm_slli_epi32( low, 31 ), _mm_slli_epi32( low, 30 ) ),
+                                   _mm_slli_epi32( low, 25 ) );
+    __m128i carry = _mm_srli_si128( first, 4 );
+    low = _mm_xor_si128( low, _mm_slli_si128( first, 12 ) );
+
+    __m128i second = _mm_xor_si128( _mm_xor_si128( _mm_srli_epi32( low, 1 ), _mm_srli_epi32( low, 2 ) ),
+                                    _mm_srli_epi32( low, 7 ) );
+    second = _mm_xor_si128( second, carry );
+    low    = _mm_xor_si128( low, second );
+
+    return _mm_xor_si128( high, low );
+}
+
+static inline __m128i Multiply( __m128i a, __m128i b )
+{
+    __m128i low  = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+    MultiplyAccumulate( a, b, &low, &high );
+    return Reduce( low, high );
+}
+
+typedef struct {
+    __m128i         hash;
+    const __m128i*  powers;     //H, H^2, H^3, H^4
+} GhashState;
+
+//Blocks are byte reflected already
+static inline void GhashFour( GhashState* state, const __m128i* blocks )
+{
+    __m128i low  = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+    MultiplyAccumulate( _mm_xor_si128( state->hash, blocks[ 0 ] ), state->powers[ 3 ], &low, &high );
+    MultiplyAccumulate( blocks[ 1 ], state->powers[ 2 ], &low, &high );
+    MultiplyAccumulate( blocks[ 2 ], state->powers[ 1 ], &low, &high );
+    MultiplyAccumulate( blocks[ 3 ], state->powers[ 0 ], &low, &high );
+    state->hash = Reduce( low, high );
+}
+
+static inline void GhashOne( GhashState* state, __m128i block )
+{
+    state->hash = Multiply( _mm_xor_si128( state->hash, block ), state->powers[ 0 ] );
+}
+
+static inline __m128i LoadPartial( const uint8_t* data, size_t size )
+{
+    uint8_t padded[ GCM_BLOCK_SIZE ] = { 0 };
+    memcpy( padded, data, size );
+    return _mm_loadu_si128( (const __m128i*)padded );
+}
+
+static void GhashData( GhashState* state, const uint8_t* data, size_t size )
+{
+    size_t offset = 0;
+    for( ; offset + 4 * GCM_BLOCK_SIZE <= size; offset += 4 * GCM_BLOCK_SIZE ) {
+        __m128i blocks[ 4 ];
+        for( int i = 0; i < 4; ++i )
+            blocks[ i ] = ByteReflect( _mm_loadu_si128( (const __m128i*)( data + offset ) + i ) );
+        GhashFour( state, blocks );
+    }
+    for( ; offset + GCM_BLOCK_SIZE <= size; offset += GCM_BLOCK_SIZE )
+        GhashOne( state, ByteReflect( _mm_loadu_si128( (const __m128i*)( data + offset ) ) ) );
+    if( offset < size )
+        GhashOne( state, ByteReflect( LoadPartial( data + offset, size - offset ) ) );
+}
+
+void GcmKey_init( GcmKey* gcmKey, const uint8_t key[ GCM_KEY_SIZE ] )
+{
+    __m128i roundKeys[ 11 ];
+    roundKeys[ 0 ] = _mm_loadu_si128( (const __m128i*)key );
+    EXPAND_ROUND_KEY( roundKeys, 1,  0x01 );
+    EXPAND_ROUND_KEY( roundKeys, 2,  0x02 );
+    EXPAND_ROUND_KEY( roundKeys, 3,  0x04 );
+    EXPAND_ROUND_KEY( roundKeys, 4,  0x08 );
+    EXPAND_ROUND_KEY( roundKeys, 5,  0x10 );
+    EXPAND_ROUND_KEY( roundKeys, 6,  0x20 );
+    EXPAND_ROUND_KEY( roundKeys, 7,  0x40 );
+    EXPAND_ROUND_KEY( roundKeys, 8,  0x80 );
+    EXPAND_ROUND_KEY( roundKeys, 9,  0x1B );
+    EXPAND_ROUND_KEY( roundKeys, 10, 0x36 );
+    for( int i = 0; i < 11; ++i )
+        _mm_store_si128( (__m128i*)gcmKey->roundKeys[ i ], roundKeys[ i ] );
+
+    __m128i hashKey = ByteReflect( EncryptBlock( roundKeys, _mm_setzero_si128() ) );
+    __m128i power   = hashKey;
+    for( int i = 0; i < 4; ++i ) {
+        _mm_store_si128( (__m128i*)gcmKey->hashKeyPowers[ i ], power );
+        power = Multiply( power, hashKey );
+    }
+}
+
+static inline __m128i CounterBlock( __m128i iv, uint32_t counter )
+{
+    return _mm_insert_epi32( iv, (int)__builtin_bswap32( counter ), 3 );
+}
+
+//CTR keystream from counter 2 on, XORed into output, with GHASH over the ciphertext (which is
+//input when decrypting, output when encrypting). Returns the final GHASH with the lengths block.
+static __m128i CtrAndGhash( const GcmKey* gcmKey, __m128i ivBlock, const uint8_t* aad, size_t aadSize,
+                            const uint8_t* input, size_t size, uint8_t* output, bool encrypting )
+{
+    const __m128i* roundKeys = (const __m128i*)gcmKey->roundKeys;
+    GhashState     ghash;
+    ghash.hash   = _mm_setzero_si128();
+    ghash.powers = (const __m128i*)gcmKey->hashKeyPowers;
+    GhashData( &ghash, aad, aadSize );
+
+    uint32_t counter = 2;
+    size_t   offset  = 0;
+    for( ; offset + GCM_PARALLEL_BLOCKS * GCM_BLOCK_SIZE <= size; offset += GCM_PARALLEL_BLOCKS * GCM_BLOCK_SIZE ) {
+        __m128i blocks[ GCM_PARALLEL_BLOCKS ];
+        for( int i = 0; i < GCM_PARALLEL_BLOCKS; ++i )
+            blocks[ i ] = _mm_xor_si128( CounterBlock( ivBlock, counter++ ), roundKeys[ 0 ] );
+        for( int round = 1; round < 10; ++round ) {
+            for( int i = 0; i < GCM_PARALLEL_BLOCKS; ++i )
+                blocks[ i ] = _mm_aesenc_si128( blocks[ i ], roundKeys[ round ] );
+        }
+
+        const __m128i* in  = (const __m128i*)( input + offset );
+        __m128i*       out = (__m128i*)( output + offset );
+        __m128i        cipherBlocks[ GCM_PARALLEL_BLOCKS ];
+        for( int i = 0; i < GCM_PARALLEL_BLOCKS; ++i ) {
+            __m128i inputBlock = _mm_loadu_si128( in + i );
+            __m128i result     = _mm_xor_si128( _mm_aesenclast_si128( blocks[ i ], roundKeys[ 10 ] ), inputBlock );
+            _mm_storeu_si128( out + i, result );
+            cipherBlocks[ i ] = ByteReflect( encrypting ? result : inputBlock );
+        }
+        GhashFour( &ghash, cipherBlocks );
+        GhashFour( &ghash, cipherBlocks + 4 );
+    }
+
+    for( ; offset < size; offset += GCM_BLOCK_SIZE ) {
+        size_t  blockSize = size - offset < GCM_BLOCK_SIZE ? size - offset : GCM_BLOCK_SIZE;
+        __m128i keystream = EncryptBlock( roundKeys, CounterBlock( ivBlock, counter++ ) );
+        __m128i inputBlock = LoadPartial( input + offset, blockSize );
+        __m128i result     = _mm_xor_si128( keystream, inputBlock );
+
+        uint8_t resultBytes[ GCM_BLOCK_SIZE ];
+        _mm_storeu_si128( (__m128i*)resultBytes, result );
+        memcpy( output + offset, resultBytes, blockSize );
+
+        //The ciphertext of a partial block is zero padded for GHASH
+        __m128i cipherBlock = encrypting ? LoadPartial( resultBytes, blockSize ) : inputBlock;
+        GhashOne( &ghash, ByteReflect( cipherBlock ) );
+    }
+
+    __m128i lengths = _mm_set_epi64x( (long long)aadSize * 8, (long long)size * 8 );
+    GhashOne( &ghash, lengths );
+
+    return ByteReflect( ghash.hash );
+}
+
+static inline __m128i IvBlock( const uint8_t iv[ GCM_IV_SIZE ] )
+{
+    uint8_t block[ GCM_BLOCK_SIZE ] = { 0 };
+    memcpy( block, iv, GCM_IV_SIZE );
+    return _mm_loadu_si128( (const __m128i*)block );
+}
+
+void GcmCipher_encrypt( const GcmKey* gcmKey, const uint8_t iv[ GCM_IV_SIZE ],
+                        const uint8_t* aad, size_t aadSize,
+                        const uint8_t* plaintext, size_t size, uint8_t* ciphertext,
+                        uint8_t mac[ GCM_MAC_SIZE ] )
+{
+    __m128i ivBlock = IvBlock( iv );
+    __m128i hash    = CtrAndGhash( gcmKey, ivBlock, aad, aadSize, plaintext, size, ciphertext, true );
+    __m128i tagMask = EncryptBlock( (const __m128i*)gcmKey->roundKeys, CounterBlock( ivBlock, 1 ) );
+    _mm_storeu_si128( (__m128i*)mac, _mm_xor_si128( hash, tagMask ) );
+}
+
+bool GcmCipher_decrypt( const GcmKey* gcmKey, const uint8_t iv[ GCM_IV_SIZE ],
+                        const uint8_t* aad, size_t aadSize,
+                        const uint8_t* ciphertext, size_t size, uint8_t* plaintext,
+                        const uint8_t mac[ GCM_MAC_SIZE ] )
+{
+    __m128i ivBlock = IvBlock( iv );
+    __m128i hash    = CtrAndGhash( gcmKey, ivBlock, aad, aadSize, ciphertext, size, plaintext, false );
+    __m128i tagMask = EncryptBlock( (const __m128i*)gcmKey->roundKeys, CounterBlock( ivBlock, 1 ) );
+    __m128i tag     = _mm_xor_si128( hash, tagMask );
+
+    //Constant time: every byte of the difference is looked at
+    __m128i difference = _mm_xor_si128( tag, _mm_loadu_si128( (const __m128i*)mac ) );
+    if( _mm_testz_si128( difference, difference ) )
+        return true;
+
+    memset( plaintext, 0, size );
+    return false;
+}
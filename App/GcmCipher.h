@@ -0,0 +1,54 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//AES-128-GCM for the untrusted side of a sealed channel (include/hot_calls_sealed.h), using
+//AES-NI and PCLMULQDQ directly. Counter blocks are encrypted 8 at a time so the AES rounds of
+//independent blocks overlap, and GHASH folds 4 blocks per reduction. The enclave side uses
+//sgx_tcrypto; both produce standard GCM with a 12 byte IV.
+
+#ifndef _GCM_CIPHER_H_
+#define _GCM_CIPHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GCM_KEY_SIZE    16
+#define GCM_IV_SIZE     12
+#define GCM_MAC_SIZE    16
+
+typedef struct {
+    uint8_t     roundKeys[ 11 ][ 16 ];
+    uint8_t     hashKeyPowers[ 4 ][ 16 ];  //H, H^2, H^3, H^4, byte reflected
+} __attribute__((aligned(16))) GcmKey;
+
+//AES-NI and PCLMULQDQ are available on this CPU
+bool GcmCipher_isSupported( void );
+
+void GcmKey_init( GcmKey* gcmKey, const uint8_t key[ GCM_KEY_SIZE ] );
+
+void GcmCipher_encrypt( const GcmKey* gcmKey, const uint8_t iv[ GCM_IV_SIZE ],
+                        const uint8_t* aad, size_t aadSize,
+                        const uint8_t* plaintext, size_t size, uint8_t* ciphertext,
+                        uint8_t mac[ GCM_MAC_SIZE ] );
+//Returns false, with plaintext zeroed, if the MAC does not match
+bool GcmCipher_decrypt( const GcmKey* gcmKey, const uint8_t iv[ GCM_IV_SIZE ],
+                        const uint8_t* aad, size_t aadSize,
+                        const uint8_t* ciphertext, size_t size, uint8_t* plaintext,
+                        const uint8_t mac[ GCM_MAC_SIZE ] );
+
+#endif /* !_GCM_CIPHER_H_ */
@@ -0,0 +1,330 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "HotCallTrace.h"
+
+//One per thread that ever recorded, reused after the thread exits. recording is set while
+//the thread is inside HotCallTrace_record, so start and stop can wait for it to be done
+//with its buffer before the buffers are freed or read.
+typedef struct HotCallTraceThread {
+    bool                        recording;
+    bool                        inUse;
+    struct HotCallTraceThread*  next;
+    uint8_t                     padding[ 64 - 2 * sizeof( void* ) ];
+} HotCallTraceThread;
+
+typedef struct HotCallTraceBuffer {
+    uint32_t                    numRecords;
+    uint32_t                    capacity;
+    struct HotCallTraceBuffer*  next;
+    HotCallTraceRecord          records[];
+} HotCallTraceBuffer;
+
+bool hotCallTraceEnabled = false;
+
+static pthread_mutex_t      traceMutex       = PTHREAD_MUTEX_INITIALIZER;
+static HotCallTraceBuffer*  traceBuffers     = NULL;     //Every buffer of the current trace
+static uint32_t             traceGeneration  = 0;        //Bumped by HotCallTrace_start
+static uint64_t             traceCapacity    = 0;        //Records left to hand out in new buffers
+static uint64_t             traceNumDropped  = 0;
+static uint32_t             traceNumThreads  = 0;
+
+static pthread_mutex_t      threadsMutex     = PTHREAD_MUTEX_INITIALIZER;
+static HotCallTraceThread*  traceThreads     = NULL;
+static pthread_once_t       threadKeyOnce    = PTHREAD_ONCE_INIT;
+static pthread_key_t        threadKey;
+
+static __thread HotCallTraceThread* currentSelf       = NULL;
+static __thread HotCallTraceBuffer* currentBuffer     = NULL;
+static __thread uint32_t            currentGeneration = 0;
+static __thread uint16_t            currentThread     = 0;
+static __thread bool                currentExhausted  = false;  //No capacity was left in currentGeneration
+
+static inline uint64_t ReadTsc( void )
+{
+    unsigned int low, high;
+
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+
+    return low | ((uint64_t)high) << 32;
+}
+
+static void ReleaseThread( void* selfAsVoidP )
+{
+    HotCallTraceThread* self = (HotCallTraceThread*)selfAsVoidP;
+
+    pthread_mutex_lock( &threadsMutex );
+    self->inUse = false;
+    pthread_mutex_unlock( &threadsMutex );
+}
+
+static void CreateThreadKey( void )
+{
+    pthread_key_create( &threadKey, ReleaseThread );
+}
+
+//Slow path, once per thread: a free entry of an exited thread, or a new one
+static HotCallTraceThread* RegisterThread( void )
+{
+    HotCallTraceThread* self = NULL;
+
+    pthread_once( &threadKeyOnce, CreateThreadKey );
+    pthread_mutex_lock( &threadsMutex );
+    for( HotCallTraceThread* thread = traceThreads; thread != NULL; thread = thread->next ) {
+        if( ! thread->inUse ) {
+            self = thread;
+            break;
+        }
+    }
+    if( self == NULL ) {
+        void* memory = NULL;
+        if( posix_memalign( &memory, 64, sizeof( HotCallTraceThread ) ) == 0 ) {
+            self         = (HotCallTraceThread*)memory;
+            self->next   = traceThreads;
+            traceThreads = self;
+        }
+    }
+    if( self != NULL ) {
+        self->recording = false;
+        self->inUse     = true;
+        pthread_setspecific( threadKey, self );
+    }
+    pthread_mutex_unlock( &threadsMutex );
+
+    currentSelf = self;
+    return self;
+}
+
+//Disables recording and returns once no thread is inside HotCallTrace_record. A thread sets
+//its flag before it checks hotCallTraceEnabled, and both sides use sequentially consistent
+//accesses, so a thread that missed the store below is seen recording here.
+static void DisableAndWaitForRecorders( void )
+{
+    __atomic_store_n( &hotCallTraceEnabled, false, __ATOMIC_SEQ_CST );
+
+    pthread_mutex_lock( &threadsMutex );
+    for( HotCallTraceThread* thread = traceThreads; thread != NULL; thread = thread->next ) {
+        while( __atomic_load_n( &thread->recording, __ATOMIC_SEQ_CST ) )
+            __asm__ __volatile__( "pause" ::: "memory" );
+    }
+    pthread_mutex_unlock( &threadsMutex );
+}
+
+//Slow path: the first request of this thread in the current trace, or its buffer is full
+static HotCallTraceBuffer* NewBuffer( void )
+{
+    HotCallTraceBuffer* buffer = NULL;
+
+    pthread_mutex_lock( &traceMutex );
+    if( currentGeneration != traceGeneration ) {
+        currentGeneration = traceGeneration;
+        currentThread     = (uint16_t)traceNumThreads++;
+    }
+
+    if( traceCapacity > 0 ) {
+        uint64_t share    = traceCapacity / ( HOTCALL_TRACE_SHARE_DIVISOR * traceNumThreads );
+        share             = std::max<uint64_t>( share, HOTCALL_TRACE_MIN_BUFFER_RECORDS );
+        share             = std::min<uint64_t>( share, HOTCALL_TRACE_BUFFER_RECORDS );
+        uint32_t capacity = (uint32_t)std::min<uint64_t>( traceCapacity, share );
+        buffer = (HotCallTraceBuffer*)malloc( sizeof( HotCallTraceBuffer ) + capacity * sizeof( HotCallTraceRecord ) );
+        if( buffer != NULL ) {
+            buffer->numRecords = 0;
+            buffer->capacity   = capacity;
+            buffer->next       = traceBuffers;
+            traceBuffers       = buffer;
+            traceCapacity     -= capacity;
+        }
+    }
+    currentExhausted = buffer == NULL;
+    if( buffer == NULL )
+        __atomic_fetch_add( &traceNumDropped, 1, __ATOMIC_RELAXED );
+    pthread_mutex_unlock( &traceMutex );
+
+    return buffer;
+}
+
+static void RecordRequest( uint16_t callID, uint32_t payloadSize )
+{
+    //The generation first: a buffer of an earlier trace was freed by HotCallTrace_start
+    HotCallTraceBuffer* buffer    = currentBuffer;
+    bool                sameTrace = currentGeneration == __atomic_load_n( &traceGeneration, __ATOMIC_RELAXED );
+    if( sameTrace && currentExhausted ) {
+        __atomic_fetch_add( &traceNumDropped, 1, __ATOMIC_RELAXED );
+        return;
+    }
+
+    if( ! sameTrace || buffer == NULL || buffer->numRecords == buffer->capacity ) {
+        buffer        = NewBuffer();
+        currentBuffer = buffer;
+        if( buffer == NULL )
+            return;
+    }
+
+    HotCallTraceRecord* record = &buffer->records[ buffer->numRecords++ ];
+    record->tsc         = ReadTsc();
+    record->callID      = callID;
+    record->thread      = currentThread;
+    record->payloadSize = payloadSize;
+}
+
+void HotCallTrace_record( uint16_t callID, uint32_t payloadSize )
+{
+    HotCallTraceThread* self = currentSelf;
+    if( self == NULL && ( self = RegisterThread() ) == NULL )
+        return;
+
+    __atomic_store_n( &self->recording, true, __ATOMIC_SEQ_CST );
+    if( __atomic_load_n( &hotCallTraceEnabled, __ATOMIC_SEQ_CST ) )
+        RecordRequest( callID, payloadSize );
+    __atomic_store_n( &self->recording, false, __ATOMIC_RELEASE );
+}
+
+static void FreeBuffers( void )
+{
+    while( traceBuffers != NULL ) {
+        HotCallTraceBuffer* next = traceBuffers->next;
+        free( traceBuffers );
+        traceBuffers = next;
+    }
+}
+
+void HotCallTrace_start( uint64_t maxRecords )
+{
+    //Once no thread is recording the old buffers are unused. Threads notice the new
+    //generation on their next request and take a new buffer.
+    DisableAndWaitForRecorders();
+    pthread_mutex_lock( &traceMutex );
+    FreeBuffers();
+    __atomic_store_n( &traceGeneration, traceGeneration + 1, __ATOMIC_RELAXED );
+    traceCapacity   = maxRecords;
+    traceNumThreads = 0;
+    __atomic_store_n( &traceNumDropped, 0, __ATOMIC_RELAXED );
+    __atomic_store_n( &hotCallTraceEnabled, true, __ATOMIC_RELEASE );
+    pthread_mutex_unlock( &traceMutex );
+}
+
+void HotCallTrace_stop( void )
+{
+    DisableAndWaitForRecorders();
+}
+
+uint64_t HotCallTrace_numRecords( void )
+{
+    uint64_t numRecords = 0;
+
+    pthread_mutex_lock( &traceMutex );
+    for( HotCallTraceBuffer* buffer = traceBuffers; buffer != NULL; buffer = buffer->next )
+        numRecords += buffer->numRecords;
+    pthread_mutex_unlock( &traceMutex );
+
+    return numRecords;
+}
+
+static bool EarlierRecord( const HotCallTraceRecord& a, const HotCallTraceRecord& b )
+{
+    return a.tsc < b.tsc;
+}
+
+bool HotCallTrace_write( const char* path, uint64_t tscFrequencyHz )
+{
+    std::vector<HotCallTraceRecord> records;
+    HotCallTraceHeader              header;
+
+    pthread_mutex_lock( &traceMutex );
+    for( HotCallTraceBuffer* buffer = traceBuffers; buffer != NULL; buffer = buffer->next )
+        records.insert( records.end(), buffer->records, buffer->records + buffer->numRecords );
+
+    memset( &header, 0, sizeof( header ) );
+    header.fields.magic          = HOTCALL_TRACE_MAGIC;
+    header.fields.version        = HOTCALL_TRACE_VERSION;
+    header.fields.recordSize     = sizeof( HotCallTraceRecord );
+    header.fields.tscFrequencyHz = tscFrequencyHz;
+    header.fields.numRecords     = records.size();
+    header.fields.numDropped     = __atomic_load_n( &traceNumDropped, __ATOMIC_RELAXED );
+    header.fields.numThreads     = traceNumThreads;
+    pthread_mutex_unlock( &traceMutex );
+
+    //Buffers are per thread; requests of one thread are already in order
+    std::stable_sort( records.begin(), records.end(), EarlierRecord );
+
+    FILE* traceFile = fopen( path, "wb" );
+    if( traceFile == NULL )
+        return false;
+
+    bool ok = fwrite( &header, sizeof( header ), 1, traceFile ) == 1;
+    if( ok && ! records.empty() )
+        ok = fwrite( &records[ 0 ], sizeof( HotCallTraceRecord ), records.size(), traceFile ) == records.size();
+
+    return fclose( traceFile ) == 0 && ok;
+}
+
+bool HotCallTrace_open( HotCallTraceFile* trace, const char* path )
+{
+    struct stat st;
+
+    trace->fd = open( path, O_RDONLY );
+    if( trace->fd < 0 )
+        return false;
+
+    if( fstat( trace->fd, &st ) != 0 || (size_t)st.st_size < sizeof( HotCallTraceHeader ) ) {
+        close( trace->fd );
+        return false;
+    }
+
+    trace->mappedSize = st.st_size;
+    void* address = mmap( NULL, trace->mappedSize, PROT_READ, MAP_PRIVATE, trace->fd, 0 );
+    if( address == MAP_FAILED ) {
+        close( trace->fd );
+        return false;
+    }
+
+    trace->header  = (const HotCallTraceHeader*)address;
+    trace->records = (const HotCallTraceRecord*)( (const uint8_t*)address + sizeof( HotCallTraceHeader ) );
+
+    if( trace->header->fields.magic != HOTCALL_TRACE_MAGIC ||
+        trace->header->fields.version != HOTCALL_TRACE_VERSION ||
+        trace->header->fields.recordSize != sizeof( HotCallTraceRecord ) ||
+        trace->header->fields.numRecords > ( trace->mappedSize - sizeof( HotCallTraceHeader ) ) / sizeof( HotCallTraceRecord ) ) {
+        HotCallTrace_release( trace );
+        return false;
+    }
+
+    return true;
+}
+
+void HotCallTrace_release( HotCallTraceFile* trace )
+{
+    munmap( (void*)trace->header, trace->mappedSize );
+    close( trace->fd );
+
+    trace->fd      = -1;
+    trace->header  = NULL;
+    trace->records = NULL;
+}
@@ -0,0 +1,74 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Recorder and file format of hot call request traces (include/hot_calls_trace.h).
+//Each thread appends records to buffers of its own, so recording takes no lock except
+//when a buffer fills up. A buffer holds a fair share of the capacity left, so threads that
+//stop recording strand little of it. A trace file is a 64-byte header followed by the records of
+//all threads, sorted by TSC.
+
+#ifndef _HOT_CALL_TRACE_H_
+#define _HOT_CALL_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../include/hot_calls_trace.h"
+
+#define HOTCALL_TRACE_MAGIC                 0x3145434152544348ULL   //"HCTRACE1"
+#define HOTCALL_TRACE_VERSION               1
+#define HOTCALL_TRACE_BUFFER_RECORDS        4096    //Most records a thread takes from the capacity at a time
+#define HOTCALL_TRACE_MIN_BUFFER_RECORDS    64
+#define HOTCALL_TRACE_SHARE_DIVISOR         8       //A buffer takes at most 1/(8 * threads) of what is left
+#define HOTCALL_TRACE_DEFAULT_MAX_RECORDS   ( 16ULL << 20 )
+#define HOTCALL_TRACE_EXTENSION             ".trace"
+
+typedef union {
+    struct {
+        uint64_t    magic;
+        uint32_t    version;
+        uint32_t    recordSize;
+        uint64_t    tscFrequencyHz;
+        uint64_t    numRecords;
+        uint64_t    numDropped;         //Requests after maxRecords, not in the file
+        uint32_t    numThreads;
+    } fields;
+    uint8_t         padding[ 64 ];
+} HotCallTraceHeader;
+
+typedef struct {
+    int                         fd;
+    size_t                      mappedSize;
+    const HotCallTraceHeader*   header;
+    const HotCallTraceRecord*   records;
+} HotCallTraceFile;
+
+//Drops what was recorded so far and records up to maxRecords requests from now on. Waits
+//for threads still recording into the previous trace before freeing its buffers.
+void     HotCallTrace_start( uint64_t maxRecords );
+//Stops recording and returns once no thread is still appending to its buffer
+void     HotCallTrace_stop( void );
+//Both need the trace stopped with HotCallTrace_stop
+uint64_t HotCallTrace_numRecords( void );
+bool     HotCallTrace_write( const char* path, uint64_t tscFrequencyHz );
+
+bool     HotCallTrace_open( HotCallTraceFile* trace, const char* path );
+void     HotCallTrace_release( HotCallTraceFile* trace );
+
+#endif /* !_HOT_CALL_TRACE_H_ */
@@ -0,0 +1,248 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MeasurementStore.h"
+
+#define MEASUREMENT_STORE_PAGE_SIZE     4096
+#define TSC_CALIBRATION_NS              50000000
+
+static inline uint64_t ReadTsc( void )
+{
+    unsigned int low, high;
+
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+
+    return low | ((uint64_t)high) << 32;
+}
+
+static uint64_t NowNs( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static uint64_t CalibrateTscFrequency( void )
+{
+    uint64_t startNs  = NowNs();
+    uint64_t startTsc = ReadTsc();
+    while( NowNs() - startNs < TSC_CALIBRATION_NS )
+        ;
+    uint64_t elapsedNs  = NowNs() - startNs;
+    uint64_t elapsedTsc = ReadTsc() - startTsc;
+
+    return (uint64_t)( (double)elapsedTsc * 1e9 / elapsedNs );
+}
+
+static void ReadCpuModel( char* model, size_t size )
+{
+    snprintf( model, size, "unknown" );
+
+    FILE* cpuInfo = fopen( "/proc/cpuinfo", "r" );
+    if( cpuInfo == NULL )
+        return;
+
+    char line[ 512 ];
+    while( fgets( line, sizeof( line ), cpuInfo ) != NULL ) {
+        if( strncmp( line, "model name", strlen( "model name" ) ) != 0 )
+            continue;
+
+        char* value = strchr( line, ':' );
+        if( value == NULL )
+            break;
+
+        value += 2;
+        value[ strcspn( value, "\n" ) ] = '\0';
+        snprintf( model, size, "%s", value );
+        break;
+    }
+
+    fclose( cpuInfo );
+}
+
+void MeasurementHeader_collect( MeasurementHeader* header, const char* sgxMode, const char* buildFlags )
+{
+    memset( header, 0, sizeof( MeasurementHeader ) );
+    header->fields.magic          = MEASUREMENT_STORE_MAGIC;
+    header->fields.version        = MEASUREMENT_STORE_VERSION;
+    header->fields.tscFrequencyHz = CalibrateTscFrequency();
+
+    gethostname( header->fields.host, sizeof( header->fields.host ) - 1 );
+    ReadCpuModel( header->fields.cpuModel, sizeof( header->fields.cpuModel ) );
+    snprintf( header->fields.sgxMode,    sizeof( header->fields.sgxMode ),    "%s", sgxMode );
+    snprintf( header->fields.buildFlags, sizeof( header->fields.buildFlags ), "%s", buildFlags );
+}
+
+bool MeasurementHeader_addExtra( MeasurementHeader* header, const char* key, const char* value )
+{
+    size_t used      = strlen( header->fields.extra );
+    size_t available = sizeof( header->fields.extra ) - used;
+
+    int written = snprintf( header->fields.extra + used, available, "%s=%s\n", key, value );
+    if( written < 0 || (size_t)written >= available ) {
+        header->fields.extra[ used ] = '\0';
+        return false;
+    }
+
+    return true;
+}
+
+bool MeasurementHeader_hasExtra( const MeasurementHeader* header, const char* key, const char* value )
+{
+    char line[ 256 ];
+    int  lineSize = snprintf( line, sizeof( line ), "%s=%s\n", key, value );
+    if( lineSize < 0 || (size_t)lineSize >= sizeof( line ) )
+        return false;
+
+    const char* extra     = header->fields.extra;
+    size_t      extraSize = strnlen( extra, sizeof( header->fields.extra ) );
+
+    //Only at the start of a line, so a key cannot match the end of another one
+    for( size_t offset = 0; offset + lineSize <= extraSize; ) {
+        if( memcmp( extra + offset, line, lineSize ) == 0 )
+            return true;
+
+        const char* next = (const char*)memchr( extra + offset, '\n', extraSize - offset );
+        if( next == NULL )
+            break;
+        offset = next - extra + 1;
+    }
+
+    return false;
+}
+
+bool MeasurementColumn_create( MeasurementColumn* column, const char* path, const char* name,
+                               uint64_t capacity, const MeasurementHeader* metadata )
+{
+    column->fd         = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    column->capacity   = capacity;
+    column->mappedSize = MEASUREMENT_STORE_HEADER_SIZE + capacity * sizeof( uint64_t );
+    if( column->fd < 0 )
+        return false;
+
+    if( ftruncate( column->fd, column->mappedSize ) != 0 ) {
+        close( column->fd );
+        return false;
+    }
+
+    void* address = mmap( NULL, column->mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, column->fd, 0 );
+    if( address == MAP_FAILED ) {
+        close( column->fd );
+        return false;
+    }
+
+    //MAP_POPULATE only maps the pages; writing each one also takes the page_mkwrite fault now
+    for( size_t offset = 0; offset < column->mappedSize; offset += MEASUREMENT_STORE_PAGE_SIZE )
+        ((volatile uint8_t*)address)[ offset ] = 0;
+
+    column->header = (MeasurementHeader*)address;
+    column->rows   = (uint64_t*)( (uint8_t*)address + MEASUREMENT_STORE_HEADER_SIZE );
+
+    *column->header = *metadata;
+    column->header->fields.magic      = MEASUREMENT_STORE_MAGIC;
+    column->header->fields.version    = MEASUREMENT_STORE_VERSION;
+    column->header->fields.numRows    = 0;
+    column->header->fields.iterations = capacity;
+    column->header->fields.timestamp  = time( NULL );
+    snprintf( column->header->fields.name, sizeof( column->header->fields.name ), "%s", name );
+
+    return true;
+}
+
+void MeasurementColumn_close( MeasurementColumn* column, uint64_t numRows )
+{
+    if( numRows > column->capacity )
+        numRows = column->capacity;
+
+    column->header->fields.numRows = numRows;
+    munmap( column->header, column->mappedSize );
+
+    if( ftruncate( column->fd, MEASUREMENT_STORE_HEADER_SIZE + numRows * sizeof( uint64_t ) ) != 0 )
+        perror( "ftruncate" );
+    close( column->fd );
+
+    column->fd     = -1;
+    column->header = NULL;
+    column->rows   = NULL;
+}
+
+bool MeasurementColumn_open( MeasurementColumn* column, const char* path )
+{
+    struct stat st;
+
+    column->fd = open( path, O_RDONLY );
+    if( column->fd < 0 )
+        return false;
+
+    if( fstat( column->fd, &st ) != 0 || (size_t)st.st_size < MEASUREMENT_STORE_HEADER_SIZE ) {
+        close( column->fd );
+        return false;
+    }
+
+    column->mappedSize = st.st_size;
+    void* address = mmap( NULL, column->mappedSize, PROT_READ, MAP_PRIVATE, column->fd, 0 );
+    if( address == MAP_FAILED ) {
+        close( column->fd );
+        return false;
+    }
+
+    column->header   = (MeasurementHeader*)address;
+    column->rows     = (uint64_t*)( (uint8_t*)address + MEASUREMENT_STORE_HEADER_SIZE );
+    column->capacity = column->header->fields.numRows;
+
+    if( column->header->fields.magic != MEASUREMENT_STORE_MAGIC ||
+        column->header->fields.version != MEASUREMENT_STORE_VERSION ||
+        column->capacity > ( column->mappedSize - MEASUREMENT_STORE_HEADER_SIZE ) / sizeof( uint64_t ) ) {
+        MeasurementColumn_release( column );
+        return false;
+    }
+
+    return true;
+}
+
+void MeasurementColumn_release( MeasurementColumn* column )
+{
+    munmap( column->header, column->mappedSize );
+    close( column->fd );
+
+    column->fd     = -1;
+    column->header = NULL;
+    column->rows   = NULL;
+}
+
+bool MeasurementColumn_exportCsv( const MeasurementColumn* column, const char* csvPath )
+{
+    FILE* csvFile = fopen( csvPath, "w" );
+    if( csvFile == NULL )
+        return false;
+
+    //Same layout the benchmark always wrote: one sample per line, followed by a space
+    const uint64_t numRows = column->header->fields.numRows;
+    for( uint64_t rowIdx = 0; rowIdx < numRows; ++rowIdx )
+        fprintf( csvFile, "%lu \n", column->rows[ rowIdx ] );
+
+    return fclose( csvFile ) == 0;
+}
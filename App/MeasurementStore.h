@@ -0,0 +1,85 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Binary measurement columns. Every measurement is one file, <name>.hcm: a 4KB header
+//describing the run, followed by numRows raw uint64_t samples. While a benchmark runs
+//the column is mapped and pre-faulted, so storing a sample is a plain store to memory;
+//closing the column records numRows and trims the file.
+
+#ifndef _MEASUREMENT_STORE_H_
+#define _MEASUREMENT_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MEASUREMENT_STORE_MAGIC         0x314d4348  //"HCM1"
+#define MEASUREMENT_STORE_VERSION       1
+#define MEASUREMENT_STORE_HEADER_SIZE   4096
+#define MEASUREMENT_STORE_EXTENSION     ".hcm"
+#define MEASUREMENT_BETTER_KEY          "better"    //Extra key of throughput columns: "higher". Latencies omit it.
+#define MEASUREMENT_HIGHER_IS_BETTER    "higher"
+
+typedef union {
+    struct {
+        uint32_t    magic;
+        uint32_t    version;
+        uint64_t    numRows;
+        uint64_t    iterations;         //Samples the benchmark asked for
+        uint64_t    tscFrequencyHz;
+        uint64_t    timestamp;          //Seconds since the epoch, when the column was created
+        char        name[ 128 ];
+        char        host[ 64 ];
+        char        cpuModel[ 128 ];
+        char        sgxMode[ 16 ];
+        char        buildFlags[ 512 ];
+        char        extra[ 2048 ];      //"key=value" lines: options, counters, test specific state
+    } fields;
+    uint8_t         padding[ MEASUREMENT_STORE_HEADER_SIZE ];
+} MeasurementHeader;
+
+typedef struct {
+    int                 fd;
+    MeasurementHeader*  header;
+    uint64_t*           rows;           //capacity samples, mapped right after the header
+    uint64_t            capacity;
+    size_t              mappedSize;
+} MeasurementColumn;
+
+//Fills host, CPU model and TSC frequency (calibrated, takes ~50ms), with the given
+//SGX mode and build flags. Done once per run; columns copy it.
+void MeasurementHeader_collect( MeasurementHeader* header, const char* sgxMode, const char* buildFlags );
+//Appends "key=value\n" to the extra metadata. Returns false if it does not fit.
+bool MeasurementHeader_addExtra( MeasurementHeader* header, const char* key, const char* value );
+//True if the extra metadata has a "key=value" line. extra need not be NUL-terminated.
+bool MeasurementHeader_hasExtra( const MeasurementHeader* header, const char* key, const char* value );
+
+//Creates path and maps capacity samples, pre-faulted. metadata is copied into the header.
+bool MeasurementColumn_create( MeasurementColumn* column, const char* path, const char* name,
+                               uint64_t capacity, const MeasurementHeader* metadata );
+//Records numRows (<= capacity), trims the file and unmaps it
+void MeasurementColumn_close( MeasurementColumn* column, uint64_t numRows );
+
+//Maps an existing column read-only
+bool MeasurementColumn_open( MeasurementColumn* column, const char* path );
+void MeasurementColumn_release( MeasurementColumn* column );
+
+//Writes the samples of an open column as text, one per line
+bool MeasurementColumn_exportCsv( const MeasurementColumn* column, const char* csvPath );
+
+#endif /* !_MEASUREMENT_STORE_H_ */
@@ -0,0 +1,66 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <string.h>
+#include <math.h>
+
+#include "OpenLoop.h"
+#include "SplitMix.h"
+
+//Uniform in (0, 1], so the logarithm below is finite
+static inline double NextUniform( OpenLoopSchedule* schedule )
+{
+    return ( ( SplitMix64_next( &schedule->rngState ) >> 11 ) + 1 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+bool OpenLoopArrivals_parse( const char* name, OpenLoopArrivals* arrivals )
+{
+    if( strcmp( name, "fixed" ) == 0 )
+        *arrivals = OPEN_LOOP_FIXED;
+    else if( strcmp( name, "poisson" ) == 0 )
+        *arrivals = OPEN_LOOP_POISSON;
+    else
+        return false;
+
+    return true;
+}
+
+const char* OpenLoopArrivals_name( OpenLoopArrivals arrivals )
+{
+    return arrivals == OPEN_LOOP_FIXED ? "fixed" : "poisson";
+}
+
+void OpenLoopSchedule_init( OpenLoopSchedule* schedule, OpenLoopArrivals arrivals, double callsPerSecond,
+                            uint64_t tscFrequencyHz, uint64_t startTsc, uint64_t seed )
+{
+    schedule->arrivals           = arrivals;
+    schedule->meanIntervalCycles = tscFrequencyHz / callsPerSecond;
+    schedule->nextDueTsc         = (double)startTsc;
+    schedule->rngState           = seed;
+}
+
+uint64_t OpenLoopSchedule_next( OpenLoopSchedule* schedule )
+{
+    //Poisson arrivals: exponentially distributed intervals with the same mean
+    double interval = schedule->meanIntervalCycles;
+    if( schedule->arrivals == OPEN_LOOP_POISSON )
+        interval *= -log( NextUniform( schedule ) );
+
+    schedule->nextDueTsc += interval;
+    return (uint64_t)schedule->nextDueTsc;
+}
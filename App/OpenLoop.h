@@ -0,0 +1,52 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Open-loop arrival schedule: calls are due at a fixed interval, or as a Poisson process,
+//at a target rate whether or not earlier calls have finished. A driver that waits for each
+//due time and measures latency from it, not from when the call actually started, charges
+//a call that queued behind a slow one for the wait (no coordinated omission).
+
+#ifndef _OPEN_LOOP_H_
+#define _OPEN_LOOP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    OPEN_LOOP_FIXED,
+    OPEN_LOOP_POISSON,
+} OpenLoopArrivals;
+
+typedef struct {
+    OpenLoopArrivals    arrivals;
+    double              meanIntervalCycles;
+    double              nextDueTsc;
+    uint64_t            rngState;
+} OpenLoopSchedule;
+
+//"fixed" or "poisson"; false for any other name
+bool        OpenLoopArrivals_parse( const char* name, OpenLoopArrivals* arrivals );
+const char* OpenLoopArrivals_name( OpenLoopArrivals arrivals );
+
+//The first call is due one interval after startTsc
+void        OpenLoopSchedule_init( OpenLoopSchedule* schedule, OpenLoopArrivals arrivals, double callsPerSecond,
+                                   uint64_t tscFrequencyHz, uint64_t startTsc, uint64_t seed );
+//TSC at which the next call is due
+uint64_t    OpenLoopSchedule_next( OpenLoopSchedule* schedule );
+
+#endif /* !_OPEN_LOOP_H_ */
@@ -0,0 +1,237 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "PerfCounters.h"
+
+//MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM (MEM_LOAD_UOPS_LLC_HIT_RETIRED before Skylake): event 0xD2, umask 0x04
+#define PERF_INTEL_HITM_RAW_EVENT   0x04D2
+#define PERF_MAX_CANDIDATES         2
+
+typedef struct {
+    const char*     name;
+    uint32_t        type;
+    uint64_t        config;
+} PerfEventCandidate;
+
+static const char* counterNames[ PERF_COUNTERS_NUM ] = {
+    "cycles", "instructions", "branch-misses", "llc-misses", "hitm", "context-switches"
+};
+
+#define PERF_CACHE_EVENT( cache, op, result ) \
+    ( (cache) | ( (op) << 8 ) | ( (result) << 16 ) )
+
+static bool IsIntelCpu( void )
+{
+    FILE* cpuInfo = fopen( "/proc/cpuinfo", "r" );
+    if( cpuInfo == NULL )
+        return false;
+
+    bool isIntel = false;
+    char line[ 256 ];
+    while( fgets( line, sizeof( line ), cpuInfo ) != NULL ) {
+        if( strncmp( line, "vendor_id", strlen( "vendor_id" ) ) == 0 ) {
+            isIntel = strstr( line, "GenuineIntel" ) != NULL;
+            break;
+        }
+    }
+
+    fclose( cpuInfo );
+    return isIntel;
+}
+
+static PerfEventCandidate Candidate( const char* name, uint32_t type, uint64_t config )
+{
+    PerfEventCandidate candidate;
+    candidate.name   = name;
+    candidate.type   = type;
+    candidate.config = config;
+    return candidate;
+}
+
+//Specific event first, generic fallback second
+static int CandidatesOf( int counter, uint64_t hitmRawEvent, PerfEventCandidate* candidates )
+{
+    switch( counter ) {
+        case PERF_COUNTER_CYCLES:
+            candidates[ 0 ] = Candidate( "cpu-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+            return 1;
+        case PERF_COUNTER_INSTRUCTIONS:
+            candidates[ 0 ] = Candidate( "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+            return 1;
+        case PERF_COUNTER_BRANCH_MISSES:
+            candidates[ 0 ] = Candidate( "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES );
+            return 1;
+        case PERF_COUNTER_LLC_MISSES:
+            candidates[ 0 ] = Candidate( "LLC-load-misses", PERF_TYPE_HW_CACHE,
+                PERF_CACHE_EVENT( PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS ) );
+            candidates[ 1 ] = Candidate( "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+            return 2;
+        case PERF_COUNTER_HITM: {
+            int numCandidates = 0;
+            if( hitmRawEvent != 0 )
+                candidates[ numCandidates++ ] = Candidate( "raw-hitm", PERF_TYPE_RAW, hitmRawEvent );
+            else if( IsIntelCpu() )
+                candidates[ numCandidates++ ] = Candidate( "xsnp-hitm", PERF_TYPE_RAW, PERF_INTEL_HITM_RAW_EVENT );
+            //No generic HITM event; loads missing the local NUMA node are the closest
+            candidates[ numCandidates++ ] = Candidate( "node-load-misses", PERF_TYPE_HW_CACHE,
+                PERF_CACHE_EVENT( PERF_COUNT_HW_CACHE_NODE, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS ) );
+            return numCandidates;
+        }
+        default:
+            candidates[ 0 ] = Candidate( "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES );
+            return 1;
+    }
+}
+
+static int OpenEvent( const PerfEventCandidate* candidate, bool inherit )
+{
+    struct perf_event_attr attributes;
+    memset( &attributes, 0, sizeof( attributes ) );
+    attributes.size           = sizeof( attributes );
+    attributes.type           = candidate->type;
+    attributes.config         = candidate->config;
+    attributes.disabled       = 1;
+    attributes.inherit        = inherit ? 1 : 0;
+    attributes.exclude_kernel = candidate->type != PERF_TYPE_SOFTWARE;
+    attributes.exclude_hv     = 1;
+    attributes.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall( __NR_perf_event_open, &attributes, 0, -1, -1, 0 );
+}
+
+int PerfCounterSet_open( PerfCounterSet* set, bool inherit, uint64_t hitmRawEvent )
+{
+    int numOpen = 0;
+
+    set->inherit = inherit;
+    for( int counter = 0; counter < PERF_COUNTERS_NUM; ++counter ) {
+        PerfCounter*       perfCounter = &set->counters[ counter ];
+        PerfEventCandidate candidates[ PERF_MAX_CANDIDATES ];
+        int                numCandidates = CandidatesOf( counter, hitmRawEvent, candidates );
+
+        perfCounter->name  = counterNames[ counter ];
+        perfCounter->event = NULL;
+        perfCounter->fd    = -1;
+        perfCounter->value = 0;
+        for( int i = 0; i < numCandidates && perfCounter->fd < 0; ++i ) {
+            perfCounter->fd = OpenEvent( &candidates[ i ], inherit );
+            if( perfCounter->fd >= 0 )
+                perfCounter->event = candidates[ i ].name;
+        }
+
+        if( perfCounter->fd >= 0 )
+            numOpen++;
+    }
+
+    return numOpen;
+}
+
+void PerfCounterSet_start( PerfCounterSet* set )
+{
+    for( int counter = 0; counter < PERF_COUNTERS_NUM; ++counter ) {
+        int fd = set->counters[ counter ].fd;
+        if( fd < 0 )
+            continue;
+
+        ioctl( fd, PERF_EVENT_IOC_RESET,  0 );
+        ioctl( fd, PERF_EVENT_IOC_ENABLE, 0 );
+    }
+}
+
+int PerfCounters_numThreads( void )
+{
+    FILE* status = fopen( "/proc/self/status", "r" );
+    if( status == NULL )
+        return -1;
+
+    int  numThreads = -1;
+    char line[ 256 ];
+    while( fgets( line, sizeof( line ), status ) != NULL ) {
+        if( sscanf( line, "Threads: %d", &numThreads ) == 1 )
+            break;
+    }
+
+    fclose( status );
+    return numThreads;
+}
+
+void PerfCounterSet_stop( PerfCounterSet* set, int numThreads, uint64_t waitMs )
+{
+    //Counts of inheriting threads are folded into ours when they exit
+    for( uint64_t waited = 0; waited < waitMs && PerfCounters_numThreads() > numThreads; ++waited )
+        usleep( 1000 );
+
+    for( int counter = 0; counter < PERF_COUNTERS_NUM; ++counter ) {
+        PerfCounter* perfCounter = &set->counters[ counter ];
+        if( perfCounter->fd < 0 )
+            continue;
+
+        ioctl( perfCounter->fd, PERF_EVENT_IOC_DISABLE, 0 );
+
+        uint64_t values[ 3 ];   //value, time enabled, time running
+        if( read( perfCounter->fd, values, sizeof( values ) ) != sizeof( values ) ) {
+            perfCounter->value = 0;
+            continue;
+        }
+
+        perfCounter->value = values[ 0 ];
+        if( values[ 2 ] > 0 && values[ 2 ] < values[ 1 ] )
+            perfCounter->value = (uint64_t)( (double)values[ 0 ] * values[ 1 ] / values[ 2 ] );
+    }
+}
+
+void PerfCounterSet_close( PerfCounterSet* set )
+{
+    for( int counter = 0; counter < PERF_COUNTERS_NUM; ++counter ) {
+        if( set->counters[ counter ].fd >= 0 )
+            close( set->counters[ counter ].fd );
+        set->counters[ counter ].fd = -1;
+    }
+}
+
+void PerfTestCounters_start( PerfTestCounters* counters, uint64_t hitmRawEvent )
+{
+    PerfCounterSet_open( &counters->caller,  false, hitmRawEvent );
+    PerfCounterSet_open( &counters->process, true,  hitmRawEvent );
+    counters->numThreads = PerfCounters_numThreads();
+
+    PerfCounterSet_start( &counters->process );
+    PerfCounterSet_start( &counters->caller );
+}
+
+bool PerfTestCounters_stop( PerfTestCounters* counters )
+{
+    PerfCounterSet_stop( &counters->caller, 0, 0 );
+    PerfCounterSet_stop( &counters->process, counters->numThreads, PERF_THREAD_EXIT_WAIT_MS );
+
+    return PerfCounters_numThreads() <= counters->numThreads;
+}
+
+void PerfTestCounters_close( PerfTestCounters* counters )
+{
+    PerfCounterSet_close( &counters->caller );
+    PerfCounterSet_close( &counters->process );
+}
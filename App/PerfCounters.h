@@ -0,0 +1,83 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Hardware and software event counts around a benchmark, through perf_event_open.
+//A PerfCounterSet counts either the calling thread only, or the calling thread plus every
+//thread it starts while the set is open (inherit): responder threads are covered as long as
+//they exit before PerfCounterSet_stop reads the counts, which is why stop can wait for the
+//process to drop back to a given number of threads.
+//Each counter tries a specific event first and falls back to a generic one; the event that
+//was actually opened is recorded, and a counter the kernel refuses is reported as unavailable.
+//Enclave code is not counted on production SGX hardware unless the enclave is a debug enclave.
+
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include <stdint.h>
+
+enum {
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_LLC_MISSES,
+    PERF_COUNTER_HITM,              //loads served by a modified line in another core's cache
+    PERF_COUNTER_CONTEXT_SWITCHES,
+    PERF_COUNTERS_NUM
+};
+
+typedef struct {
+    const char*     name;
+    const char*     event;      //the event opened, NULL when unavailable
+    int             fd;
+    uint64_t        value;      //scaled up when the kernel had to multiplex
+} PerfCounter;
+
+typedef struct {
+    PerfCounter     counters[ PERF_COUNTERS_NUM ];
+    bool            inherit;
+} PerfCounterSet;
+
+//Opens disabled counters. hitmRawEvent overrides the raw HITM event (0: the Intel default).
+//Returns the number of counters that could be opened.
+int  PerfCounterSet_open( PerfCounterSet* set, bool inherit, uint64_t hitmRawEvent );
+void PerfCounterSet_start( PerfCounterSet* set );
+//Waits up to waitMs for the process to get back to numThreads threads (0: do not wait),
+//then disables the counters and reads them
+void PerfCounterSet_stop( PerfCounterSet* set, int numThreads, uint64_t waitMs );
+void PerfCounterSet_close( PerfCounterSet* set );
+
+//Threads of this process, from /proc/self/status
+int  PerfCounters_numThreads( void );
+
+//How long stopping the counters of a test waits for the threads the test started to exit
+#define PERF_THREAD_EXIT_WAIT_MS    500
+
+//The two sets counted around one test: the caller alone, and the caller plus its threads
+typedef struct {
+    PerfCounterSet  caller;
+    PerfCounterSet  process;
+    int             numThreads;     //threads of the process when the test started
+} PerfTestCounters;
+
+void PerfTestCounters_start( PerfTestCounters* counters, uint64_t hitmRawEvent );
+//False if threads of the test were still running after PERF_THREAD_EXIT_WAIT_MS: their
+//events are missing from the process counts
+bool PerfTestCounters_stop( PerfTestCounters* counters );
+void PerfTestCounters_close( PerfTestCounters* counters );
+
+#endif /* !_PERF_COUNTERS_H_ */
@@ -0,0 +1,323 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "RealtimeIsolation.h"
+
+#define ONLINE_CPUS_PATH        "/sys/devices/system/cpu/online"
+#define ISOLATED_CPUS_PATH      "/sys/devices/system/cpu/isolated"
+#define NOHZ_FULL_CPUS_PATH     "/sys/devices/system/cpu/nohz_full"
+#define RT_RUNTIME_PATH         "/proc/sys/kernel/sched_rt_runtime_us"
+#define CAP_IPC_LOCK_BIT        14
+
+static RealtimeIsolationConfig  realtimeConfig          = { false, REALTIME_ISOLATION_DEFAULT_PRIORITY, 0, 1 };
+static char                     memoryLockState[ 96 ]   = "off";
+static int                      schedulerError          = 0;
+static cpu_set_t                callerSavedCpus;
+static int                      callerSavedPolicy       = SCHED_OTHER;
+static struct sched_param       callerSavedParam;
+
+//First line of a sysfs/procfs file, "" if it cannot be read
+static void ReadLine( const char* path, char* line, size_t size )
+{
+    line[ 0 ] = '\0';
+    FILE* file = fopen( path, "r" );
+    if( file == NULL )
+        return;
+
+    if( fgets( line, size, file ) == NULL )
+        line[ 0 ] = '\0';
+    line[ strcspn( line, "\n" ) ] = '\0';
+    fclose( file );
+}
+
+//cpuList in the kernel's format, e.g. "2-5,7"
+static bool CpuListContains( const char* cpuList, int cpu )
+{
+    const char* cursor = cpuList;
+    while( *cursor != '\0' ) {
+        char* end;
+        long  first = strtol( cursor, &end, 10 );
+        long  last  = first;
+        if( end == cursor )
+            return false;
+        if( *end == '-' ) {
+            cursor = end + 1;
+            last   = strtol( cursor, &end, 10 );
+        }
+        if( cpu >= first && cpu <= last )
+            return true;
+
+        cursor = ( *end == ',' ) ? end + 1 : end;
+        if( *end != ',' && *end != '\0' )
+            return false;
+    }
+    return false;
+}
+
+static int FirstCpus( const char* cpuList, int* cpus, int maxCpus )
+{
+    int numCpus = 0;
+    for( int cpu = 0; cpu < CPU_SETSIZE && numCpus < maxCpus; ++cpu ) {
+        if( CpuListContains( cpuList, cpu ) )
+            cpus[ numCpus++ ] = cpu;
+    }
+    return numCpus;
+}
+
+//CAP_IPC_LOCK, from the effective capabilities in /proc/self/status
+static bool CanLockUnlimited( void )
+{
+    FILE* status = fopen( "/proc/self/status", "r" );
+    if( status == NULL )
+        return false;
+
+    char               line[ 256 ];
+    unsigned long long capabilities = 0;
+    while( fgets( line, sizeof( line ), status ) != NULL ) {
+        if( sscanf( line, "CapEff: %llx", &capabilities ) == 1 )
+            break;
+    }
+    fclose( status );
+
+    return ( capabilities >> CAP_IPC_LOCK_BIT ) & 1;
+}
+
+//Locks what is mapped now, and everything mapped later only when RLIMIT_MEMLOCK cannot run
+//out: past the limit MCL_FUTURE makes every allocation fail, for the rest of the run
+static void LockMemory( void )
+{
+    struct rlimit limit;
+    getrlimit( RLIMIT_MEMLOCK, &limit );
+    const bool unlimited = limit.rlim_cur == RLIM_INFINITY || CanLockUnlimited();
+
+    char limitName[ 32 ];
+    if( unlimited )
+        snprintf( limitName, sizeof( limitName ), "unlimited" );
+    else
+        snprintf( limitName, sizeof( limitName ), "%llu bytes", (unsigned long long)limit.rlim_cur );
+
+    int error = mlockall( unlimited ? MCL_CURRENT | MCL_FUTURE : MCL_CURRENT ) == 0 ? 0 : errno;
+    if( error != 0 ) {
+        printf( "Warning: cannot lock memory (%s, limit %s), samples may take page faults\n", strerror( error ), limitName );
+        snprintf( memoryLockState, sizeof( memoryLockState ), "%s, limit %s", strerror( error ), limitName );
+    }
+    else if( ! unlimited ) {
+        printf( "Warning: memory lock limit is %s, memory allocated from now on is not locked\n", limitName );
+        snprintf( memoryLockState, sizeof( memoryLockState ), "current only, limit %s", limitName );
+    }
+    else
+        snprintf( memoryLockState, sizeof( memoryLockState ), "current and future, limit %s", limitName );
+}
+
+static int EnterRealtime( int cpu )
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO( &cpuSet );
+    CPU_SET( cpu, &cpuSet );
+
+    struct sched_param param;
+    memset( &param, 0, sizeof( param ) );
+    param.sched_priority = realtimeConfig.priority;
+
+    int ret = pthread_setaffinity_np( pthread_self(), sizeof( cpuSet ), &cpuSet );
+    if( ret != 0 )
+        return ret;
+    return pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+}
+
+void RealtimeIsolation_defaultConfig( RealtimeIsolationConfig* config )
+{
+    char isolated[ 256 ];
+    int  cpus[ 2 ] = { 0, 1 };
+    ReadLine( ISOLATED_CPUS_PATH, isolated, sizeof( isolated ) );
+    FirstCpus( isolated, cpus, 2 );
+
+    config->enabled      = false;
+    config->priority     = REALTIME_ISOLATION_DEFAULT_PRIORITY;
+    config->callerCpu    = cpus[ 0 ];
+    config->responderCpu = cpus[ 1 ];
+}
+
+bool RealtimeIsolation_configure( const RealtimeIsolationConfig* config )
+{
+    realtimeConfig.enabled = false;
+    if( ! config->enabled )
+        return true;
+
+    if( config->callerCpu == config->responderCpu ) {
+        printf( "Error! The real-time caller and responder need different CPUs\n" );
+        return false;
+    }
+    //Not the affinity of the process: isolated CPUs are outside it unless asked for
+    char online[ 256 ];
+    ReadLine( ONLINE_CPUS_PATH, online, sizeof( online ) );
+    if( ! CpuListContains( online, config->callerCpu ) || ! CpuListContains( online, config->responderCpu ) ) {
+        printf( "Error! Real-time cpus %d and %d must be online (%s)\n", config->callerCpu, config->responderCpu, online );
+        return false;
+    }
+    if( config->priority < sched_get_priority_min( SCHED_FIFO ) || config->priority > sched_get_priority_max( SCHED_FIFO ) ) {
+        printf( "Error! SCHED_FIFO priority %d is out of range\n", config->priority );
+        return false;
+    }
+
+    realtimeConfig         = *config;
+    realtimeConfig.enabled = true;
+
+    LockMemory();
+
+    //Responders have the same privileges as the caller, so one attempt tells for both
+    RealtimeIsolation_enterCaller();
+    RealtimeIsolation_leaveCaller();
+    if( schedulerError != 0 )
+        printf( "Warning: cannot run under SCHED_FIFO on cpu %d (%s)\n", realtimeConfig.callerCpu, strerror( schedulerError ) );
+
+    return true;
+}
+
+bool RealtimeIsolation_isEnabled( void )
+{
+    return realtimeConfig.enabled;
+}
+
+void RealtimeIsolation_describe( MeasurementHeader* header )
+{
+    char isolated[ 256 ];
+    char nohzFull[ 256 ];
+    char rtRuntime[ 32 ];
+    char value[ 64 ];
+    ReadLine( ISOLATED_CPUS_PATH,  isolated,  sizeof( isolated ) );
+    ReadLine( NOHZ_FULL_CPUS_PATH, nohzFull,  sizeof( nohzFull ) );
+    ReadLine( RT_RUNTIME_PATH,     rtRuntime, sizeof( rtRuntime ) );
+
+    MeasurementHeader_addExtra( header, "kernel.isolated-cpus", isolated[ 0 ] != '\0' ? isolated : "none" );
+    MeasurementHeader_addExtra( header, "kernel.nohz-full-cpus", nohzFull[ 0 ] != '\0' ? nohzFull : "none" );
+    //-1: RT throttling off; otherwise FIFO threads are paused for the rest of every period
+    MeasurementHeader_addExtra( header, "kernel.sched-rt-runtime-us", rtRuntime[ 0 ] != '\0' ? rtRuntime : "unknown" );
+
+    MeasurementHeader_addExtra( header, "rt", realtimeConfig.enabled ? "on" : "off" );
+    if( ! realtimeConfig.enabled )
+        return;
+
+    snprintf( value, sizeof( value ), "%d", realtimeConfig.priority );
+    MeasurementHeader_addExtra( header, "rt.priority", value );
+    snprintf( value, sizeof( value ), "%d (%s)", realtimeConfig.callerCpu,
+              CpuListContains( isolated, realtimeConfig.callerCpu ) ? "isolated" : "not isolated" );
+    MeasurementHeader_addExtra( header, "rt.caller-cpu", value );
+    snprintf( value, sizeof( value ), "%d (%s)", realtimeConfig.responderCpu,
+              CpuListContains( isolated, realtimeConfig.responderCpu ) ? "isolated" : "not isolated" );
+    MeasurementHeader_addExtra( header, "rt.responder-cpu", value );
+    MeasurementHeader_addExtra( header, "rt.mlock", memoryLockState );
+    MeasurementHeader_addExtra( header, "rt.sched-fifo", schedulerError == 0 ? "ok" : strerror( schedulerError ) );
+}
+
+void RealtimeIsolation_enterCaller( void )
+{
+    if( ! realtimeConfig.enabled )
+        return;
+
+    pthread_getaffinity_np( pthread_self(), sizeof( callerSavedCpus ), &callerSavedCpus );
+    pthread_getschedparam( pthread_self(), &callerSavedPolicy, &callerSavedParam );
+    schedulerError = EnterRealtime( realtimeConfig.callerCpu );
+}
+
+void RealtimeIsolation_leaveCaller( void )
+{
+    if( ! realtimeConfig.enabled )
+        return;
+
+    pthread_setschedparam( pthread_self(), callerSavedPolicy, &callerSavedParam );
+    pthread_setaffinity_np( pthread_self(), sizeof( callerSavedCpus ), &callerSavedCpus );
+}
+
+int RealtimeIsolation_createResponder( pthread_t* thread, void* (*function)(void*), void* arg )
+{
+    if( ! realtimeConfig.enabled )
+        return pthread_create( thread, NULL, function, arg );
+
+    //Real-time and pinned from the first instruction, not inherited from the creator
+    pthread_attr_t     attributes;
+    cpu_set_t          cpuSet;
+    struct sched_param param;
+    CPU_ZERO( &cpuSet );
+    CPU_SET( realtimeConfig.responderCpu, &cpuSet );
+    memset( &param, 0, sizeof( param ) );
+    param.sched_priority = realtimeConfig.priority;
+
+    pthread_attr_init( &attributes );
+    pthread_attr_setaffinity_np( &attributes, sizeof( cpuSet ), &cpuSet );
+    pthread_attr_setinheritsched( &attributes, PTHREAD_EXPLICIT_SCHED );
+    pthread_attr_setschedpolicy( &attributes, SCHED_FIFO );
+    pthread_attr_setschedparam( &attributes, &param );
+    int ret = pthread_create( thread, &attributes, function, arg );
+    if( ret == EPERM ) {
+        //Not permitted to run real-time: still pinned, as recorded in rt.sched-fifo
+        pthread_attr_setinheritsched( &attributes, PTHREAD_INHERIT_SCHED );
+        ret = pthread_create( thread, &attributes, function, arg );
+    }
+    pthread_attr_destroy( &attributes );
+
+    return ret;
+}
+
+bool SwitchProbe_open( SwitchProbe* probe, pid_t responderTid )
+{
+    probe->responderStatFd = -1;
+    if( responderTid == 0 )
+        return true;
+
+    char path[ 64 ];
+    snprintf( path, sizeof( path ), "/proc/self/task/%d/schedstat", (int)responderTid );
+    probe->responderStatFd = open( path, O_RDONLY );
+
+    return probe->responderStatFd >= 0;
+}
+
+void SwitchProbe_read( const SwitchProbe* probe, SwitchCounts* counts )
+{
+    struct rusage usage;
+    getrusage( RUSAGE_THREAD, &usage );
+    counts->callerSwitches    = usage.ru_nivcsw;
+    counts->responderSwitches = 0;
+
+    //schedstat: time on the CPU, time waiting to run, number of times scheduled in
+    char    stat[ 128 ];
+    ssize_t length = probe->responderStatFd >= 0 ? pread( probe->responderStatFd, stat, sizeof( stat ) - 1, 0 ) : -1;
+    if( length > 0 ) {
+        unsigned long long runNs, waitNs, numScheduled;
+        stat[ length ] = '\0';
+        if( sscanf( stat, "%llu %llu %llu", &runNs, &waitNs, &numScheduled ) == 3 )
+            counts->responderSwitches = numScheduled;
+    }
+}
+
+void SwitchProbe_close( SwitchProbe* probe )
+{
+    if( probe->responderStatFd >= 0 )
+        close( probe->responderStatFd );
+    probe->responderStatFd = -1;
+}
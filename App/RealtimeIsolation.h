@@ -0,0 +1,79 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Real-time isolation mode for the basic benchmarks. Responder threads and the measuring
+//caller run under SCHED_FIFO, each pinned to its own CPU (ideally isolated with isolcpus or
+//nohz_full), with all memory locked so no sample takes a page fault. What was actually
+//applied, and how the kernel isolates CPUs, goes into the metadata of every column.
+//
+//Outliers that remain are attributed with a SwitchProbe, read before and after every sample:
+//a sample during which the caller was preempted, or the responder was scheduled out, is
+//charged to the scheduler; the rest come from interrupts, AEX or SMIs.
+
+#ifndef _REALTIME_ISOLATION_H_
+#define _REALTIME_ISOLATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "MeasurementStore.h"
+
+#define REALTIME_ISOLATION_DEFAULT_PRIORITY     50
+
+typedef struct {
+    bool        enabled;
+    int         priority;           //SCHED_FIFO priority of callers and responders
+    int         callerCpu;
+    int         responderCpu;       //Must differ from callerCpu: two spinning FIFO threads on one CPU starve each other
+} RealtimeIsolationConfig;
+
+//Caller and responder default to the first two isolated CPUs, or CPUs 0 and 1
+void RealtimeIsolation_defaultConfig( RealtimeIsolationConfig* config );
+//Locks memory (allocations made later too, if RLIMIT_MEMLOCK allows) and checks that
+//SCHED_FIFO is permitted. False if the config is unusable;
+//failures to lock or to raise the priority only print a warning and are recorded.
+bool RealtimeIsolation_configure( const RealtimeIsolationConfig* config );
+bool RealtimeIsolation_isEnabled( void );
+//Adds the isolation state to the metadata: what was requested and applied, isolated CPUs,
+//nohz_full CPUs and RT throttling
+void RealtimeIsolation_describe( MeasurementHeader* header );
+
+//The current thread becomes the caller until leave restores its affinity and policy. Threads
+//created in between would inherit both, so start responders before. No-ops when the mode is off.
+void RealtimeIsolation_enterCaller( void );
+void RealtimeIsolation_leaveCaller( void );
+//pthread_create, with the new thread under SCHED_FIFO on the responder CPU when the mode is on
+int  RealtimeIsolation_createResponder( pthread_t* thread, void* (*function)(void*), void* arg );
+
+typedef struct {
+    int         responderStatFd;    //-1 without a responder
+} SwitchProbe;
+
+typedef struct {
+    uint64_t    callerSwitches;     //involuntary context switches of the caller
+    uint64_t    responderSwitches;  //times the responder was scheduled in
+} SwitchCounts;
+
+//responderTid 0: the caller alone (SDK calls)
+bool SwitchProbe_open( SwitchProbe* probe, pid_t responderTid );
+void SwitchProbe_read( const SwitchProbe* probe, SwitchCounts* counts );
+void SwitchProbe_close( SwitchProbe* probe );
+
+#endif /* !_REALTIME_ISOLATION_H_ */
@@ -0,0 +1,226 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SharedChannels.h"
+
+static size_t SegmentSize( uint32_t numChannels )
+{
+    return sizeof( SharedChannelsSegment ) + (size_t)numChannels * sizeof( HotSharedChannel );
+}
+
+uint64_t SharedProcess_startTime( pid_t pid )
+{
+    char path[ 64 ];
+    char stat[ 1024 ];
+    snprintf( path, sizeof( path ), "/proc/%d/stat", (int)pid );
+
+    FILE* statFile = fopen( path, "r" );
+    if( statFile == NULL )
+        return 0;
+    size_t length = fread( stat, 1, sizeof( stat ) - 1, statFile );
+    fclose( statFile );
+    stat[ length ] = '\0';
+
+    //The command name may hold spaces and parentheses; fields resume after the last ')'.
+    //State is field 3, start time field 22.
+    char* fields = strrchr( stat, ')' );
+    if( fields == NULL )
+        return 0;
+
+    char               state;
+    unsigned long long startTime = 0;
+    if( sscanf( fields + 2, "%c %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %llu",
+                &state, &startTime ) != 2 )
+        return 0;
+
+    //A zombie has already exited
+    if( state == 'Z' || state == 'X' )
+        return 0;
+
+    return startTime;
+}
+
+bool SharedProcess_alive( pid_t pid, uint64_t startTime )
+{
+    return pid != 0 && SharedProcess_startTime( pid ) == startTime;
+}
+
+static bool MapSegment( SharedChannels* channels, size_t size )
+{
+    void* address = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, channels->fd, 0 );
+    if( address == MAP_FAILED )
+        return false;
+
+    channels->segment    = (SharedChannelsSegment*)address;
+    channels->mappedSize = size;
+    return true;
+}
+
+bool SharedChannels_create( SharedChannels* channels, const char* name, uint32_t numChannels )
+{
+    const size_t size = SegmentSize( numChannels );
+
+    channels->owner = true;
+    snprintf( channels->name, sizeof( channels->name ), "%s", name );
+    channels->fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+    if( channels->fd < 0 )
+        return false;
+
+    if( ftruncate( channels->fd, size ) != 0 || ! MapSegment( channels, size ) ) {
+        close( channels->fd );
+        shm_unlink( name );
+        return false;
+    }
+
+    SharedChannelsSegment* segment = channels->segment;
+    for( uint32_t i = 0; i < numChannels; ++i )
+        HotSharedChannel_init( &segment->channels[ i ] );
+    segment->header.fields.version        = SHARED_CHANNELS_VERSION;
+    segment->header.fields.numChannels    = numChannels;
+    segment->header.fields.ownerPid       = getpid();
+    segment->header.fields.ownerStartTime = SharedProcess_startTime( getpid() );
+    //Attachers check the magic last
+    __atomic_store_n( &segment->header.fields.magic, SHARED_CHANNELS_MAGIC, __ATOMIC_RELEASE );
+
+    return true;
+}
+
+bool SharedChannels_attach( SharedChannels* channels, const char* name )
+{
+    struct stat st;
+
+    channels->owner = false;
+    snprintf( channels->name, sizeof( channels->name ), "%s", name );
+    channels->fd = shm_open( name, O_RDWR, 0 );
+    if( channels->fd < 0 )
+        return false;
+
+    if( fstat( channels->fd, &st ) != 0 || (size_t)st.st_size < sizeof( SharedChannelsSegment ) ||
+        ! MapSegment( channels, st.st_size ) ) {
+        close( channels->fd );
+        return false;
+    }
+
+    const SharedChannelsSegment* segment = channels->segment;
+    if( __atomic_load_n( &segment->header.fields.magic, __ATOMIC_ACQUIRE ) != SHARED_CHANNELS_MAGIC ||
+        segment->header.fields.version != SHARED_CHANNELS_VERSION ||
+        SegmentSize( segment->header.fields.numChannels ) > channels->mappedSize ) {
+        SharedChannels_close( channels );
+        return false;
+    }
+
+    return true;
+}
+
+void SharedChannels_close( SharedChannels* channels )
+{
+    munmap( channels->segment, channels->mappedSize );
+    close( channels->fd );
+    if( channels->owner )
+        shm_unlink( channels->name );
+
+    channels->fd      = -1;
+    channels->segment = NULL;
+}
+
+HotSharedChannel* SharedChannels_claim( SharedChannels* channels )
+{
+    const uint32_t pid         = getpid();
+    const uint32_t numChannels = channels->segment->header.fields.numChannels;
+    for( uint32_t i = 0; i < numChannels; ++i ) {
+        HotSharedChannel* channel = &channels->segment->channels[ i ];
+        uint32_t          free    = 0;
+        if( ! __atomic_compare_exchange_n( &channel->callerPid, &free, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) )
+            continue;
+
+        //Until the start time is set the owner only checks that some process has our pid
+        __atomic_store_n( &channel->callerStartTime, SharedProcess_startTime( pid ), __ATOMIC_RELEASE );
+        return channel;
+    }
+
+    return NULL;
+}
+
+void SharedChannels_release( HotSharedChannel* channel )
+{
+    __atomic_store_n( &channel->callerStartTime, 0, __ATOMIC_RELAXED );
+    __atomic_store_n( &channel->callerPid, 0, __ATOMIC_RELEASE );
+}
+
+bool SharedChannels_ownerAlive( const SharedChannels* channels )
+{
+    return SharedProcess_alive( channels->segment->header.fields.ownerPid,
+                                channels->segment->header.fields.ownerStartTime );
+}
+
+int SharedChannels_requestCall( SharedChannels* channels, HotSharedChannel* channel,
+                                uint16_t callID, uint32_t payloadSize )
+{
+    if( ! HotSharedChannel_post( channel, callID, payloadSize ) )
+        return SHARED_CHANNELS_ERROR_BUSY;
+
+    for( uint32_t spins = 1; ! HotSharedChannel_poll( channel ); ++spins ) {
+        if( spins % SHARED_CHANNELS_LIVENESS_SPINS == 0 && ! SharedChannels_ownerAlive( channels ) )
+            return SHARED_CHANNELS_ERROR_PEER_DEAD;
+        _mm_pause();
+    }
+
+    return SHARED_CHANNELS_OK;
+}
+
+uint32_t SharedChannels_reapDeadCallers( SharedChannels* channels )
+{
+    uint32_t       numReaped   = 0;
+    const uint32_t numChannels = channels->segment->header.fields.numChannels;
+    for( uint32_t i = 0; i < numChannels; ++i ) {
+        HotSharedChannel* channel   = &channels->segment->channels[ i ];
+        uint32_t          pid       = __atomic_load_n( &channel->callerPid, __ATOMIC_ACQUIRE );
+        uint64_t          startTime = __atomic_load_n( &channel->callerStartTime, __ATOMIC_ACQUIRE );
+        if( pid == 0 )
+            continue;
+
+        //A caller that died between claiming the channel and setting its start time left 0
+        bool alive = startTime != 0 ? SharedProcess_alive( pid, startTime ) : SharedProcess_startTime( pid ) != 0;
+        if( alive )
+            continue;
+
+        //The responder still owns a posted call; it completes it to DONE
+        if( __atomic_load_n( &channel->state, __ATOMIC_ACQUIRE ) == HOTCALL_SHARED_POSTED )
+            continue;
+
+        //Only from the caller judged dead: if it released the channel and a new caller claimed
+        //it meanwhile, the pid differs and the channel is left alone. Holding the channel under
+        //a pid no process has keeps new callers out until it is reset.
+        if( ! __atomic_compare_exchange_n( &channel->callerPid, &pid, SHARED_CHANNELS_REAPING_PID, false,
+                                           __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) )
+            continue;
+
+        __atomic_store_n( &channel->state, HOTCALL_SHARED_IDLE, __ATOMIC_RELAXED );
+        SharedChannels_release( channel );
+        numReaped++;
+    }
+
+    return numReaped;
+}
@@ -0,0 +1,89 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Named shared memory segment of cross-process hot call channels (include/hot_calls_shared.h).
+//The process that owns the enclave creates the segment and runs a responder per channel;
+//any other process attaches to it by name (shm_open) and claims a free channel for itself.
+//Either side detects a dead peer from its pid and start time (/proc/<pid>/stat), so a
+//recycled pid is not mistaken for the peer.
+
+#ifndef _SHARED_CHANNELS_H_
+#define _SHARED_CHANNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "../include/hot_calls_shared.h"
+
+#define SHARED_CHANNELS_MAGIC           0x314353484348ULL      //"HCHSC1"
+#define SHARED_CHANNELS_VERSION         1
+#define SHARED_CHANNELS_NAME_SIZE       64
+#define SHARED_CHANNELS_LIVENESS_SPINS  65536   //Polls of a call between liveness checks of the owner
+#define SHARED_CHANNELS_REAPING_PID     0xFFFFFFFFu //callerPid while the owner resets a dead caller's channel
+
+#define SHARED_CHANNELS_OK              0
+#define SHARED_CHANNELS_ERROR_BUSY      -1      //A call is still outstanding on the channel
+#define SHARED_CHANNELS_ERROR_PEER_DEAD -2      //The owner died; the call may or may not have run
+
+typedef struct {
+    union {
+        struct {
+            uint64_t    magic;
+            uint32_t    version;
+            uint32_t    numChannels;
+            uint32_t    ownerPid;
+            uint64_t    ownerStartTime;
+        } fields;
+        uint8_t         padding[ 64 ];
+    } header;
+    HotSharedChannel    channels[];
+} SharedChannelsSegment;
+
+typedef struct {
+    int                     fd;
+    size_t                  mappedSize;
+    SharedChannelsSegment*  segment;
+    bool                    owner;
+    char                    name[ SHARED_CHANNELS_NAME_SIZE ];
+} SharedChannels;
+
+//name is a POSIX shared memory name, e.g. "/hotcalls-1234". Fails if it already exists.
+bool              SharedChannels_create( SharedChannels* channels, const char* name, uint32_t numChannels );
+bool              SharedChannels_attach( SharedChannels* channels, const char* name );
+//Unmaps the segment; the owner also removes its name
+void              SharedChannels_close( SharedChannels* channels );
+
+//Caller side: takes a free channel for this process, NULL if every channel is taken
+HotSharedChannel* SharedChannels_claim( SharedChannels* channels );
+void              SharedChannels_release( HotSharedChannel* channel );
+//Posts a call with the payload already in channel->payload and waits for it
+int               SharedChannels_requestCall( SharedChannels* channels, HotSharedChannel* channel,
+                                              uint16_t callID, uint32_t payloadSize );
+
+//Owner side: frees the channels of callers that died and returns how many. A channel whose
+//call is still running is freed by a later pass, once the responder completed it.
+uint32_t          SharedChannels_reapDeadCallers( SharedChannels* channels );
+
+bool              SharedChannels_ownerAlive( const SharedChannels* channels );
+//0 if the process does not exist
+uint64_t          SharedProcess_startTime( pid_t pid );
+bool              SharedProcess_alive( pid_t pid, uint64_t startTime );
+
+#endif /* !_SHARED_CHANNELS_H_ */
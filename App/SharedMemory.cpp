@@ -0,0 +1,231 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "SharedMemory.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT  26
+#endif
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB    ( 21 << MAP_HUGE_SHIFT )
+#endif
+
+static size_t RoundUp( size_t value, size_t alignment )
+{
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+static bool BindToNode( void* address, size_t size, int numaNode )
+{
+    unsigned long nodeMask[ 16 ] = {0};
+    const unsigned long bitsPerWord = 8 * sizeof( unsigned long );
+
+    if( numaNode < 0 || (size_t)numaNode >= 16 * bitsPerWord )
+        return false;
+
+    nodeMask[ numaNode / bitsPerWord ] = 1UL << ( numaNode % bitsPerWord );
+    return syscall( SYS_mbind, address, size, MPOL_BIND, nodeMask, 16 * bitsPerWord, MPOL_MF_MOVE ) == 0;
+}
+
+bool SharedMemory_allocate( SharedMemoryRegion* region, size_t size, int numaNode )
+{
+    size_t mappedSize = RoundUp( size == 0 ? 1 : size, SHARED_MEMORY_HUGE_PAGE_SIZE );
+
+    region->address   = NULL;
+    region->size      = 0;
+    region->numaNode  = SHARED_MEMORY_ANY_NODE;
+    region->hugePages = false;
+
+    //Explicit hugepages are only there if the admin reserved some (vm.nr_hugepages)
+    void* address = mmap( NULL, mappedSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0 );
+    if( address != MAP_FAILED ) {
+        region->hugePages = true;
+    }
+    else {
+        address = mmap( NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( address == MAP_FAILED ) {
+            perror( "SharedMemory_allocate: mmap" );
+            return false;
+        }
+        madvise( address, mappedSize, MADV_HUGEPAGE );
+    }
+
+    //Bind before the first touch, so the pages are allocated on the requested node
+    if( numaNode != SHARED_MEMORY_ANY_NODE ) {
+        if( BindToNode( address, mappedSize, numaNode ) )
+            region->numaNode = numaNode;
+        else
+            printf( "Warning: failed to bind shared memory to NUMA node %d\n", numaNode );
+    }
+
+    const size_t pageSize = sysconf( _SC_PAGESIZE );
+    for( size_t offset = 0; offset < mappedSize; offset += pageSize )
+        ((volatile uint8_t*)address)[ offset ] = 0;
+
+    region->address = address;
+    region->size    = mappedSize;
+    return true;
+}
+
+void SharedMemory_free( SharedMemoryRegion* region )
+{
+    if( region->address != NULL )
+        munmap( region->address, region->size );
+
+    region->address = NULL;
+    region->size    = 0;
+}
+
+bool SharedMemoryArena_init( SharedMemoryArena* arena, size_t size, int numaNode )
+{
+    arena->used = 0;
+    return SharedMemory_allocate( &arena->region, size, numaNode );
+}
+
+void* SharedMemoryArena_alloc( SharedMemoryArena* arena, size_t size )
+{
+    size_t offset = RoundUp( arena->used, SHARED_MEMORY_CACHE_LINE_SIZE );
+    if( offset + size > arena->region.size )
+        return NULL;
+
+    arena->used = offset + size;
+    return (uint8_t*)arena->region.address + offset;
+}
+
+void SharedMemoryArena_destroy( SharedMemoryArena* arena )
+{
+    SharedMemory_free( &arena->region );
+    arena->used = 0;
+}
+
+int SharedMemory_numNumaNodes( void )
+{
+    DIR* dir = opendir( "/sys/devices/system/node" );
+    if( dir == NULL )
+        return 1;
+
+    int numNodes = 0;
+    struct dirent* entry;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        int node;
+        if( sscanf( entry->d_name, "node%d", &node ) == 1 )
+            numNodes++;
+    }
+    closedir( dir );
+
+    return numNodes > 0 ? numNodes : 1;
+}
+
+int SharedMemory_otherNumaNode( int numaNode )
+{
+    //Node ids need not be contiguous, and the cpuset may exclude some: the first node this
+    //process may allocate on (online and allowed), else the first node directory in sysfs
+    unsigned long allowed[ 16 ] = {0};
+    const unsigned long bitsPerWord = 8 * sizeof( unsigned long );
+    if( syscall( SYS_get_mempolicy, NULL, allowed, 16 * bitsPerWord, NULL, MPOL_F_MEMS_ALLOWED ) == 0 ) {
+        for( int node = 0; node < (int)( 16 * bitsPerWord ); ++node ) {
+            if( node != numaNode && ( ( allowed[ node / bitsPerWord ] >> ( node % bitsPerWord ) ) & 1 ) )
+                return node;
+        }
+        return numaNode;
+    }
+
+    DIR* dir = opendir( "/sys/devices/system/node" );
+    if( dir == NULL )
+        return numaNode;
+
+    int other = -1;
+    struct dirent* entry;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        int node;
+        if( sscanf( entry->d_name, "node%d", &node ) == 1 && node != numaNode && ( other < 0 || node < other ) )
+            other = node;
+    }
+    closedir( dir );
+
+    return other >= 0 ? other : numaNode;
+}
+
+int SharedMemory_numaNodeOfCpu( int cpu )
+{
+    char path[ 64 ];
+    snprintf( path, sizeof( path ), "/sys/devices/system/cpu/cpu%d", cpu );
+
+    DIR* dir = opendir( path );
+    if( dir == NULL )
+        return 0;
+
+    int node = 0;
+    struct dirent* entry;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        if( sscanf( entry->d_name, "node%d", &node ) == 1 )
+            break;
+    }
+    closedir( dir );
+
+    return node;
+}
+
+int SharedMemory_currentNumaNode( void )
+{
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : SharedMemory_numaNodeOfCpu( cpu );
+}
+
+int PinCurrentThreadToCpu( int cpu )
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO( &cpuSet );
+    CPU_SET( cpu, &cpuSet );
+
+    return pthread_setaffinity_np( pthread_self(), sizeof( cpuSet ), &cpuSet );
+}
+
+int CreatePinnedThread( pthread_t* thread, int cpu, void* (*function)(void*), void* arg )
+{
+    if( cpu < 0 )
+        return pthread_create( thread, NULL, function, arg );
+
+    //Pinned from the first instruction, so the thread never runs (or faults memory in) elsewhere
+    pthread_attr_t attributes;
+    cpu_set_t      cpuSet;
+    CPU_ZERO( &cpuSet );
+    CPU_SET( cpu, &cpuSet );
+
+    pthread_attr_init( &attributes );
+    pthread_attr_setaffinity_np( &attributes, sizeof( cpuSet ), &cpuSet );
+    int ret = pthread_create( thread, &attributes, function, arg );
+    pthread_attr_destroy( &attributes );
+
+    return ret;
+}
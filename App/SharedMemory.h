@@ -0,0 +1,67 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Untrusted shared memory for channels, rings and payloads.
+//Regions are backed by 2MB hugepages when the system has them reserved
+//(falling back to transparent hugepages), bound to a NUMA node and pre-faulted,
+//so neither the caller nor the responder takes a page fault on the hot path.
+
+#ifndef _SHARED_MEMORY_H_
+#define _SHARED_MEMORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define SHARED_MEMORY_HUGE_PAGE_SIZE    ( 2 * 1024 * 1024 )
+#define SHARED_MEMORY_CACHE_LINE_SIZE   64
+#define SHARED_MEMORY_ANY_NODE          -1
+
+typedef struct {
+    void*   address;
+    size_t  size;       //Mapped size, rounded up to a hugepage
+    int     numaNode;   //SHARED_MEMORY_ANY_NODE if the region is not bound
+    bool    hugePages;  //true if backed by explicitly reserved hugetlb pages
+} SharedMemoryRegion;
+
+//Carves channels and buffers out of one region, each aligned to a cache line
+typedef struct {
+    SharedMemoryRegion region;
+    size_t             used;
+} SharedMemoryArena;
+
+//Returns false if no memory could be mapped. Binding to numaNode is best effort.
+bool  SharedMemory_allocate( SharedMemoryRegion* region, size_t size, int numaNode );
+void  SharedMemory_free( SharedMemoryRegion* region );
+
+bool  SharedMemoryArena_init( SharedMemoryArena* arena, size_t size, int numaNode );
+void* SharedMemoryArena_alloc( SharedMemoryArena* arena, size_t size );
+void  SharedMemoryArena_destroy( SharedMemoryArena* arena );
+
+int   SharedMemory_numNumaNodes( void );
+//The lowest node other than numaNode that memory can be allocated on, or numaNode if none
+int   SharedMemory_otherNumaNode( int numaNode );
+int   SharedMemory_numaNodeOfCpu( int cpu );
+int   SharedMemory_currentNumaNode( void );
+
+//Thread placement, so the node of a pinned caller or responder is known up front
+int   PinCurrentThreadToCpu( int cpu );
+int   CreatePinnedThread( pthread_t* thread, int cpu, void* (*function)(void*), void* arg );
+
+#endif /* !_SHARED_MEMORY_H_ */
@@ -0,0 +1,35 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//splitmix64: the small, fast generator shared by the workload and arrival generators. Each
+//generator keeps its own 64-bit state, so runs with the same seed are reproducible.
+
+#ifndef _SPLIT_MIX_H_
+#define _SPLIT_MIX_H_
+
+#include <stdint.h>
+
+static inline uint64_t SplitMix64_next( uint64_t* state )
+{
+    uint64_t z = ( *state += 0x9e3779b97f4a7c15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+#endif /* !_SPLIT_MIX_H_ */
@@ -0,0 +1,128 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TransitionEmulation.h"
+
+#define EMULATION_PAGE_SIZE         4096
+#define EMULATION_CACHE_LINE_SIZE   64
+
+static TransitionEmulationConfig    emulationConfig;
+static uint8_t*                     flushBuffer     = NULL;
+static uint64_t                     flushBufferSize = 0;
+
+//Per thread: when the thread entered the enclave, and in-enclave cycles not yet charged an AEX
+static __thread uint64_t            enclaveEntryTime = 0;
+static __thread uint64_t            aexBudget        = 0;
+
+static inline uint64_t ReadTsc( void )
+{
+    unsigned int low, high;
+
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+
+    return low | ((uint64_t)high) << 32;
+}
+
+static void BusyWait( uint64_t cycles )
+{
+    uint64_t endTime = ReadTsc() + cycles;
+    while( ReadTsc() < endTime )
+        asm volatile("pause");
+}
+
+static void Flush( void )
+{
+    volatile uint8_t sink = 0;
+
+    //Reads only, so threads flushing at the same time do not bounce lines between each other
+    for( uint64_t offset = 0; offset < emulationConfig.flushBytes; offset += EMULATION_CACHE_LINE_SIZE )
+        sink += flushBuffer[ offset ];
+
+    //One line per page, spread over the lines of each page so the L1 sets are not all the same
+    for( uint64_t page = 0; page < emulationConfig.tlbPages; ++page ) {
+        uint64_t offset = page * EMULATION_PAGE_SIZE + ( page % ( EMULATION_PAGE_SIZE / EMULATION_CACHE_LINE_SIZE ) ) * EMULATION_CACHE_LINE_SIZE;
+        sink += flushBuffer[ offset ];
+    }
+
+    (void)sink;
+}
+
+void TransitionEmulation_defaultConfig( TransitionEmulationConfig* config )
+{
+    config->enabled             = false;
+    config->enterCycles         = TRANSITION_EMULATION_DEFAULT_ENTER_CYCLES;
+    config->exitCycles          = TRANSITION_EMULATION_DEFAULT_EXIT_CYCLES;
+    config->flushBytes          = TRANSITION_EMULATION_DEFAULT_FLUSH_BYTES;
+    config->tlbPages            = TRANSITION_EMULATION_DEFAULT_TLB_PAGES;
+    config->aexIntervalCycles   = TRANSITION_EMULATION_DEFAULT_AEX_INTERVAL;
+    config->aexCycles           = TRANSITION_EMULATION_DEFAULT_AEX_CYCLES;
+}
+
+void TransitionEmulation_configure( const TransitionEmulationConfig* config )
+{
+    emulationConfig = *config;
+
+    uint64_t requiredSize = emulationConfig.flushBytes;
+    if( emulationConfig.tlbPages * EMULATION_PAGE_SIZE > requiredSize )
+        requiredSize = emulationConfig.tlbPages * EMULATION_PAGE_SIZE;
+
+    if( requiredSize > flushBufferSize ) {
+        free( flushBuffer );
+        flushBuffer     = (uint8_t*)malloc( requiredSize );
+        flushBufferSize = requiredSize;
+        memset( flushBuffer, 1, flushBufferSize );
+    }
+}
+
+bool TransitionEmulation_isEnabled( void )
+{
+    return emulationConfig.enabled;
+}
+
+void TransitionEmulation_enter( void )
+{
+    if( ! emulationConfig.enabled )
+        return;
+
+    BusyWait( emulationConfig.enterCycles );
+    Flush();
+    enclaveEntryTime = ReadTsc();
+}
+
+void TransitionEmulation_exit( void )
+{
+    if( ! emulationConfig.enabled )
+        return;
+
+    //Interrupts that would have hit the enclave since it was entered, each one an AEX + ERESUME
+    if( emulationConfig.aexIntervalCycles > 0 && enclaveEntryTime != 0 ) {
+        aexBudget += ReadTsc() - enclaveEntryTime;
+        while( aexBudget >= emulationConfig.aexIntervalCycles ) {
+            aexBudget -= emulationConfig.aexIntervalCycles;
+            BusyWait( emulationConfig.aexCycles );
+            Flush();
+        }
+    }
+    enclaveEntryTime = 0;
+
+    BusyWait( emulationConfig.exitCycles );
+    Flush();
+}
@@ -0,0 +1,62 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Emulated enclave transition costs for SGX_MODE=SIM.
+//The simulation runtime enters and leaves the "enclave" with a plain function call, so
+//SDK ecalls/ocalls cost almost nothing and hot-vs-SDK ratios mean nothing. When enabled,
+//every SDK transition pays:
+//  - a busy wait of a calibrated number of TSC cycles (EENTER / EEXIT)
+//  - an approximate flush: reading flushBytes of an unrelated buffer to evict L1/L2 lines,
+//    and touching tlbPages distinct pages to evict TLB entries
+//  - AEX-style interrupts: for every aexIntervalCycles spent inside the enclave, one extra
+//    aexCycles penalty plus a flush, charged when the enclave is left
+//Hot calls never cross the boundary, so they are not affected.
+
+#ifndef _TRANSITION_EMULATION_H_
+#define _TRANSITION_EMULATION_H_
+
+#include <stdint.h>
+
+typedef struct {
+    bool        enabled;
+    uint64_t    enterCycles;
+    uint64_t    exitCycles;
+    uint64_t    flushBytes;
+    uint64_t    tlbPages;
+    uint64_t    aexIntervalCycles;  //0 disables AEX emulation
+    uint64_t    aexCycles;
+} TransitionEmulationConfig;
+
+//Defaults roughly follow warm SDK ecall/ocall costs measured on Skylake hardware
+#define TRANSITION_EMULATION_DEFAULT_ENTER_CYCLES       3800
+#define TRANSITION_EMULATION_DEFAULT_EXIT_CYCLES        3300
+#define TRANSITION_EMULATION_DEFAULT_FLUSH_BYTES        ( 32 * 1024 )
+#define TRANSITION_EMULATION_DEFAULT_TLB_PAGES          64
+#define TRANSITION_EMULATION_DEFAULT_AEX_INTERVAL       12000000    //~4ms timer tick at 3GHz
+#define TRANSITION_EMULATION_DEFAULT_AEX_CYCLES         7000
+
+void TransitionEmulation_defaultConfig( TransitionEmulationConfig* config );
+void TransitionEmulation_configure( const TransitionEmulationConfig* config );
+bool TransitionEmulation_isEnabled( void );
+
+//Call right before an SDK transition into the enclave (ecall, or returning from an ocall)
+void TransitionEmulation_enter( void );
+//Call right after an SDK transition out of the enclave (ecall returned, or ocall entered)
+void TransitionEmulation_exit( void );
+
+#endif /* !_TRANSITION_EMULATION_H_ */
@@ -0,0 +1,140 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <math.h>
+
+#include "YcsbWorkload.h"
+#include "SplitMix.h"
+
+static const YcsbWorkload workloads[] = {
+    //      read  update insert scan  rmw
+    { 'A',  0.50, 0.50,  0,     0,    0,    YCSB_KEYS_ZIPFIAN },
+    { 'B',  0.95, 0.05,  0,     0,    0,    YCSB_KEYS_ZIPFIAN },
+    { 'C',  1.00, 0,     0,     0,    0,    YCSB_KEYS_ZIPFIAN },
+    { 'D',  0.95, 0,     0.05,  0,    0,    YCSB_KEYS_LATEST  },
+    { 'E',  0,    0,     0.05,  0.95, 0,    YCSB_KEYS_ZIPFIAN },
+    { 'F',  0.50, 0,     0,     0,    0.50, YCSB_KEYS_ZIPFIAN },
+};
+
+const YcsbWorkload* YcsbWorkload_find( char name )
+{
+    for( size_t i = 0; i < sizeof( workloads ) / sizeof( workloads[ 0 ] ); ++i ) {
+        if( workloads[ i ].name == name )
+            return &workloads[ i ];
+    }
+
+    return NULL;
+}
+
+//Gray et al., "Quickly Generating Billion-Record Synthetic Databases", as used by YCSB
+void ZipfianGenerator_init( ZipfianGenerator* zipfian, uint64_t numItems, double theta )
+{
+    double zetan = 0;
+    for( uint64_t i = 1; i <= numItems; ++i )
+        zetan += 1 / pow( (double)i, theta );
+    double zeta2 = 1 + 1 / pow( 2.0, theta );
+
+    zipfian->numItems = numItems;
+    zipfian->theta    = theta;
+    zipfian->alpha    = 1 / ( 1 - theta );
+    zipfian->zetan    = zetan;
+    zipfian->eta      = ( 1 - pow( 2.0 / numItems, 1 - theta ) ) / ( 1 - zeta2 / zetan );
+}
+
+uint64_t ZipfianGenerator_next( const ZipfianGenerator* zipfian, double uniform )
+{
+    double uz = uniform * zipfian->zetan;
+    if( uz < 1 )
+        return 0;
+    if( uz < 1 + pow( 0.5, zipfian->theta ) )
+        return 1;
+
+    uint64_t rank = (uint64_t)( zipfian->numItems * pow( zipfian->eta * uniform - zipfian->eta + 1, zipfian->alpha ) );
+    return rank < zipfian->numItems ? rank : zipfian->numItems - 1;
+}
+
+static inline uint64_t NextRandom( YcsbGenerator* generator )
+{
+    return SplitMix64_next( &generator->rngState );
+}
+
+static inline double NextUniform( YcsbGenerator* generator )
+{
+    return ( NextRandom( generator ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static inline uint64_t Fnv1aHash( uint64_t value )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for( int i = 0; i < 8; ++i ) {
+        hash ^= value & 0xFF;
+        hash *= 0x100000001b3ULL;
+        value >>= 8;
+    }
+
+    return hash;
+}
+
+void YcsbGenerator_init( YcsbGenerator* generator, const YcsbWorkload* workload, const ZipfianGenerator* zipfian,
+                         uint64_t recordCount, uint64_t* insertCursor, uint32_t maxScanLength, uint64_t seed )
+{
+    generator->workload      = workload;
+    generator->zipfian       = zipfian;
+    generator->recordCount   = recordCount;
+    generator->insertCursor  = insertCursor;
+    generator->maxScanLength = maxScanLength > 0 ? maxScanLength : 1;
+    generator->rngState      = seed;
+}
+
+static uint64_t NextKey( YcsbGenerator* generator )
+{
+    uint64_t rank = ZipfianGenerator_next( generator->zipfian, NextUniform( generator ) );
+    if( generator->workload->keyDistribution == YCSB_KEYS_ZIPFIAN )
+        return Fnv1aHash( rank ) % generator->recordCount;
+
+    //Latest: rank 0 is the newest key. A key still being inserted may not be found yet.
+    uint64_t newest = __atomic_load_n( generator->insertCursor, __ATOMIC_RELAXED ) - 1;
+    return rank <= newest ? newest - rank : 0;
+}
+
+void YcsbGenerator_next( YcsbGenerator* generator, KvRequest* request )
+{
+    const YcsbWorkload* workload = generator->workload;
+    double              choice   = NextUniform( generator );
+
+    request->scanLength = 0;
+    if( choice < workload->readProportion )
+        request->op = KV_OP_READ;
+    else if( ( choice -= workload->readProportion ) < workload->updateProportion )
+        request->op = KV_OP_UPDATE;
+    else if( ( choice -= workload->updateProportion ) < workload->insertProportion )
+        request->op = KV_OP_INSERT;
+    else if( ( choice -= workload->insertProportion ) < workload->scanProportion )
+        request->op = KV_OP_SCAN;
+    else
+        request->op = KV_OP_READ_MODIFY_WRITE;
+
+    if( request->op == KV_OP_INSERT ) {
+        request->key = __atomic_fetch_add( generator->insertCursor, 1, __ATOMIC_RELAXED );
+        return;
+    }
+
+    request->key = NextKey( generator );
+    if( request->op == KV_OP_SCAN )
+        request->scanLength = 1 + NextRandom( generator ) % generator->maxScanLength;
+}
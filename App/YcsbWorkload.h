@@ -0,0 +1,84 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//YCSB-style load generator for the in-enclave key-value store (Enclave/KvStore.h).
+//Workloads A-F follow the YCSB core workloads:
+//  A - 50% read, 50% update             D - 95% read, 5% insert, latest keys
+//  B - 95% read, 5% update              E - 95% scan, 5% insert
+//  C - 100% read                        F - 50% read, 50% read-modify-write
+//Keys are scrambled Zipfian over the loaded records (hot keys are spread over the key
+//space), except D, which favours the most recently inserted keys. Every client thread
+//has its own YcsbGenerator; the Zipfian constants and the insert cursor are shared.
+
+#ifndef _YCSB_WORKLOAD_H_
+#define _YCSB_WORKLOAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../include/common.h"
+
+#define YCSB_ZIPFIAN_CONSTANT   0.99
+#define YCSB_DEFAULT_MAX_SCAN   100
+
+typedef enum {
+    YCSB_KEYS_ZIPFIAN,
+    YCSB_KEYS_LATEST,
+} YcsbKeyDistribution;
+
+typedef struct {
+    char                name;
+    double              readProportion;
+    double              updateProportion;
+    double              insertProportion;
+    double              scanProportion;
+    double              readModifyWriteProportion;
+    YcsbKeyDistribution keyDistribution;
+} YcsbWorkload;
+
+typedef struct {
+    uint64_t    numItems;
+    double      theta;
+    double      alpha;
+    double      zetan;
+    double      eta;
+} ZipfianGenerator;
+
+typedef struct {
+    const YcsbWorkload*     workload;
+    const ZipfianGenerator* zipfian;
+    uint64_t                recordCount;
+    uint64_t*               insertCursor;   //next key to insert, shared by all clients
+    uint32_t                maxScanLength;
+    uint64_t                rngState;
+} YcsbGenerator;
+
+//NULL for an unknown workload name
+const YcsbWorkload* YcsbWorkload_find( char name );
+
+//O(numItems): initialize once and share
+void     ZipfianGenerator_init( ZipfianGenerator* zipfian, uint64_t numItems, double theta );
+//Rank in [0, numItems), 0 the most popular, for uniform in [0, 1)
+uint64_t ZipfianGenerator_next( const ZipfianGenerator* zipfian, double uniform );
+
+void YcsbGenerator_init( YcsbGenerator* generator, const YcsbWorkload* workload, const ZipfianGenerator* zipfian,
+                         uint64_t recordCount, uint64_t* insertCursor, uint32_t maxScanLength, uint64_t seed );
+//Fills op, key and scanLength of the next request
+void YcsbGenerator_next( YcsbGenerator* generator, KvRequest* request );
+
+#endif /* !_YCSB_WORKLOAD_H_ */
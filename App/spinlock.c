@@ -1,100 +0,0 @@
-// ----------------------------------------
-// HotCalls
-// Copyright 2017 The Regents of the University of Michigan
-// Ofir Weisse, Valeria Bertacco and Todd Austin
-
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-
-//     http://www.apache.org/licenses/LICENSE-2.0
-
-// Unless required by applicable law or agreed to in writing, software
-// distributed under the License is distributed on an "AS IS" BASIS,
-// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-// See the License for the specific language governing permissions and
-// limitations under the License.
-// ---------------------------------------------
-
-/*
- * Copyright (C) 2011-2016 Intel Corporation. All rights reserved.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- *
- *   * Redistributions of source code must retain the above copyright
- *     notice, this list of conditions and the following disclaimer.
- *   * Redistributions in binary form must reproduce the above copyright
- *     notice, this list of conditions and the following disclaimer in
- *     the documentation and/or other materials provided with the
- *     distribution.
- *   * Neither the name of Intel Corporation nor the names of its
- *     contributors may be used to endorse or promote products derived
- *     from this software without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
- * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
- * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
- * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
- * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
- * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
- * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
- * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
- * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
- * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
- * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
- *
- */
-
-#include <sgx_spinlock.h>
-
-static inline void _mm_pause(void) __attribute__((always_inline));
-static inline int _InterlockedExchange(int volatile * dst, int val) __attribute__((always_inline));
-
-// inline uint32_t sgx_spin_lock(sgx_spinlock_t *lock) __attribute__((always_inline));
-inline uint32_t sgx_spin_unlock(sgx_spinlock_t *lock) __attribute__((always_inline));
-
-static inline void _mm_pause(void)
-{
-    __asm __volatile(
-        "pause"
-    );
-}
-
-static inline int _InterlockedExchange(int volatile * dst, int val)
-{
-    int res;
-
-    __asm __volatile(
-        "lock xchg %2, %1;"
-        "mov %2, %0"
-        : "=m" (res)
-        : "m" (*dst),
-        "r" (val) 
-        : "memory"
-    );
-
-    return (res);
-   
-}
-
-inline uint32_t sgx_spin_lock(sgx_spinlock_t *lock)
-{
-    while(_InterlockedExchange((volatile int *)lock, 1) != 0) {
-        while (*lock) {
-            /* tell cpu we are spinning */
-            _mm_pause();
-        } 
-    }
-
-    return (0);
-}
-
-inline uint32_t sgx_spin_unlock(sgx_spinlock_t *lock)
-{
-    *lock = 0;
-
-    return (0);
-}
-
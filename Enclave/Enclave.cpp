@@ -56,11 +56,16 @@
 
 #include <stdarg.h>
 #include <stdio.h>      /* vsnprintf */
+#include <string.h>
 
 #include "Enclave.h"
 #include "Enclave_t.h"  /* print_string */
+#include "sgx_trts.h"
 
 #include "../include/common.h"
+#include "TrustedArena.h"
+#include "KvStore.h"
+#include "SealedChannel.h"
 
 
 void MyCustomEcall( void* data )
@@ -81,6 +86,166 @@ void EcallStartResponder( HotCall* hotEcall )
     HotCall_waitForCall( hotEcall, &callTable );
 }
 
+#define HEAP_PREFAULT_PAGE_SIZE 4096
+
+static void PrefaultHeap( uint64_t numBytes )
+{
+	//Touches numBytes of the trusted heap and hands them back to the allocator, so the first
+	//calls do not pay for bringing those pages in (EPC paging, or EAUG with SGX2)
+	volatile uint8_t* buffer = (volatile uint8_t*)malloc( numBytes );
+	if( buffer == NULL ) {
+		printf( "Failed to pre-fault %lu bytes of trusted heap\n", numBytes );
+		return;
+	}
+
+	for( uint64_t offset = 0; offset < numBytes; offset += HEAP_PREFAULT_PAGE_SIZE )
+		buffer[ offset ] = 0;
+	free( (void*)buffer );
+}
+
+void EcallStartWarmResponder( HotCall* hotEcall, uint64_t heapPrefaultBytes, uint64_t* ready )
+{
+	//Fast startup: pre-faults this responder's share of the heap before serving, and tells
+	//the app through ready when it is done
+	if( heapPrefaultBytes > 0 )
+		PrefaultHeap( heapPrefaultBytes );
+	__atomic_store_n( ready, 1, __ATOMIC_RELEASE );
+
+	EcallStartResponder( hotEcall );
+}
+
+void BulkWorkEcall( void* data )
+{
+	BulkCallParams *params = (BulkCallParams*)data;
+	uint64_t checksum      = 0;
+	for( uint64_t i = 0; i < params->size; ++i )
+		checksum += params->buffer[ i ];
+
+	params->checksum = checksum;
+}
+
+void EcallStartLaneResponder( HotLaneChannel* channel )
+{
+	void (*callbacks[2])(void*);
+    callbacks[ LANE_CRITICAL_CALL_ID ] = MyCustomEcall;
+    callbacks[ LANE_BULK_CALL_ID ]     = BulkWorkEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 2;
+    callTable.callbacks  = callbacks;
+
+    HotLaneChannel_waitForCalls( channel, &callTable );
+}
+
+void EcallStartMuxResponder( HotCallMux* mux )
+{
+	//The mux and every channel registered in it must lie outside the enclave
+	if( ! sgx_is_outside_enclave( mux, sizeof( HotCallMux ) ) ) {
+		printf( "Error! Invalid mux\n" );
+		return;
+	}
+
+	void (*callbacks[1])(void*);
+    callbacks[0] = MyCustomEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 1;
+    callTable.callbacks  = callbacks;
+
+    HotCallMux_waitForCalls( mux, &callTable, sgx_is_outside_enclave );
+}
+
+void EcallStartSharedResponder( HotSharedChannel* channel )
+{
+	//Callers in other processes post to this channel, it must not alias enclave memory
+	if( ! sgx_is_outside_enclave( channel, sizeof( HotSharedChannel ) ) ) {
+		printf( "Error! Invalid shared channel\n" );
+		return;
+	}
+
+	void (*callbacks[1])(void*);
+    callbacks[0] = MyCustomEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 1;
+    callTable.callbacks  = callbacks;
+
+    HotSharedChannel_waitForCalls( channel, &callTable );
+}
+
+static void AllocationHeavyWork( AllocationWorkParams* untrustedParams, void* (*allocate)(size_t), void (*release)(void*) )
+{
+	//Keeps a few buffers alive at a time, like a handler building a response out of pieces
+	const uint32_t NUM_LIVE_BUFFERS        = 16;
+	void*          live[ NUM_LIVE_BUFFERS ] = {0};
+	uint32_t       seed                    = 12345;
+	uint64_t       checksum                = 0;
+
+	//The parameters are in untrusted memory: copied once, and a zero maxSize is rejected
+	if( ! sgx_is_outside_enclave( untrustedParams, sizeof( AllocationWorkParams ) ) )
+		return;
+	AllocationWorkParams params;
+	memcpy( &params, untrustedParams, sizeof( AllocationWorkParams ) );
+	if( params.maxSize == 0 ) {
+		untrustedParams->checksum = 0;
+		return;
+	}
+
+	for( uint32_t i = 0; i < params.numAllocations; ++i ) {
+		seed          = seed * 1103515245 + 12345;
+		size_t size   = seed % params.maxSize + 1;
+		uint32_t slot = i % NUM_LIVE_BUFFERS;
+
+		release( live[ slot ] );
+		live[ slot ] = allocate( size );
+		if( live[ slot ] == NULL )
+			continue;
+		memset( live[ slot ], i & 0xFF, size );
+		checksum += ((uint8_t*)live[ slot ])[ size - 1 ];
+	}
+
+	for( uint32_t slot = 0; slot < NUM_LIVE_BUFFERS; ++slot )
+		release( live[ slot ] );
+
+	untrustedParams->checksum = checksum;
+}
+
+void MallocWorkEcall( void* data )
+{
+	AllocationHeavyWork( (AllocationWorkParams*)data, malloc, free );
+}
+
+void ArenaWorkEcall( void* data )
+{
+	AllocationHeavyWork( (AllocationWorkParams*)data, RequestBuffer_alloc, RequestBuffer_free );
+}
+
+void EcallStartArenaResponder( HotCall* hotEcall, uint64_t arenaSize )
+{
+	//Without an arena the responder still serves, RequestBuffer_alloc falls back to malloc
+	TrustedArena arena;
+	if( TrustedArena_init( &arena, arenaSize ) )
+		TrustedArena_setCurrent( &arena );
+	else
+		printf( "Failed to allocate a %lu bytes trusted arena\n", arenaSize );
+
+	void (*callbacks[2])(void*);
+    callbacks[ ALLOC_MALLOC_CALL_ID ] = MallocWorkEcall;
+    callbacks[ ALLOC_ARENA_CALL_ID ]  = ArenaWorkEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 2;
+    callTable.callbacks  = callbacks;
+
+    HotCall_waitForCall( hotEcall, &callTable );
+
+    if( TrustedArena_current() == &arena ) {
+    	printf( "Trusted arena: %lu allocations, %lu malloc fallbacks, %lu bytes carved\n",
+    			arena.numAllocations, arena.numFallbacks, (uint64_t)arena.used );
+    	TrustedArena_destroy( &arena );
+    }
+}
+
 void EcallMeasureHotOcallsPerformance( uint64_t*     performanceCounters, 
                                        uint64_t      numRepeats,
                                        HotCall*      hotOcall )
@@ -125,6 +290,361 @@ void EcallMeasureSDKOcallsPerformance( uint64_t*     performanceCounters,
         }
 	}
 }
+static void ProcessPayloadSlots( uint8_t* payload, uint32_t numSlots, uint32_t slotSize )
+{
+	for( uint32_t slot = 0; slot < numSlots; ++slot )
+		( *(uint64_t*)( payload + (uint64_t)slot * slotSize ) )++;
+}
+
+void PlainPayloadEcall( void* data )
+{
+	//Same checks as SealedChannel_open, on a copy of the untrusted header
+	HotSealedBatch *batch = (HotSealedBatch*)data;
+	HotSealedBatch header;
+	if( ! sgx_is_outside_enclave( batch, sizeof( HotSealedBatch ) ) )
+		return;
+
+	memcpy( &header, batch, sizeof( HotSealedBatch ) );
+	uint64_t payloadSize = (uint64_t)header.numSlots * header.slotSize;
+	if( header.slotSize < sizeof( uint64_t ) || ! sgx_is_outside_enclave( header.payload, payloadSize ) ) {
+		batch->status = HOTCALL_SEALED_ERROR_SIZE;
+		return;
+	}
+
+	ProcessPayloadSlots( header.payload, header.numSlots, header.slotSize );
+	batch->status = HOTCALL_SEALED_OK;
+}
+
+void SealedPayloadEcall( void* data )
+{
+	SealedChannel  *channel = SealedChannel_current();
+	HotSealedBatch *batch   = (HotSealedBatch*)data;
+	HotSealedBatch header;
+
+	if( SealedChannel_open( channel, batch, &header ) != HOTCALL_SEALED_OK )
+		return;
+
+	ProcessPayloadSlots( channel->plaintext, header.numSlots, header.slotSize );
+	SealedChannel_seal( channel, batch, &header );
+}
+
+void EcallStartSealedResponder( HotCall* hotEcall, const uint8_t* key, uint32_t channelID, uint64_t maxPayloadSize )
+{
+	//The key comes in as an ecall argument here; a real deployment derives it from an
+	//attested key exchange with the peer
+	SealedChannel channel;
+	if( ! SealedChannel_init( &channel, key, channelID, maxPayloadSize ) ) {
+		printf( "Failed to allocate %lu bytes sealed channel buffers\n", maxPayloadSize );
+		return;
+	}
+	SealedChannel_setCurrent( &channel );
+
+	void (*callbacks[2])(void*);
+    callbacks[ SEALED_PLAIN_CALL_ID ] = PlainPayloadEcall;
+    callbacks[ SEALED_BATCH_CALL_ID ] = SealedPayloadEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 2;
+    callTable.callbacks  = callbacks;
+
+    HotCall_waitForCall( hotEcall, &callTable );
+
+    if( channel.numRejected > 0 )
+    	printf( "Sealed channel %u: %lu batches opened, %lu rejected\n", channelID, channel.numOpened, channel.numRejected );
+    SealedChannel_destroy( &channel );
+}
+
+void EcallProcessPayloads( uint8_t* payload, size_t size, uint32_t slotSize )
+{
+	//SDK baseline: the payload was copied in by the [in, out] bridge and is copied back out
+	if( slotSize < sizeof( uint64_t ) )
+		return;
+	ProcessPayloadSlots( payload, (uint32_t)( size / slotSize ), slotSize );
+}
+
+static bool AttachStreamEnd( HotStreamEnd* end, HotStream* stream )
+{
+	//The layout is copied in once, then checked to lie outside the enclave
+	if( ! sgx_is_outside_enclave( stream, sizeof( HotStream ) ) || ! HotStreamEnd_attach( end, stream ) ||
+	    ! sgx_is_outside_enclave( end->chunks, (size_t)end->numChunks * end->chunkSize ) ) {
+		printf( "Error! Invalid stream\n" );
+		return false;
+	}
+	return true;
+}
+
+uint64_t EcallConsumeStream( HotStream* stream )
+{
+	//Copies every chunk in before reading it, and returns the checksum of the whole stream
+	HotStreamEnd consumer;
+	if( ! AttachStreamEnd( &consumer, stream ) ) {
+		//Still stop the producer, or it waits for free chunks forever
+		if( sgx_is_outside_enclave( stream, sizeof( HotStream ) ) ) {
+			consumer.stream = stream;
+			HotStream_abort( &consumer );
+		}
+		return 0;
+	}
+
+	uint8_t* buffer = (uint8_t*)malloc( consumer.chunkSize );
+	if( buffer == NULL ) {
+		printf( "Failed to allocate a %u bytes stream buffer\n", consumer.chunkSize );
+		HotStream_abort( &consumer );
+		return 0;
+	}
+
+	const uint8_t* chunk;
+	uint32_t       length;
+	uint64_t       checksum = 0;
+	while( HotStream_next( &consumer, &chunk, &length ) == HOTSTREAM_OK ) {
+		memcpy( buffer, chunk, length );
+		HotStream_release( &consumer );
+		checksum += StreamData_checksum( buffer, length );
+	}
+
+	free( buffer );
+	return checksum;
+}
+
+void EcallProduceStream( HotStream* stream, uint64_t numBytes )
+{
+	//Generates numBytes of stream data in trusted memory, a chunk at a time, and streams it out
+	HotStreamEnd producer;
+	if( ! AttachStreamEnd( &producer, stream ) ) {
+		//Still end the stream, or the consumer waits for chunks forever; only through
+		//untrusted memory
+		if( sgx_is_outside_enclave( stream, sizeof( HotStream ) ) ) {
+			producer.stream = stream;
+			HotStream_close( &producer );
+		}
+		return;
+	}
+
+	uint8_t* buffer = (uint8_t*)malloc( producer.chunkSize );
+	if( buffer == NULL ) {
+		printf( "Failed to allocate a %u bytes stream buffer\n", producer.chunkSize );
+		HotStream_close( &producer );
+		return;
+	}
+
+	for( uint64_t offset = 0; offset < numBytes; offset += producer.chunkSize ) {
+		uint32_t length = (uint32_t)( numBytes - offset < producer.chunkSize ? numBytes - offset : producer.chunkSize );
+		StreamData_fill( buffer, length, offset );
+		uint8_t* chunk = HotStream_acquire( &producer );
+		if( chunk == NULL )
+			break;
+		memcpy( chunk, buffer, length );
+		HotStream_publish( &producer, length );
+	}
+	HotStream_close( &producer );
+
+	free( buffer );
+}
+
+uint64_t EcallConsumeChunk( const uint8_t* chunk, size_t size )
+{
+	//SDK baseline: the chunk was copied in by the [in] bridge
+	return StreamData_checksum( chunk, size );
+}
+
+void EcallProduceChunk( uint8_t* chunk, size_t size, uint64_t offset )
+{
+	//SDK baseline: the chunk is copied out by the [out] bridge
+	StreamData_fill( chunk, size, offset );
+}
+
+static KvStore kvStore;
+
+int EcallKvInit( uint64_t capacity, uint64_t numRecords, uint32_t valueSize, uint32_t numStripes )
+{
+	//Starts from an empty store holding keys 0 .. numRecords-1. No responder may be running.
+	KvStore_destroy( &kvStore );
+	if( numRecords > capacity || ! KvStore_init( &kvStore, capacity, valueSize, numStripes ) ) {
+		printf( "Failed to allocate a key-value store of %lu records of %u bytes\n", capacity, valueSize );
+		return -1;
+	}
+
+	uint8_t*  value = (uint8_t*)malloc( valueSize );
+	KvRequest request;
+	request.op    = KV_OP_INSERT;
+	request.value = value;
+	memset( value, 0, valueSize );
+	for( uint64_t key = 0; key < numRecords; ++key ) {
+		request.key = key;
+		KvValue_fill( value, valueSize, key );
+		KvStore_execute( &kvStore, &request );
+	}
+	free( value );
+
+	return 0;
+}
+
+void EcallKvDestroy( void )
+{
+	KvStore_destroy( &kvStore );
+}
+
+//The request is in untrusted memory: it is copied in once, checked, and only the copy is
+//used; the results are written back at the end
+static void ExecuteUntrustedKvRequest( KvRequest* request )
+{
+	if( ! sgx_is_outside_enclave( request, sizeof( KvRequest ) ) )
+		return;
+
+	KvRequest local;
+	memcpy( &local, request, sizeof( KvRequest ) );
+	if( local.value == NULL || ! sgx_is_outside_enclave( local.value, kvStore.valueSize ) ) {
+		request->numRecords = 0;
+		request->status     = KV_STATUS_INVALID;
+		return;
+	}
+
+	KvStore_execute( &kvStore, &local );
+	request->numRecords = local.numRecords;
+	request->status     = local.status;
+}
+
+void KvExecuteEcall( void* data )
+{
+	ExecuteUntrustedKvRequest( (KvRequest*)data );
+}
+
+void EcallKvExecute( KvRequest* request )
+{
+	ExecuteUntrustedKvRequest( request );
+}
+
+void EcallStartKvResponder( HotCall* hotEcall )
+{
+	void (*callbacks[1])(void*);
+    callbacks[0] = KvExecuteEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 1;
+    callTable.callbacks  = callbacks;
+
+    HotCall_waitForCall( hotEcall, &callTable );
+}
+
+void ReplayStubEcall( void* data )
+{
+	ReplayCall* call = (ReplayCall*)data;
+	uint64_t checksum = 0;
+	for( uint32_t i = 0; i < call->payloadSize; ++i )
+		checksum += call->payload[ i ];
+
+	call->checksum = checksum;
+	call->numCalls++;
+}
+
+void EcallStartReplayResponder( HotCall* hotEcall )
+{
+	void (*callbacks[REPLAY_NUM_STUBS])(void*);
+	for( int i = 0; i < REPLAY_NUM_STUBS; ++i )
+		callbacks[i] = ReplayStubEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = REPLAY_NUM_STUBS;
+    callTable.callbacks  = callbacks;
+
+    HotCall_waitForCall( hotEcall, &callTable );
+}
+
+static void MeasureClockOverheads( HotClockPage* clockPage, uint64_t numRepeats, uint64_t* clockOverheads )
+{
+	//Two back-to-back fresh reads, the cost to subtract from round trips timed with the clock page
+	HotClockSample startTime, endTime;
+	for( uint64_t i=0; i < numRepeats; ++i ) {
+		if( HotClock_read( clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &startTime ) != HOTCLOCK_OK ||
+		    HotClock_read( clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &endTime )   != HOTCLOCK_OK ) {
+			printf( "Error! Clock page read failed\n" );
+			return;
+		}
+		clockOverheads[ i ] = endTime.tsc - startTime.tsc;
+	}
+}
+
+void EcallMeasureOcallRoundTrips( uint64_t*      performanceCounters,
+                                  uint64_t       numRepeats,
+                                  HotCall*       hotOcall,
+                                  OcallParams*   ocallParams,
+                                  HotClockPage*  clockPage,
+                                  uint64_t*      clockOverheads )
+{
+	//Enclave-side round trips, timed with the clock page: from before the ocall is issued
+	//until the enclave continues. Without hotOcall, measures SDK ocalls.
+	//Every read waits for a fresh update, so both timestamps bracket the call; clockOverheads
+	//(optional) gets the cost of two back-to-back reads, to subtract.
+	printf( "Running %s\n", __func__ );
+
+	HotClockSample startTime, endTime;
+	uint64_t       expectedData    = ocallParams->counter;
+	const uint16_t requestedCallID = 0;
+	for( uint64_t i=0; i < numRepeats; ++i ) {
+		int ret = HotClock_read( clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &startTime );
+		if( hotOcall != NULL )
+			HotCall_requestCall( hotOcall, requestedCallID, ocallParams );
+		else
+			MyCustomOcall( ocallParams );
+		if( ret == HOTCLOCK_OK )
+			ret = HotClock_read( clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &endTime );
+
+		if( ret != HOTCLOCK_OK ) {
+			printf( "Error! Clock page read failed with %d\n", ret );
+			return;
+		}
+		performanceCounters[ i ] = endTime.tsc - startTime.tsc;
+
+		expectedData++;
+        if( ocallParams->counter != expectedData ){
+            printf( "Error! ocallParams->counter is different than expected: %lu != %lu\n", ocallParams->counter, expectedData );
+        }
+	}
+
+	if( clockOverheads != NULL )
+		MeasureClockOverheads( clockPage, numRepeats, clockOverheads );
+}
+
+void EcallMeasurePeerRoundTrips( uint64_t*      performanceCounters,
+                                 uint64_t       numRepeats,
+                                 HotCall*       peerChannel,
+                                 PeerMessage*   message,
+                                 HotClockPage*  clockPage,
+                                 uint64_t*      clockOverheads )
+{
+	//Round trips to the peer enclave, timed with the clock page like EcallMeasureOcallRoundTrips.
+	//With peerChannel, a responder inside the peer serves the message directly. Without it,
+	//the app relays it: an SDK ocall from here, then an SDK ecall into the peer.
+	printf( "Running %s\n", __func__ );
+
+	HotClockSample startTime, endTime;
+	for( uint64_t i=0; i < numRepeats; ++i ) {
+		message->request  = i;
+		message->response = 0;
+
+		int ret = HotClock_read( clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &startTime );
+		if( peerChannel != NULL )
+			HotCall_requestCall( peerChannel, PEER_MESSAGE_CALL_ID, message );
+		else
+			OcallRelayToPeer( message );
+		if( ret == HOTCLOCK_OK )
+			ret = HotClock_read( clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &endTime );
+
+		if( ret != HOTCLOCK_OK ) {
+			printf( "Error! Clock page read failed with %d\n", ret );
+			return;
+		}
+		performanceCounters[ i ] = endTime.tsc - startTime.tsc;
+
+		if( message->response != PeerMessage_respond( i ) ) {
+			printf( "Error! Peer response is different than expected: %lu != %lu\n", message->response, PeerMessage_respond( i ) );
+		}
+	}
+
+	if( clockOverheads != NULL )
+		MeasureClockOverheads( clockPage, numRepeats, clockOverheads );
+}
+
 /* 
  * printf: 
  *   Invokes OCALL to display the enclave buffer to the terminal.
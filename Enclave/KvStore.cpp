@@ -0,0 +1,187 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "KvStore.h"
+
+#define KV_STORE_PAGE_SIZE  4096
+
+static uint64_t RoundUpToPowerOf2( uint64_t value )
+{
+    uint64_t power = 1;
+    while( power < value )
+        power <<= 1;
+
+    return power;
+}
+
+static inline uint64_t HashKey( uint64_t key )
+{
+    //splitmix64 finalizer: consecutive keys land in unrelated buckets
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+
+    return key;
+}
+
+static void TouchPages( void* memory, size_t size )
+{
+    for( size_t offset = 0; offset < size; offset += KV_STORE_PAGE_SIZE )
+        ((volatile uint8_t*)memory)[ offset ] = 0;
+}
+
+bool KvStore_init( KvStore* store, uint64_t capacity, uint32_t valueSize, uint32_t numStripes )
+{
+    memset( store, 0, sizeof( KvStore ) );
+    if( valueSize < KV_VALUE_COUNTER_SIZE || capacity == 0 )
+        return false;
+
+    //The bucket count, the stripe count and the array sizes below must not wrap
+    const uint64_t roundedStripes = RoundUpToPowerOf2( numStripes > 0 ? numStripes : 1 );
+    if( capacity > ( 1ULL << 63 ) || roundedStripes > UINT32_MAX ||
+        capacity > UINT64_MAX / valueSize || capacity > UINT64_MAX / sizeof( KvRecord ) )
+        return false;
+
+    store->numBuckets = RoundUpToPowerOf2( capacity );
+    store->numStripes = (uint32_t)roundedStripes;
+    store->capacity   = capacity;
+    store->valueSize  = valueSize;
+
+    store->buckets = (KvRecord**)calloc( store->numBuckets, sizeof( KvRecord* ) );
+    store->stripesMemory = (uint8_t*)malloc( ( store->numStripes + 1 ) * sizeof( KvStripe ) );
+    store->records = (KvRecord*) malloc( capacity * sizeof( KvRecord ) );
+    store->values  = (uint8_t*)  malloc( capacity * valueSize );
+    if( store->buckets == NULL || store->stripesMemory == NULL || store->records == NULL || store->values == NULL ) {
+        KvStore_destroy( store );
+        return false;
+    }
+
+    //One cache line per stripe, so locking a stripe never bounces its neighbours
+    uintptr_t stripesAddress = ( (uintptr_t)store->stripesMemory + sizeof( KvStripe ) - 1 ) & ~( (uintptr_t)sizeof( KvStripe ) - 1 );
+    store->stripes           = (KvStripe*)stripesAddress;
+
+    for( uint32_t i = 0; i < store->numStripes; ++i )
+        HotSpin_init( &store->stripes[ i ].lock );
+
+    //Commit every page now rather than on the first insert that lands on it
+    TouchPages( store->records, capacity * sizeof( KvRecord ) );
+    TouchPages( store->values,  capacity * valueSize );
+
+    return true;
+}
+
+void KvStore_destroy( KvStore* store )
+{
+    free( store->buckets );
+    free( store->stripesMemory );
+    free( store->records );
+    free( store->values );
+    memset( store, 0, sizeof( KvStore ) );
+}
+
+static inline uint8_t* ValueOf( KvStore* store, KvRecord* record )
+{
+    return store->values + ( record - store->records ) * store->valueSize;
+}
+
+//Caller holds the stripe of bucket
+static KvRecord* Find( KvRecord* bucket, uint64_t key )
+{
+    for( KvRecord* record = bucket; record != NULL; record = record->next ) {
+        if( record->key == key )
+            return record;
+    }
+
+    return NULL;
+}
+
+static void ExecuteOnKey( KvStore* store, KvRequest* request, uint64_t key )
+{
+    uint64_t    bucketIdx = HashKey( key ) & ( store->numBuckets - 1 );
+    HotSpinlock *lock     = &store->stripes[ bucketIdx & ( store->numStripes - 1 ) ].lock;
+    HotSpinNode lockNode;
+
+    HotSpin_lock( lock, &lockNode );
+
+    KvRecord* record = Find( store->buckets[ bucketIdx ], key );
+    if( record == NULL && request->op == KV_OP_INSERT ) {
+        uint64_t recordIdx = __atomic_fetch_add( &store->numRecords, 1, __ATOMIC_RELAXED );
+        if( recordIdx >= store->capacity ) {
+            HotSpin_unlock( lock, &lockNode );
+            request->status = KV_STATUS_FULL;
+            return;
+        }
+
+        record       = &store->records[ recordIdx ];
+        record->key  = key;
+        record->next = store->buckets[ bucketIdx ];
+        store->buckets[ bucketIdx ] = record;
+    }
+
+    if( record == NULL ) {
+        HotSpin_unlock( lock, &lockNode );
+        if( request->op != KV_OP_SCAN )
+            request->status = KV_STATUS_NOT_FOUND;
+        return;
+    }
+
+    uint8_t* value = ValueOf( store, record );
+    switch( request->op ) {
+        case KV_OP_UPDATE:
+        case KV_OP_INSERT:
+            memcpy( value, request->value, store->valueSize );
+            break;
+        case KV_OP_READ_MODIFY_WRITE:
+            ( *(uint64_t*)value )++;
+            memcpy( request->value, value, store->valueSize );
+            break;
+        default:
+            memcpy( request->value, value, store->valueSize );
+            break;
+    }
+
+    HotSpin_unlock( lock, &lockNode );
+    request->numRecords++;
+}
+
+void KvStore_execute( KvStore* store, KvRequest* request )
+{
+    request->numRecords = 0;
+    request->status     = KV_STATUS_OK;
+    if( store->buckets == NULL ) {
+        request->status = KV_STATUS_NOT_READY;
+        return;
+    }
+
+    if( request->op != KV_OP_SCAN ) {
+        ExecuteOnKey( store, request, request->key );
+        return;
+    }
+
+    //The value buffer ends up with the last record found
+    for( uint32_t i = 0; i < request->scanLength; ++i )
+        ExecuteOnKey( store, request, request->key + i );
+
+    if( request->numRecords == 0 )
+        request->status = KV_STATUS_NOT_FOUND;
+}
@@ -0,0 +1,65 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Reference in-enclave key-value store: a chained hash table with fixed size values.
+//Buckets are guarded by striped HotSpin locks (bucket i by stripe i % numStripes), so
+//responders serving different keys rarely contend. Records and values come from arrays
+//taken from the enclave heap and touched at init, so inserts never allocate.
+//Keys are not ordered; a scan looks up scanLength consecutive keys one by one.
+
+#ifndef _KV_STORE_H_
+#define _KV_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/hot_spinlock.h"
+#include "../include/common.h"
+
+#define KV_STORE_DEFAULT_STRIPES    64
+
+typedef struct KvRecord {
+    uint64_t            key;
+    struct KvRecord*    next;
+} KvRecord;
+
+typedef struct {
+    HotSpinlock         lock;
+} __attribute__((aligned(64))) KvStripe;
+
+typedef struct {
+    KvRecord**          buckets;
+    uint64_t            numBuckets;     //power of 2
+    KvStripe*           stripes;
+    uint8_t*            stripesMemory;
+    uint32_t            numStripes;     //power of 2
+    KvRecord*           records;
+    uint8_t*            values;         //valueSize bytes per record
+    uint64_t            capacity;
+    uint64_t            numRecords;
+    uint32_t            valueSize;
+} KvStore;
+
+//valueSize must be at least KV_VALUE_COUNTER_SIZE. numStripes is rounded up to a power of 2.
+bool KvStore_init( KvStore* store, uint64_t capacity, uint32_t valueSize, uint32_t numStripes );
+void KvStore_destroy( KvStore* store );
+//Runs one KvRequest and sets its status. Safe to call from several threads at once.
+//The request is trusted: copy and check requests from untrusted memory first.
+void KvStore_execute( KvStore* store, KvRequest* request );
+
+#endif /* !_KV_STORE_H_ */
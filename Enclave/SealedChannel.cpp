@@ -0,0 +1,126 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sgx_trts.h"
+#include "sgx_tcrypto.h"
+#include "SealedChannel.h"
+
+static __thread SealedChannel* currentChannel = NULL;
+
+bool SealedChannel_init( SealedChannel* channel, const uint8_t key[ HOTCALL_SEALED_KEY_SIZE ],
+                         uint32_t channelID, size_t maxPayloadSize )
+{
+    memset( channel, 0, sizeof( SealedChannel ) );
+    memcpy( channel->session.key, key, HOTCALL_SEALED_KEY_SIZE );
+    channel->session.channelID = channelID;
+    channel->session.sequence  = 0;
+
+    channel->ciphertext = (uint8_t*)malloc( maxPayloadSize );
+    channel->plaintext  = (uint8_t*)malloc( maxPayloadSize );
+    channel->bufferSize = maxPayloadSize;
+    if( channel->ciphertext == NULL || channel->plaintext == NULL ) {
+        SealedChannel_destroy( channel );
+        return false;
+    }
+
+    return true;
+}
+
+void SealedChannel_destroy( SealedChannel* channel )
+{
+    if( currentChannel == channel )
+        currentChannel = NULL;
+
+    free( channel->ciphertext );
+    free( channel->plaintext );
+    memset( channel, 0, sizeof( SealedChannel ) );
+}
+
+static int Reject( SealedChannel* channel, HotSealedBatch* untrustedBatch, int status )
+{
+    channel->numRejected++;
+    untrustedBatch->status = status;
+    return status;
+}
+
+int SealedChannel_open( SealedChannel* channel, HotSealedBatch* untrustedBatch, HotSealedBatch* header )
+{
+    uint8_t iv[ HOTCALL_SEALED_IV_SIZE ];
+    uint8_t aad[ HOTCALL_SEALED_AAD_SIZE ];
+
+    if( ! sgx_is_outside_enclave( untrustedBatch, sizeof( HotSealedBatch ) ) ) {
+        channel->numRejected++;
+        return HOTCALL_SEALED_ERROR_SIZE;
+    }
+
+    memcpy( header, untrustedBatch, sizeof( HotSealedBatch ) );
+    //Every slot holds at least the 64-bit counter the handler increments
+    uint64_t payloadSize = (uint64_t)header->numSlots * header->slotSize;
+    if( header->slotSize < sizeof( uint64_t ) || payloadSize > channel->bufferSize ||
+        ! sgx_is_outside_enclave( header->payload, payloadSize ) )
+        return Reject( channel, untrustedBatch, HOTCALL_SEALED_ERROR_SIZE );
+    if( header->sequence <= channel->session.sequence )
+        return Reject( channel, untrustedBatch, HOTCALL_SEALED_ERROR_REPLAY );
+
+    memcpy( channel->ciphertext, header->payload, payloadSize );
+    HotSealed_makeIv( iv, channel->session.channelID, HOTCALL_SEALED_REQUEST, header->sequence );
+    HotSealed_makeAad( aad, header );
+
+    sgx_status_t ret = sgx_rijndael128GCM_decrypt( (const sgx_aes_gcm_128bit_key_t*)channel->session.key,
+                                                   channel->ciphertext, (uint32_t)payloadSize, channel->plaintext,
+                                                   iv, HOTCALL_SEALED_IV_SIZE, aad, HOTCALL_SEALED_AAD_SIZE,
+                                                   (const sgx_aes_gcm_128bit_tag_t*)header->mac );
+    if( ret != SGX_SUCCESS )
+        return Reject( channel, untrustedBatch, HOTCALL_SEALED_ERROR_MAC );
+
+    channel->session.sequence = header->sequence;
+    channel->numOpened++;
+    return HOTCALL_SEALED_OK;
+}
+
+void SealedChannel_seal( SealedChannel* channel, HotSealedBatch* untrustedBatch, const HotSealedBatch* header )
+{
+    uint8_t iv[ HOTCALL_SEALED_IV_SIZE ];
+    uint8_t aad[ HOTCALL_SEALED_AAD_SIZE ];
+    uint8_t mac[ HOTCALL_SEALED_MAC_SIZE ];
+
+    uint64_t payloadSize = (uint64_t)header->numSlots * header->slotSize;
+    HotSealed_makeIv( iv, channel->session.channelID, HOTCALL_SEALED_RESPONSE, header->sequence );
+    HotSealed_makeAad( aad, header );
+
+    sgx_rijndael128GCM_encrypt( (const sgx_aes_gcm_128bit_key_t*)channel->session.key,
+                                channel->plaintext, (uint32_t)payloadSize, header->payload,
+                                iv, HOTCALL_SEALED_IV_SIZE, aad, HOTCALL_SEALED_AAD_SIZE,
+                                (sgx_aes_gcm_128bit_tag_t*)mac );
+
+    memcpy( untrustedBatch->mac, mac, HOTCALL_SEALED_MAC_SIZE );
+    untrustedBatch->status = HOTCALL_SEALED_OK;
+}
+
+SealedChannel* SealedChannel_current( void )
+{
+    return currentChannel;
+}
+
+void SealedChannel_setCurrent( SealedChannel* channel )
+{
+    currentChannel = channel;
+}
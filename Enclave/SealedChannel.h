@@ -0,0 +1,55 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Responder side of a sealed channel (include/hot_calls_sealed.h), on sgx_tcrypto.
+//A request batch is copied into trusted memory before it is authenticated, so the untrusted
+//side cannot change it between the MAC check and the decryption, and is opened with one
+//GCM call for the whole batch. The session lives in enclave memory only.
+
+#ifndef _SEALED_CHANNEL_H_
+#define _SEALED_CHANNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/hot_calls_sealed.h"
+
+typedef struct {
+    HotSealedSession    session;
+    uint8_t*            ciphertext;     //trusted copy of the request
+    uint8_t*            plaintext;
+    size_t              bufferSize;
+    uint64_t            numOpened;
+    uint64_t            numRejected;
+} SealedChannel;
+
+bool SealedChannel_init( SealedChannel* channel, const uint8_t key[ HOTCALL_SEALED_KEY_SIZE ],
+                         uint32_t channelID, size_t maxPayloadSize );
+void SealedChannel_destroy( SealedChannel* channel );
+
+//Authenticates and decrypts untrustedBatch into channel->plaintext. header gets a trusted copy
+//of the batch header. Returns a HOTCALL_SEALED_ status, also written to untrustedBatch->status.
+int  SealedChannel_open( SealedChannel* channel, HotSealedBatch* untrustedBatch, HotSealedBatch* header );
+//Seals channel->plaintext back into untrustedBatch as the response to header
+void SealedChannel_seal( SealedChannel* channel, HotSealedBatch* untrustedBatch, const HotSealedBatch* header );
+
+//The channel of the sealed responder running on the current thread
+SealedChannel* SealedChannel_current( void );
+void           SealedChannel_setCurrent( SealedChannel* channel );
+
+#endif /* !_SEALED_CHANNEL_H_ */
@@ -0,0 +1,161 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TrustedArena.h"
+
+#define TRUSTED_ARENA_PAGE_SIZE         4096
+#define TRUSTED_ARENA_FALLBACK_CLASS    0xFF
+
+//Sits in front of every block, keeps the payload 16 byte aligned
+typedef struct {
+    uint32_t sizeClass;
+    uint32_t reserved[ 3 ];
+} TrustedArenaHeader;
+
+static __thread TrustedArena* currentArena = NULL;
+
+static int SizeClassOf( size_t size )
+{
+    size_t blockSize = (size_t)1 << TRUSTED_ARENA_MIN_BLOCK_SHIFT;
+    for( int sizeClass = 0; sizeClass < TRUSTED_ARENA_NUM_CLASSES; ++sizeClass ) {
+        if( size <= blockSize )
+            return sizeClass;
+        blockSize <<= 1;
+    }
+
+    return -1;
+}
+
+static size_t BlockSizeOf( int sizeClass )
+{
+    return (size_t)1 << ( sizeClass + TRUSTED_ARENA_MIN_BLOCK_SHIFT );
+}
+
+static void* FallbackAlloc( TrustedArena* arena, size_t size )
+{
+    TrustedArenaHeader* header = (TrustedArenaHeader*)malloc( sizeof( TrustedArenaHeader ) + size );
+    if( header == NULL )
+        return NULL;
+
+    header->sizeClass = TRUSTED_ARENA_FALLBACK_CLASS;
+    if( arena != NULL )
+        arena->numFallbacks++;
+
+    return header + 1;
+}
+
+bool TrustedArena_init( TrustedArena* arena, size_t size )
+{
+    memset( arena, 0, sizeof( TrustedArena ) );
+
+    arena->memory = (uint8_t*)malloc( size );
+    if( arena->memory == NULL )
+        return false;
+
+    //Commit every page now rather than on the first request that lands on it
+    for( size_t offset = 0; offset < size; offset += TRUSTED_ARENA_PAGE_SIZE )
+        ((volatile uint8_t*)arena->memory)[ offset ] = 0;
+
+    arena->size = size;
+    return true;
+}
+
+void TrustedArena_destroy( TrustedArena* arena )
+{
+    if( currentArena == arena )
+        currentArena = NULL;
+
+    free( arena->memory );
+    memset( arena, 0, sizeof( TrustedArena ) );
+}
+
+void* TrustedArena_alloc( TrustedArena* arena, size_t size )
+{
+    int sizeClass = SizeClassOf( size );
+    if( sizeClass < 0 )
+        return FallbackAlloc( arena, size );
+
+    void* block = arena->freeLists[ sizeClass ];
+    if( block != NULL ) {
+        arena->freeLists[ sizeClass ] = *(void**)block;
+        arena->numAllocations++;
+        return block;
+    }
+
+    //Free list is empty: carve a new block from the untouched part of the arena
+    size_t blockSize = sizeof( TrustedArenaHeader ) + BlockSizeOf( sizeClass );
+    if( arena->used + blockSize > arena->size )
+        return FallbackAlloc( arena, size );
+
+    TrustedArenaHeader* header = (TrustedArenaHeader*)( arena->memory + arena->used );
+    header->sizeClass = sizeClass;
+    arena->used      += blockSize;
+    arena->numAllocations++;
+
+    return header + 1;
+}
+
+void TrustedArena_free( TrustedArena* arena, void* buffer )
+{
+    if( buffer == NULL )
+        return;
+
+    TrustedArenaHeader* header = (TrustedArenaHeader*)buffer - 1;
+    if( header->sizeClass == TRUSTED_ARENA_FALLBACK_CLASS ) {
+        free( header );
+        return;
+    }
+
+    *(void**)buffer                        = arena->freeLists[ header->sizeClass ];
+    arena->freeLists[ header->sizeClass ]  = buffer;
+}
+
+TrustedArena* TrustedArena_current( void )
+{
+    return currentArena;
+}
+
+void TrustedArena_setCurrent( TrustedArena* arena )
+{
+    currentArena = arena;
+}
+
+void* RequestBuffer_alloc( size_t size )
+{
+    if( currentArena != NULL )
+        return TrustedArena_alloc( currentArena, size );
+
+    return FallbackAlloc( NULL, size );
+}
+
+void RequestBuffer_free( void* buffer )
+{
+    if( buffer == NULL )
+        return;
+
+    if( currentArena != NULL ) {
+        TrustedArena_free( currentArena, buffer );
+        return;
+    }
+
+    TrustedArenaHeader* header = (TrustedArenaHeader*)buffer - 1;
+    free( header );
+}
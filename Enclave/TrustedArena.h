@@ -0,0 +1,59 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Slab allocator for per-request buffers inside the enclave.
+//Each responder owns one arena: a single region taken from the enclave heap when the
+//responder starts and touched page by page right away, so the EPC commit/fault cost is
+//paid once at startup instead of on the first requests. Blocks are served from per size
+//class free lists that only the owning responder thread touches, so the hot path takes
+//no lock. Requests larger than the biggest class fall back to malloc.
+
+#ifndef _TRUSTED_ARENA_H_
+#define _TRUSTED_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRUSTED_ARENA_NUM_CLASSES       8       //64 bytes .. 8KB
+#define TRUSTED_ARENA_MIN_BLOCK_SHIFT   6
+#define TRUSTED_ARENA_DEFAULT_SIZE      ( 16 * 1024 * 1024 )
+
+typedef struct {
+    uint8_t*    memory;
+    size_t      size;
+    size_t      used;
+    void*       freeLists[ TRUSTED_ARENA_NUM_CLASSES ];
+    uint64_t    numAllocations; //served by the arena
+    uint64_t    numFallbacks;   //served by malloc: too large, or the arena ran out
+} TrustedArena;
+
+bool  TrustedArena_init( TrustedArena* arena, size_t size );
+void  TrustedArena_destroy( TrustedArena* arena );
+void* TrustedArena_alloc( TrustedArena* arena, size_t size );
+void  TrustedArena_free( TrustedArena* arena, void* buffer );
+
+//The arena of the responder running on the current thread, NULL outside arena responders
+TrustedArena* TrustedArena_current( void );
+void          TrustedArena_setCurrent( TrustedArena* arena );
+
+//Per-request buffers for handlers: from the current responder's arena when there is one.
+//A buffer must be released on the thread that allocated it.
+void* RequestBuffer_alloc( size_t size );
+void  RequestBuffer_free( void* buffer );
+
+#endif /* !_TRUSTED_ARENA_H_ */
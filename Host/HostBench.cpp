@@ -0,0 +1,1120 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//hotcalls_host_bench: a HotCall between two native threads against the usual
+//alternatives (mutex+condvar, eventfd, pipe), plus a multi-caller stress run that
+//checks every call was served exactly once, the clock page reads, the streaming ring,
+//request traces and hot calls from other processes. No enclave or SGX SDK involved.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "HotCallsHost.h"
+#include "../App/ClockPublisher.h"
+#include "../App/PerfCounters.h"
+#include "../App/SharedChannels.h"
+#include "../App/CrossProcess.h"
+#include "../App/HotCallTrace.h"
+#include "../include/hot_calls_lanes.h"
+#include "../include/hot_calls_mux.h"
+#include "../include/hot_stream.h"
+#include "../include/common.h"
+
+using namespace std;
+
+inline __attribute__((always_inline))  uint64_t rdtscp(void)
+{
+        unsigned int low, high;
+
+        //RDTSCP also writes IA32_TSC_AUX into ecx
+        asm volatile("rdtscp" : "=a" (low), "=d" (high) : : "rcx");
+
+        return low | ((uint64_t)high) << 32;
+}
+
+static void IncrementCall( void* data )
+{
+    *(uint64_t*)data += 1;
+}
+
+// ---------- mutex + condvar ----------
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  requestReady;
+    pthread_cond_t  responseReady;
+    bool            hasRequest;
+    bool            hasResponse;
+    bool            keepRunning;
+    uint64_t*       data;
+} CondVarChannel;
+
+static void* CondVarResponderThread( void* channelAsVoidP )
+{
+    CondVarChannel *channel = (CondVarChannel*)channelAsVoidP;
+
+    pthread_mutex_lock( &channel->mutex );
+    while( true ) {
+        while( ! channel->hasRequest && channel->keepRunning )
+            pthread_cond_wait( &channel->requestReady, &channel->mutex );
+        if( ! channel->keepRunning )
+            break;
+
+        channel->hasRequest  = false;
+        IncrementCall( channel->data );
+        channel->hasResponse = true;
+        pthread_cond_signal( &channel->responseReady );
+    }
+    pthread_mutex_unlock( &channel->mutex );
+
+    return NULL;
+}
+
+static void CondVarCall( CondVarChannel* channel, uint64_t* data )
+{
+    pthread_mutex_lock( &channel->mutex );
+    channel->data       = data;
+    channel->hasRequest = true;
+    pthread_cond_signal( &channel->requestReady );
+    while( ! channel->hasResponse )
+        pthread_cond_wait( &channel->responseReady, &channel->mutex );
+    channel->hasResponse = false;
+    pthread_mutex_unlock( &channel->mutex );
+}
+
+// ---------- eventfd / pipe ----------
+
+#define FD_MESSAGE_CALL     1
+#define FD_MESSAGE_STOP     2
+
+typedef struct {
+    int         requestRead;
+    int         requestWrite;
+    int         responseRead;
+    int         responseWrite;
+    uint64_t*   data;
+} FdChannel;
+
+static void FdSend( int fd, uint64_t message )
+{
+    while( write( fd, &message, sizeof( message ) ) != sizeof( message ) )
+        ;
+}
+
+static uint64_t FdReceive( int fd )
+{
+    uint64_t message = 0;
+    while( read( fd, &message, sizeof( message ) ) != sizeof( message ) )
+        ;
+    return message;
+}
+
+static void* FdResponderThread( void* channelAsVoidP )
+{
+    FdChannel *channel = (FdChannel*)channelAsVoidP;
+    while( FdReceive( channel->requestRead ) == FD_MESSAGE_CALL ) {
+        IncrementCall( channel->data );
+        FdSend( channel->responseWrite, FD_MESSAGE_CALL );
+    }
+
+    return NULL;
+}
+
+// ---------- stress ----------
+
+#define MUX_REREGISTER_INTERVAL 64
+
+typedef struct {
+    HotCall*        hotCall;
+    HotLaneChannel* laneChannel;
+    HotCallMux*     mux;
+    uint16_t        lane;
+    uint64_t        numCalls;
+    uint64_t        counter;
+    uint64_t        numRejected;
+} StressCallerArgs;
+
+static void* StressCallerThread( void* argsAsVoidP )
+{
+    StressCallerArgs *args = (StressCallerArgs*)argsAsVoidP;
+    int               slot = -1;
+    for( uint64_t i = 0; i < args->numCalls; ++i ) {
+        if( args->laneChannel != NULL ) {
+            while( HotLaneChannel_requestCall( args->laneChannel, args->lane, 0, &args->counter ) < 0 )
+                args->numRejected++;
+        }
+        else if( args->mux != NULL ) {
+            //hotCall is this caller's own channel; it leaves and rejoins the mux every few calls
+            if( i % MUX_REREGISTER_INTERVAL == 0 ) {
+                if( slot >= 0 )
+                    HotCallMux_removeChannel( args->mux, slot );
+                slot = HotCallMux_addChannel( args->mux, args->hotCall );
+            }
+            while( HotCallMux_requestCall( args->mux, slot, 0, &args->counter ) < 0 )
+                args->numRejected++;
+        }
+        else {
+            while( HotCall_requestCall( args->hotCall, 0, &args->counter ) < 0 )
+                args->numRejected++;
+        }
+    }
+
+    if( slot >= 0 )
+        HotCallMux_removeChannel( args->mux, slot );
+
+    return NULL;
+}
+
+typedef struct {
+    HotLaneChannel* channel;
+    HotCallTable*   callTable;
+} LaneResponderArgs;
+
+static void* LaneResponderThread( void* argsAsVoidP )
+{
+    LaneResponderArgs *args = (LaneResponderArgs*)argsAsVoidP;
+    HotLaneChannel_waitForCalls( args->channel, args->callTable );
+
+    return NULL;
+}
+
+typedef struct {
+    HotCallMux*     mux;
+    HotCallTable*   callTable;
+} MuxResponderArgs;
+
+static void* MuxResponderThread( void* argsAsVoidP )
+{
+    MuxResponderArgs *args = (MuxResponderArgs*)argsAsVoidP;
+    HotCallMux_waitForCalls( args->mux, args->callTable, NULL );
+
+    return NULL;
+}
+
+// ---------- stream ----------
+
+typedef struct {
+    HotStream*  stream;
+    uint64_t    numBytes;
+    uint64_t    numProduced;        //Bytes published before the stream ended or was aborted
+} StreamProducerArgs;
+
+static void* StreamProducerThread( void* argsAsVoidP )
+{
+    //Chunks of random lengths, so partly filled chunks are streamed too
+    StreamProducerArgs *args = (StreamProducerArgs*)argsAsVoidP;
+    HotStreamEnd        producer;
+    uint32_t            seed   = 12345;
+    uint64_t            offset = 0;
+
+    HotStreamEnd_attach( &producer, args->stream );
+    while( offset < args->numBytes ) {
+        seed            = seed * 1103515245 + 12345;
+        uint64_t length = ( ( seed >> 8 ) % ( producer.chunkSize / 8 ) + 1 ) * 8;
+        length          = min( length, args->numBytes - offset );
+
+        uint8_t* chunk = HotStream_acquire( &producer );
+        if( chunk == NULL )
+            break;
+        StreamData_fill( chunk, length, offset );
+        HotStream_publish( &producer, (uint32_t)length );
+        offset += length;
+    }
+    HotStream_close( &producer );
+    args->numProduced = offset;
+
+    return NULL;
+}
+
+// ---------- request trace ----------
+
+typedef struct {
+    uint16_t    callID;
+    uint64_t    numCalls;
+} TraceCallerArgs;
+
+static void* TraceCallerThread( void* argsAsVoidP )
+{
+    //Records numCalls requests of its own callID, numbered in payloadSize
+    TraceCallerArgs *args = (TraceCallerArgs*)argsAsVoidP;
+    for( uint64_t i = 0; i < args->numCalls; ++i )
+        HotCallTrace_record( args->callID, (uint32_t)i );
+
+    return NULL;
+}
+
+// ---------- cross-process ----------
+
+static void IncrementIntCall( void* data )
+{
+    *(int*)data += 1;
+}
+
+typedef struct {
+    HotSharedChannel*   channel;
+    HotCallTable*       callTable;
+} SharedResponderArgs;
+
+static void* SharedResponderThread( void* argsAsVoidP )
+{
+    SharedResponderArgs *args = (SharedResponderArgs*)argsAsVoidP;
+    HotSharedChannel_waitForCalls( args->channel, args->callTable );
+
+    return NULL;
+}
+
+class HostBenchmark {
+public:
+    HostBenchmark( const map<string, string>& options ) : m_options( options ), m_numFailures( 0 ) {
+        const int numCpus = sysconf( _SC_NPROCESSORS_ONLN );
+
+        m_iterations   = GetOption( "iterations", 100000 );
+        m_callerCpu    = GetOption( "caller-cpu", 0 );
+        m_responderCpu = GetOption( "responder-cpu", numCpus > 1 ? 1 : -1 );
+
+        m_callbacks[ 0 ]       = IncrementCall;
+        m_callTable.numEntries = 1;
+        m_callTable.callbacks  = m_callbacks;
+
+        m_sharedCallbacks[ 0 ]       = IncrementIntCall;
+        m_sharedCallTable.numEntries = 1;
+        m_sharedCallTable.callbacks  = m_sharedCallbacks;
+    }
+
+    int Run( const vector<string>& testNames ) {
+        PinCurrentThreadToCpu( m_callerCpu );
+        printf( "Caller on cpu %d, responder on cpu %d, %lu iterations, %s lock\n",
+                m_callerCpu, m_responderCpu, m_iterations, HOTSPIN_LOCK_NAME );
+
+        vector<string> tests = testNames;
+        if( tests.empty() ) {
+            tests.push_back( "hotcall" );
+            tests.push_back( "batch" );
+            tests.push_back( "condvar" );
+            tests.push_back( "eventfd" );
+            tests.push_back( "pipe" );
+            tests.push_back( "stress" );
+            tests.push_back( "clock" );
+            tests.push_back( "stream" );
+            tests.push_back( "trace" );
+            tests.push_back( "cross-process" );
+        }
+
+        for( size_t i = 0; i < tests.size(); ++i ) {
+            if( ! RunCountedTest( tests[ i ] ) ) {
+                printf( "Unknown test %s\n", tests[ i ].c_str() );
+                PrintUsage();
+                return 2;
+            }
+        }
+
+        if( m_numFailures > 0 )
+            printf( "%d FAILURES\n", m_numFailures );
+
+        return m_numFailures > 0 ? 1 : 0;
+    }
+
+    static void PrintUsage() {
+        printf( "Usage: hotcalls_host_bench [--option=value ...] [test ...]\n" );
+        printf( "Tests: hotcall batch condvar eventfd pipe stress clock stream trace cross-process (default: all)\n" );
+        printf( "Options: --iterations --caller-cpu --responder-cpu --stress-callers --batch-size --stream-bytes\n" );
+        printf( "         --cross-process-clients\n" );
+        printf( "         --perf [--perf-hitm-event=<raw event>] counts events of every test\n" );
+    }
+
+private:
+    map<string, string> m_options;
+    uint64_t            m_iterations;
+    int                 m_callerCpu;
+    int                 m_responderCpu;
+    int                 m_numFailures;
+    void                (*m_callbacks[1])(void*);
+    HotCallTable        m_callTable;
+    void                (*m_sharedCallbacks[1])(void*);
+    HotCallTable        m_sharedCallTable;
+
+    //With --perf, prints the events of the caller thread alone and of the threads the test started
+    bool RunCountedTest( const string& testName )
+    {
+        if( GetOption( "perf", 0 ) == 0 )
+            return RunTest( testName );
+
+        PerfTestCounters counters;
+        PerfTestCounters_start( &counters, GetOption( "perf-hitm-event", 0 ) );
+        bool known         = RunTest( testName );
+        bool threadsExited = PerfTestCounters_stop( &counters );
+
+        if( known ) {
+            if( ! threadsExited )
+                printf( "Warning: threads of %s still running, their events are not counted\n", testName.c_str() );
+            printf( "%-16s %-16s %14s %14s\n", testName.c_str(), "event", "caller", "responders" );
+            for( int counter = 0; counter < PERF_COUNTERS_NUM; ++counter ) {
+                const PerfCounter* caller  = &counters.caller.counters[ counter ];
+                const PerfCounter* process = &counters.process.counters[ counter ];
+                if( caller->event == NULL || process->event == NULL ) {
+                    printf( "%-16s %-16s %14s %14s\n", "", caller->name, "n/a", "n/a" );
+                    continue;
+                }
+                printf( "%-16s %-16s %14lu %14lu (%s)\n", "", caller->name, caller->value,
+                        process->value > caller->value ? process->value - caller->value : 0, caller->event );
+            }
+        }
+
+        PerfTestCounters_close( &counters );
+        return known;
+    }
+
+    bool RunTest( const string& testName )
+    {
+        if( testName == "hotcall" )
+            TestHotCall();
+        else if( testName == "batch" )
+            TestBatch();
+        else if( testName == "condvar" )
+            TestCondVar();
+        else if( testName == "eventfd" )
+            TestFdChannel( "eventfd", true );
+        else if( testName == "pipe" )
+            TestFdChannel( "pipe", false );
+        else if( testName == "stress" )
+            TestStress();
+        else if( testName == "clock" )
+            TestClock();
+        else if( testName == "stream" )
+            TestStream();
+        else if( testName == "trace" )
+            TestTrace();
+        else if( testName == "cross-process" )
+            TestCrossProcess();
+        else
+            return false;
+
+        return true;
+    }
+
+    void TestHotCall()
+    {
+        vector<uint64_t>  latencies( m_iterations );
+        SharedMemoryArena arena;
+        if( ! SharedMemoryArena_init( &arena, SHARED_MEMORY_HUGE_PAGE_SIZE, SharedMemory_currentNumaNode() ) ) {
+            Fail( "hotcall", "failed to allocate shared memory" );
+            return;
+        }
+
+        HotCall  *hotCall = (HotCall*) SharedMemoryArena_alloc( &arena, sizeof( HotCall ) );
+        uint64_t *data    = (uint64_t*)SharedMemoryArena_alloc( &arena, sizeof( uint64_t ) );
+        HotCall_init( hotCall );
+        *data = 0;
+        HotCallResponder_start( hotCall, &m_callTable, m_responderCpu );
+
+        uint64_t startNs = NowNs();
+        for( uint64_t i = 0; i < m_iterations; ++i ) {
+            uint64_t startTime = rdtscp();
+            HotCall_requestCall( hotCall, 0, data );
+            latencies[ i ] = rdtscp() - startTime;
+        }
+        uint64_t elapsedNs = NowNs() - startNs;
+
+        HotCallResponder_stop( hotCall );
+        CheckCount( "hotcall", *data, m_iterations );
+        SharedMemoryArena_destroy( &arena );
+
+        PrintLatencies( "hotcall", latencies, elapsedNs );
+    }
+
+    void TestBatch()
+    {
+        //iterations calls, posted batch-size at a time, plus one entry with an unknown callID
+        //per batch that the responder must skip
+        const uint64_t batchSize  = max<uint64_t>( GetOption( "batch-size", 16 ), 1 );
+        const uint64_t numBatches = ( m_iterations + batchSize - 1 ) / batchSize;
+
+        vector<uint64_t>          latencies( numBatches );
+        vector<HotCallBatchEntry> entries( batchSize + 1 );
+        uint64_t                  data    = 0;
+        HotCall                   hotCall = HOTCALL_INITIALIZER;
+        for( uint64_t j = 0; j < batchSize; ++j ) {
+            entries[ j ].callID = 0;
+            entries[ j ].data   = &data;
+        }
+        entries[ batchSize ].callID = m_callTable.numEntries;
+        entries[ batchSize ].data   = &data;
+
+        HotCallBatch batch;
+        batch.numEntries  = batchSize + 1;
+        batch.numRejected = 0;
+        batch.entries     = &entries[ 0 ];
+        HotCallResponder_start( &hotCall, &m_callTable, m_responderCpu );
+
+        uint64_t startNs = NowNs();
+        for( uint64_t i = 0; i < numBatches; ++i ) {
+            uint64_t startTime = rdtscp();
+            HotCall_requestBatch( &hotCall, &batch );
+            latencies[ i ] = rdtscp() - startTime;
+        }
+        uint64_t elapsedNs = NowNs() - startNs;
+
+        HotCallResponder_stop( &hotCall );
+        CheckCount( "batch", data, numBatches * batchSize );
+        CheckCount( "batch rejected", batch.numRejected, 1 );
+
+        sort( latencies.begin(), latencies.end() );
+        uint64_t median = latencies[ ( numBatches - 1 ) / 2 ];
+        printf( "%-16s p50 %8lu cycles per batch of %lu, %.1f cycles per call, %10.0f calls/s\n", "batch",
+                median, batchSize, (double)median / batchSize, numBatches * batchSize * 1e9 / elapsedNs );
+    }
+
+    void TestCondVar()
+    {
+        vector<uint64_t> latencies( m_iterations );
+        uint64_t         data = 0;
+        CondVarChannel   channel;
+        pthread_t        responder;
+
+        pthread_mutex_init( &channel.mutex, NULL );
+        pthread_cond_init( &channel.requestReady, NULL );
+        pthread_cond_init( &channel.responseReady, NULL );
+        channel.hasRequest  = false;
+        channel.hasResponse = false;
+        channel.keepRunning = true;
+        channel.data        = &data;
+        CreatePinnedThread( &responder, m_responderCpu, CondVarResponderThread, &channel );
+
+        uint64_t startNs = NowNs();
+        for( uint64_t i = 0; i < m_iterations; ++i ) {
+            uint64_t startTime = rdtscp();
+            CondVarCall( &channel, &data );
+            latencies[ i ] = rdtscp() - startTime;
+        }
+        uint64_t elapsedNs = NowNs() - startNs;
+
+        pthread_mutex_lock( &channel.mutex );
+        channel.keepRunning = false;
+        pthread_cond_signal( &channel.requestReady );
+        pthread_mutex_unlock( &channel.mutex );
+        pthread_join( responder, NULL );
+
+        pthread_cond_destroy( &channel.responseReady );
+        pthread_cond_destroy( &channel.requestReady );
+        pthread_mutex_destroy( &channel.mutex );
+
+        CheckCount( "condvar", data, m_iterations );
+        PrintLatencies( "condvar", latencies, elapsedNs );
+    }
+
+    void TestFdChannel( const char* name, bool useEventFd )
+    {
+        vector<uint64_t> latencies( m_iterations );
+        uint64_t         data = 0;
+        FdChannel        channel;
+        pthread_t        responder;
+
+        if( useEventFd ) {
+            channel.requestRead  = channel.requestWrite  = eventfd( 0, 0 );
+            channel.responseRead = channel.responseWrite = eventfd( 0, 0 );
+        }
+        else {
+            int requestPipe[ 2 ], responsePipe[ 2 ];
+            if( pipe( requestPipe ) != 0 || pipe( responsePipe ) != 0 ) {
+                Fail( name, "pipe() failed" );
+                return;
+            }
+            channel.requestRead   = requestPipe[ 0 ];
+            channel.requestWrite  = requestPipe[ 1 ];
+            channel.responseRead  = responsePipe[ 0 ];
+            channel.responseWrite = responsePipe[ 1 ];
+        }
+        channel.data = &data;
+        CreatePinnedThread( &responder, m_responderCpu, FdResponderThread, &channel );
+
+        uint64_t startNs = NowNs();
+        for( uint64_t i = 0; i < m_iterations; ++i ) {
+            uint64_t startTime = rdtscp();
+            FdSend( channel.requestWrite, FD_MESSAGE_CALL );
+            FdReceive( channel.responseRead );
+            latencies[ i ] = rdtscp() - startTime;
+        }
+        uint64_t elapsedNs = NowNs() - startNs;
+
+        FdSend( channel.requestWrite, FD_MESSAGE_STOP );
+        pthread_join( responder, NULL );
+
+        close( channel.requestRead );
+        close( channel.responseRead );
+        if( ! useEventFd ) {
+            close( channel.requestWrite );
+            close( channel.responseWrite );
+        }
+
+        CheckCount( name, data, m_iterations );
+        PrintLatencies( name, latencies, elapsedNs );
+    }
+
+    void TestStress()
+    {
+        //Several callers on one channel: every call must be served exactly once, whatever
+        //the interleaving of busy slots, retries and rejections
+        const uint64_t numCallers = GetOption( "stress-callers", 4 );
+        const uint64_t numCalls   = m_iterations / numCallers + 1;
+
+        HotCall hotCall;
+        HotCall_init( &hotCall );
+        HotCallResponder_start( &hotCall, &m_callTable, m_responderCpu );
+        RunStressCallers( "stress-hotcall", &hotCall, NULL, NULL, numCallers, numCalls );
+        HotCallResponder_stop( &hotCall );
+
+        HotLaneChannel    laneChannel;
+        LaneResponderArgs laneArgs = { &laneChannel, &m_callTable };
+        HotLaneChannel_init( &laneChannel, 2, HOTCALL_DEFAULT_STARVATION_LIMIT );
+        CreatePinnedThread( &laneChannel.responderThread, m_responderCpu, LaneResponderThread, &laneArgs );
+        RunStressCallers( "stress-lanes", NULL, &laneChannel, NULL, numCallers, numCalls );
+        HotLaneChannel_stop( &laneChannel );
+        pthread_join( laneChannel.responderThread, NULL );
+
+        HotCallMux       mux;
+        MuxResponderArgs muxArgs = { &mux, &m_callTable };
+        HotCallMux_init( &mux );
+        CreatePinnedThread( &mux.responderThread, m_responderCpu, MuxResponderThread, &muxArgs );
+        RunStressCallers( "stress-mux", NULL, NULL, &mux, numCallers, numCalls );
+        HotCallMux_stop( &mux );
+        pthread_join( mux.responderThread, NULL );
+        CheckCount( "stress-mux served", mux.numServed, numCallers * numCalls );
+        for( int word = 0; word < HOTCALL_MUX_NUM_WORDS; ++word )
+            CheckCount( "stress-mux slots left", mux.activeBits[ word ], 0 );
+
+        //Responders must come and go cleanly on the same channel
+        uint64_t data = 0;
+        for( int round = 0; round < 16; ++round ) {
+            HotCall_init( &hotCall );
+            HotCallResponder_start( &hotCall, &m_callTable, m_responderCpu );
+            while( HotCall_requestCall( &hotCall, 0, &data ) < 0 )
+                ;
+            HotCallResponder_stop( &hotCall );
+        }
+        CheckCount( "stress-restart", data, 16 );
+    }
+
+    void TestClock()
+    {
+        //Fresh reads from the caller while the publisher runs on the responder cpu: time never
+        //goes backwards, ns tracks CLOCK_MONOTONIC, and reads fail once the publisher stops.
+        //A stale read only means the publisher was descheduled, so it is counted, not failed.
+        const uint64_t maxSkewNs = 10000000;
+
+        vector<uint64_t> latencies;
+        HotClockPage     clockPage;
+        ClockPublisher   publisher;
+        if( ! ClockPublisher_start( &publisher, &clockPage, m_responderCpu ) ) {
+            Fail( "clock", "failed to start the publisher" );
+            return;
+        }
+
+        HotClockSample previous = { 0, 0, 0 };
+        uint64_t       numStale = 0;
+        uint64_t       startNs  = NowNs();
+        for( uint64_t i = 0; i < m_iterations; ++i ) {
+            HotClockSample sample;
+            uint64_t startTime = rdtscp();
+            int      ret       = HotClock_read( &clockPage, HOTCLOCK_DEFAULT_WAIT_SPINS, &sample );
+            uint64_t endTime   = rdtscp();
+            uint64_t nowNs     = NowNs();
+            if( ret == HOTCLOCK_ERROR_STALE ) {
+                numStale++;
+                continue;
+            }
+            if( ret != HOTCLOCK_OK ) {
+                printf( "Error! clock: read failed with %d\n", ret );
+                m_numFailures++;
+                break;
+            }
+            if( sample.tsc < previous.tsc || sample.ns < previous.ns ) {
+                Fail( "clock", "published time went backwards" );
+                break;
+            }
+            if( sample.ns > nowNs + maxSkewNs || nowNs > sample.ns + maxSkewNs ) {
+                printf( "Error! clock: published time is %ld ns off CLOCK_MONOTONIC\n", (int64_t)( nowNs - sample.ns ) );
+                m_numFailures++;
+                break;
+            }
+
+            previous = sample;
+            latencies.push_back( endTime - startTime );
+        }
+        uint64_t elapsedNs = NowNs() - startNs;
+
+        ClockPublisher_stop( &publisher );
+        HotClockSample sample;
+        if( HotClock_read( &clockPage, 0, &sample ) != HOTCLOCK_ERROR_STOPPED )
+            Fail( "clock", "read succeeded after the publisher stopped" );
+
+        printf( "%-16s %lu publisher updates, %lu stale reads\n", "clock", publisher.numUpdates, numStale );
+        if( ! latencies.empty() )
+            PrintLatencies( "clock", latencies, elapsedNs );
+    }
+
+    void TestStream()
+    {
+        //A producer on the responder cpu streams stream-bytes through a ring of 4 chunks while
+        //the caller consumes them: every word arrives in order, and the end of the stream is
+        //reported after the last chunk, and from then on
+        const uint64_t numBytes  = GetOption( "stream-bytes", 64 << 20 ) & ~7ULL;
+        const uint32_t numChunks = 4;
+        const uint32_t chunkSize = 64 * 1024;
+
+        SharedMemoryArena arena;
+        if( ! SharedMemoryArena_init( &arena, sizeof( HotStream ) + numChunks * chunkSize + SHARED_MEMORY_CACHE_LINE_SIZE,
+                                      SharedMemory_currentNumaNode() ) ) {
+            Fail( "stream", "failed to allocate shared memory" );
+            return;
+        }
+        HotStream* stream = (HotStream*)SharedMemoryArena_alloc( &arena, sizeof( HotStream ) );
+        uint8_t*   chunks = (uint8_t*)  SharedMemoryArena_alloc( &arena, numChunks * chunkSize );
+        HotStream_init( stream, chunks, numChunks, chunkSize );
+
+        StreamProducerArgs args;
+        args.stream      = stream;
+        args.numBytes    = numBytes;
+        args.numProduced = 0;
+
+        uint64_t  startNs = NowNs();
+        pthread_t producerThread;
+        CreatePinnedThread( &producerThread, m_responderCpu, StreamProducerThread, &args );
+
+        HotStreamEnd   consumer;
+        const uint8_t* chunk;
+        uint32_t       length;
+        uint64_t       offset        = 0;
+        uint64_t       numChunksRead = 0;
+        uint64_t       checksum      = 0;
+        bool           inOrder       = true;
+        HotStreamEnd_attach( &consumer, stream );
+        while( HotStream_next( &consumer, &chunk, &length ) == HOTSTREAM_OK ) {
+            const uint64_t* words = (const uint64_t*)chunk;
+            if( length == 0 || words[ 0 ] != ( offset / 8 ) * STREAM_DATA_MULTIPLIER ||
+                words[ length / 8 - 1 ] != ( ( offset + length ) / 8 - 1 ) * STREAM_DATA_MULTIPLIER )
+                inOrder = false;
+
+            checksum += StreamData_checksum( chunk, length );
+            offset   += length;
+            numChunksRead++;
+            HotStream_release( &consumer );
+        }
+        uint64_t elapsedNs = NowNs() - startNs;
+        pthread_join( producerThread, NULL );
+
+        if( ! inOrder )
+            Fail( "stream", "chunks arrived out of order" );
+        if( offset != numBytes || checksum != StreamData_expectedChecksum( numBytes ) )
+            Fail( "stream", "streamed data is different than expected" );
+        if( HotStream_tryNext( &consumer, &chunk, &length ) != HOTSTREAM_END )
+            Fail( "stream", "stream did not stay ended" );
+        CheckStreamAbort( stream, chunks, numChunks, chunkSize );
+        SharedMemoryArena_destroy( &arena );
+
+        printf( "%-16s %lu bytes in %lu chunks, %.2f GB/s\n", "stream", offset, numChunksRead, (double)offset / elapsedNs );
+    }
+
+    //A consumer that takes one chunk and aborts: the producer, blocked on a full ring, must stop
+    void CheckStreamAbort( HotStream* stream, uint8_t* chunks, uint32_t numChunks, uint32_t chunkSize )
+    {
+        HotStream_init( stream, chunks, numChunks, chunkSize );
+
+        StreamProducerArgs args;
+        args.stream      = stream;
+        args.numBytes    = (uint64_t)numChunks * chunkSize * 16;
+        args.numProduced = 0;
+
+        pthread_t producerThread;
+        CreatePinnedThread( &producerThread, m_responderCpu, StreamProducerThread, &args );
+
+        HotStreamEnd   consumer;
+        const uint8_t* chunk;
+        uint32_t       length;
+        HotStreamEnd_attach( &consumer, stream );
+        if( HotStream_next( &consumer, &chunk, &length ) == HOTSTREAM_OK )
+            HotStream_release( &consumer );
+        HotStream_abort( &consumer );
+
+        struct timespec deadline;
+        clock_gettime( CLOCK_REALTIME, &deadline );
+        deadline.tv_sec += 5;
+        if( pthread_timedjoin_np( producerThread, NULL, &deadline ) != 0 ) {
+            //The producer still uses the ring; leaking it beats freeing it under the thread
+            Fail( "stream", "producer did not stop after the consumer aborted" );
+            exit( 1 );
+        }
+        if( args.numProduced >= args.numBytes )
+            Fail( "stream", "producer streamed past the abort" );
+    }
+
+    void TestTrace()
+    {
+        //Two threads record more requests than the trace holds, then the trace is written and
+        //read back: every request is either in the file or counted as dropped, capacity is not
+        //stranded in the buffer of the thread that finished first, and each thread's requests
+        //are in order
+        const uint64_t  numCallsPerThread = 5000;
+        const uint64_t  maxRecords        = 8000;
+        const uint16_t  numThreads        = 2;
+        TraceCallerArgs args[ numThreads ];
+        pthread_t       callerThreads[ numThreads ];
+
+        HotCallTrace_start( maxRecords );
+        for( uint16_t t = 0; t < numThreads; ++t ) {
+            args[ t ].callID   = t;
+            args[ t ].numCalls = numCallsPerThread;
+            pthread_create( &callerThreads[ t ], NULL, TraceCallerThread, &args[ t ] );
+        }
+        for( uint16_t t = 0; t < numThreads; ++t )
+            pthread_join( callerThreads[ t ], NULL );
+        HotCallTrace_stop();
+
+        char tracePath[ 64 ];
+        snprintf( tracePath, sizeof( tracePath ), "/tmp/hotcalls-bench-%d%s", (int)getpid(), HOTCALL_TRACE_EXTENSION );
+        HotCallTraceFile trace;
+        if( ! HotCallTrace_write( tracePath, 1 ) || ! HotCallTrace_open( &trace, tracePath ) ) {
+            Fail( "trace", "cannot write and read back the trace" );
+            unlink( tracePath );
+            return;
+        }
+
+        const uint64_t numRecords = trace.header->fields.numRecords;
+        CheckCount( "trace records and drops", numRecords + trace.header->fields.numDropped, numThreads * numCallsPerThread );
+        CheckCount( "trace threads", trace.header->fields.numThreads, numThreads );
+        if( numRecords > maxRecords || numRecords < maxRecords - maxRecords / HOTCALL_TRACE_SHARE_DIVISOR )
+            Fail( "trace", "the trace did not use its capacity" );
+
+        bool     inOrder = true;
+        uint64_t nextPayload[ numThreads ] = { 0 };
+        uint16_t threadOf[ numThreads ]    = { 0 };
+        for( uint64_t i = 0; i < numRecords; ++i ) {
+            const HotCallTraceRecord* record = &trace.records[ i ];
+            if( ( i > 0 && record->tsc < trace.records[ i - 1 ].tsc ) || record->callID >= numThreads ) {
+                inOrder = false;
+                break;
+            }
+            //Records of a thread keep their order, gaps are drops; a thread keeps its number
+            if( record->payloadSize < nextPayload[ record->callID ] ||
+                ( nextPayload[ record->callID ] > 0 && record->thread != threadOf[ record->callID ] ) )
+                inOrder = false;
+            nextPayload[ record->callID ] = record->payloadSize + 1;
+            threadOf[ record->callID ]    = record->thread;
+        }
+        if( ! inOrder )
+            Fail( "trace", "records are out of order" );
+
+        printf( "%-16s %lu of %lu requests recorded, %lu dropped\n", "trace", numRecords,
+                numThreads * numCallsPerThread, trace.header->fields.numDropped );
+        HotCallTrace_release( &trace );
+        unlink( tracePath );
+    }
+
+    void TestCrossProcess()
+    {
+        //Forked clients attach to the channels of this process by name and call a responder
+        //thread, against the same calls forwarded over a Unix socket. Then both sides must
+        //detect a dead peer.
+        const uint32_t numClients = GetOption( "cross-process-clients", 1 );
+        char segmentName[ SHARED_CHANNELS_NAME_SIZE ];
+        char socketPath[ CROSS_PROCESS_PATH_SIZE ];
+        snprintf( segmentName, sizeof( segmentName ), "/hotcalls-bench-%d", (int)getpid() );
+        snprintf( socketPath,  sizeof( socketPath ),  "/tmp/hotcalls-bench-%d.sock", (int)getpid() );
+
+        SharedChannels channels;
+        if( ! SharedChannels_create( &channels, segmentName, numClients ) ) {
+            Fail( "cross-process", "cannot create the shared channels" );
+            return;
+        }
+
+        RunCrossProcessClients( "cross-hotcall", CROSS_PROCESS_HOT, segmentName, &channels, numClients );
+        if( SharedChannels_reapDeadCallers( &channels ) != 0 )
+            Fail( "cross-process", "a client that exited cleanly left its channel claimed" );
+        RunCrossProcessClients( "cross-socket", CROSS_PROCESS_SOCKET, socketPath, NULL, numClients );
+
+        CheckDeadCaller( &channels, segmentName );
+        CheckDeadClaimer( &channels );
+        SharedChannels_close( &channels );
+        CheckDeadOwner();
+    }
+
+    void RunCrossProcessClients( const char* name, CrossProcessMode mode, const char* target,
+                                 SharedChannels* channels, uint32_t numClients )
+    {
+        vector<uint64_t>            latencies( numClients * m_iterations );
+        vector<SharedResponderArgs> responderArgs( numClients );
+        vector<pthread_t>           responders( numClients );
+        SocketForwarder             forwarder;
+        CrossProcessClients         clients;
+
+        //Fork before starting threads
+        if( ! CrossProcess_spawn( &clients, mode, target, numClients, m_iterations, &latencies[ 0 ] ) ) {
+            Fail( name, "cannot start the clients" );
+            return;
+        }
+
+        if( mode == CROSS_PROCESS_HOT ) {
+            for( uint32_t c = 0; c < numClients; ++c ) {
+                responderArgs[ c ].channel   = &channels->segment->channels[ c ];
+                responderArgs[ c ].callTable = &m_sharedCallTable;
+                CreatePinnedThread( &responders[ c ], m_responderCpu, SharedResponderThread, &responderArgs[ c ] );
+            }
+        }
+        else if( ! SocketForwarder_start( &forwarder, target, IncrementIntCall ) ) {
+            Fail( name, "cannot listen on the socket" );
+            CrossProcess_collect( &clients, &latencies[ 0 ] );
+            return;
+        }
+
+        CrossProcess_go( &clients );
+        bool ok = CrossProcess_collect( &clients, &latencies[ 0 ] );
+
+        if( mode == CROSS_PROCESS_HOT ) {
+            for( uint32_t c = 0; c < numClients; ++c ) {
+                HotSharedChannel_stop( &channels->segment->channels[ c ] );
+                pthread_join( responders[ c ], NULL );
+            }
+        }
+        else
+            SocketForwarder_stop( &forwarder );
+
+        if( ! ok ) {
+            Fail( name, "a client failed" );
+            return;
+        }
+        CheckCount( name, clients.numErrors, 0 );
+
+        //Throughput of all clients together, each timing its own calls
+        PrintLatencies( name, latencies, (uint64_t)( latencies.size() * 1e9 / clients.callsPerSecond ) );
+    }
+
+    void CheckDeadCaller( SharedChannels* channels, const char* segmentName )
+    {
+        //A caller that exits with a call in flight: the responder completes the call, then the
+        //owner frees the channel
+        HotSharedChannel*   channel = &channels->segment->channels[ 0 ];
+        SharedResponderArgs responderArgs = { channel, &m_sharedCallTable };
+        pthread_t           responder;
+        channel->keepPolling = true;
+        CreatePinnedThread( &responder, m_responderCpu, SharedResponderThread, &responderArgs );
+
+        pid_t pid = fork();
+        if( pid == 0 ) {
+            SharedChannels attached;
+            if( SharedChannels_attach( &attached, segmentName ) ) {
+                HotSharedChannel* claimed = SharedChannels_claim( &attached );
+                if( claimed != NULL )
+                    HotSharedChannel_post( claimed, 0, sizeof( int ) );
+            }
+            _exit( 0 );
+        }
+        waitpid( pid, NULL, 0 );
+
+        uint32_t numReaped = 0;
+        for( int attempt = 0; attempt < 1000 && numReaped == 0; ++attempt ) {
+            numReaped = SharedChannels_reapDeadCallers( channels );
+            if( numReaped == 0 )
+                usleep( 1000 );
+        }
+        HotSharedChannel_stop( channel );
+        pthread_join( responder, NULL );
+
+        if( numReaped != 1 || channel->callerPid != 0 || channel->state != HOTCALL_SHARED_IDLE )
+            Fail( "cross-process", "the channel of a dead caller was not freed" );
+        else
+            printf( "%-16s dead caller detected, its channel was freed: OK\n", "cross-process" );
+    }
+
+    void CheckDeadClaimer( SharedChannels* channels )
+    {
+        //A caller that dies after claiming a channel but before setting its start time
+        pid_t pid = fork();
+        if( pid == 0 )
+            _exit( 0 );
+        waitpid( pid, NULL, 0 );
+
+        HotSharedChannel* channel = &channels->segment->channels[ 0 ];
+        channel->callerStartTime  = 0;
+        __atomic_store_n( &channel->callerPid, (uint32_t)pid, __ATOMIC_RELEASE );
+
+        if( SharedChannels_reapDeadCallers( channels ) != 1 || channel->callerPid != 0 )
+            Fail( "cross-process", "the channel of a caller that died while claiming it was not freed" );
+        else
+            printf( "%-16s caller dead while claiming detected, its channel was freed: OK\n", "cross-process" );
+    }
+
+    void CheckDeadOwner()
+    {
+        //The owner dies with a call posted and no responder: the caller must give up
+        char segmentName[ SHARED_CHANNELS_NAME_SIZE ];
+        snprintf( segmentName, sizeof( segmentName ), "/hotcalls-bench-owner-%d", (int)getpid() );
+
+        int createdPipe[ 2 ], exitPipe[ 2 ];
+        if( pipe( createdPipe ) != 0 || pipe( exitPipe ) != 0 ) {
+            Fail( "cross-process", "pipe() failed" );
+            return;
+        }
+
+        pid_t pid = fork();
+        if( pid == 0 ) {
+            SharedChannels owned;
+            char           created = SharedChannels_create( &owned, segmentName, 1 ) ? 1 : 0;
+            char           unused;
+            close( exitPipe[ 1 ] );
+            if( write( createdPipe[ 1 ], &created, 1 ) == 1 )
+                while( read( exitPipe[ 0 ], &unused, 1 ) > 0 )
+                    ;
+            _exit( 0 );
+        }
+        close( createdPipe[ 1 ] );
+        close( exitPipe[ 0 ] );
+
+        char           created = 0;
+        SharedChannels channels;
+        bool           attached = read( createdPipe[ 0 ], &created, 1 ) == 1 && created &&
+                                  SharedChannels_attach( &channels, segmentName );
+        HotSharedChannel* channel = attached ? SharedChannels_claim( &channels ) : NULL;
+        close( exitPipe[ 1 ] );
+        close( createdPipe[ 0 ] );
+        waitpid( pid, NULL, 0 );
+
+        int status = channel != NULL ? SharedChannels_requestCall( &channels, channel, 0, sizeof( int ) )
+                                     : SHARED_CHANNELS_OK;
+        if( attached )
+            SharedChannels_close( &channels );
+        shm_unlink( segmentName );
+
+        if( status != SHARED_CHANNELS_ERROR_PEER_DEAD )
+            Fail( "cross-process", "a call to a dead owner did not fail" );
+        else
+            printf( "%-16s dead owner detected by the caller: OK\n", "cross-process" );
+    }
+
+    //With a mux every caller gets a channel of its own, otherwise all share hotCall or laneChannel
+    void RunStressCallers( const char* name, HotCall* hotCall, HotLaneChannel* laneChannel, HotCallMux* mux,
+                           uint64_t numCallers, uint64_t numCalls )
+    {
+        vector<StressCallerArgs> callerArgs( numCallers );
+        vector<pthread_t>        callerThreads( numCallers );
+        vector<HotCall>          ownChannels( numCallers );
+        for( size_t c = 0; c < numCallers; ++c ) {
+            HotCall_init( &ownChannels[ c ] );
+            callerArgs[ c ].hotCall     = mux != NULL ? &ownChannels[ c ] : hotCall;
+            callerArgs[ c ].laneChannel = laneChannel;
+            callerArgs[ c ].mux         = mux;
+            callerArgs[ c ].lane        = c % 2;
+            callerArgs[ c ].numCalls    = numCalls;
+            callerArgs[ c ].counter     = 0;
+            callerArgs[ c ].numRejected = 0;
+            pthread_create( &callerThreads[ c ], NULL, StressCallerThread, &callerArgs[ c ] );
+        }
+
+        uint64_t numRejected = 0;
+        int      failuresBefore = m_numFailures;
+        for( size_t c = 0; c < numCallers; ++c ) {
+            pthread_join( callerThreads[ c ], NULL );
+            CheckCount( name, callerArgs[ c ].counter, numCalls );
+            numRejected += callerArgs[ c ].numRejected;
+        }
+
+        printf( "%-16s %lu callers x %lu calls, %lu rejected requests retried: %s\n",
+                name, numCallers, numCalls, numRejected, m_numFailures == failuresBefore ? "OK" : "FAILED" );
+    }
+
+    uint64_t GetOption( const string& name, int64_t defaultValue ) const
+    {
+        map<string, string>::const_iterator it = m_options.find( name );
+        if( it == m_options.end() )
+            return defaultValue;
+
+        return strtoll( it->second.c_str(), NULL, 0 );
+    }
+
+    void CheckCount( const char* name, uint64_t actual, uint64_t expected )
+    {
+        if( actual != expected ) {
+            printf( "Error! %s: data is different than expected: %lu != %lu\n", name, actual, expected );
+            m_numFailures++;
+        }
+    }
+
+    void Fail( const char* name, const char* reason )
+    {
+        printf( "Error! %s: %s\n", name, reason );
+        m_numFailures++;
+    }
+
+    static uint64_t NowNs()
+    {
+        struct timespec now;
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    }
+
+    static void PrintLatencies( const char* name, vector<uint64_t> latencies, uint64_t elapsedNs )
+    {
+        sort( latencies.begin(), latencies.end() );
+        size_t   n    = latencies.size();
+        double   mean = 0;
+        for( size_t i = 0; i < n; ++i )
+            mean += latencies[ i ];
+        mean /= n;
+
+        printf( "%-16s p50 %8lu p99 %8lu p99.9 %8lu mean %10.1f cycles, %10.0f calls/s\n", name,
+                latencies[ ( n - 1 ) * 50 / 100 ], latencies[ ( n - 1 ) * 99 / 100 ], latencies[ ( n - 1 ) * 999 / 1000 ],
+                mean, n * 1e9 / elapsedNs );
+    }
+};
+
+int main( int argc, char *argv[] )
+{
+    //Arguments are test names, or options in the form --name=value
+    map<string, string> options;
+    vector<string>      testNames;
+    for( int i = 1; i < argc; ++i ) {
+        string arg = argv[ i ];
+        if( arg == "--help" ) {
+            HostBenchmark::PrintUsage();
+            return 0;
+        }
+
+        if( arg.compare( 0, 2, "--" ) != 0 ) {
+            testNames.push_back( arg );
+            continue;
+        }
+
+        size_t separator = arg.find( '=' );
+        if( separator == string::npos )
+            options[ arg.substr( 2 ) ] = "1";
+        else
+            options[ arg.substr( 2, separator - 2 ) ] = arg.substr( separator + 1 );
+    }
+
+    HostBenchmark hostBenchmark( options );
+    return hostBenchmark.Run( testNames );
+}
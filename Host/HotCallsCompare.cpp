@@ -0,0 +1,397 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//hotcalls_compare: compares two measurement directories, call type by call type.
+//For every measurement found in both, reports the median and p99 deltas with bootstrap
+//confidence intervals and a Mann-Whitney U test, and exits with 1 when a regression
+//beyond the configured threshold is statistically significant. Columns are latencies, where
+//lower is better, unless their metadata marks them higher-is-better (throughputs):
+//  0 - no regression, 1 - regression, 2 - usage or input error
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <algorithm>
+
+#include "../App/MeasurementStore.h"
+
+using namespace std;
+
+static void PrintUsage()
+{
+    printf( "Usage: hotcalls_compare [--option=value ...] <baseline dir> <candidate dir>\n" );
+    printf( "Options:\n" );
+    printf( "  --threshold=PCT       median regression that fails the comparison (default 5)\n" );
+    printf( "  --tail-threshold=PCT  p99 regression that fails the comparison (default 0, disabled)\n" );
+    printf( "  --alpha=P             Mann-Whitney significance level (default 0.01)\n" );
+    printf( "  --confidence=PCT      confidence interval level (default 95)\n" );
+    printf( "  --bootstrap=N         bootstrap resamples (default 1000)\n" );
+    printf( "  --max-samples=N       samples per side used for bootstrapping (default 20000)\n" );
+    printf( "  --seed=N              random seed (default 1)\n" );
+    printf( "  --only=NAME           compare a single measurement\n" );
+}
+
+static bool EndsWith( const string& value, const string& suffix )
+{
+    return value.size() >= suffix.size() &&
+           value.compare( value.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+//Measurement names in a directory: binary columns, and CSV files of older runs
+static set<string> ListMeasurements( const string& directory )
+{
+    set<string> names;
+    DIR* dir = opendir( directory.c_str() );
+    if( dir == NULL )
+        return names;
+
+    struct dirent* entry;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        string fileName = entry->d_name;
+        if( EndsWith( fileName, MEASUREMENT_STORE_EXTENSION ) )
+            names.insert( fileName.substr( 0, fileName.size() - strlen( MEASUREMENT_STORE_EXTENSION ) ) );
+        else if( EndsWith( fileName, ".csv" ) )
+            names.insert( fileName.substr( 0, fileName.size() - strlen( ".csv" ) ) );
+    }
+    closedir( dir );
+
+    return names;
+}
+
+//CSV files carry no metadata; their samples are taken as latencies
+static bool LoadSamples( const string& directory, const string& name, vector<uint64_t>* samples, bool* higherIsBetter )
+{
+    MeasurementColumn column;
+    string columnPath = directory + "/" + name + MEASUREMENT_STORE_EXTENSION;
+    if( MeasurementColumn_open( &column, columnPath.c_str() ) ) {
+        samples->assign( column.rows, column.rows + column.header->fields.numRows );
+        *higherIsBetter = MeasurementHeader_hasExtra( column.header, MEASUREMENT_BETTER_KEY, MEASUREMENT_HIGHER_IS_BETTER );
+        MeasurementColumn_release( &column );
+        return true;
+    }
+
+    string csvPath = directory + "/" + name + ".csv";
+    FILE* csvFile  = fopen( csvPath.c_str(), "r" );
+    if( csvFile == NULL )
+        return false;
+    *higherIsBetter = false;
+
+    char line[ 64 ];
+    while( fgets( line, sizeof( line ), csvFile ) != NULL ) {
+        char* end;
+        uint64_t value = strtoull( line, &end, 10 );
+        if( end != line )
+            samples->push_back( value );
+    }
+    fclose( csvFile );
+
+    return true;
+}
+
+static uint64_t Quantile( const vector<uint64_t>& sorted, double quantile )
+{
+    return sorted[ (size_t)( quantile * ( sorted.size() - 1 ) ) ];
+}
+
+static double DeltaPercent( double baseline, double candidate )
+{
+    return baseline == 0 ? 0 : ( candidate - baseline ) * 100.0 / baseline;
+}
+
+typedef struct {
+    double  low;
+    double  high;
+} Interval;
+
+class Comparator {
+public:
+    Comparator( const map<string, string>& options ) : m_options( options ) {
+        m_threshold     = GetDouble( "threshold",      5 );
+        m_tailThreshold = GetDouble( "tail-threshold", 0 );
+        m_alpha         = GetDouble( "alpha",          0.01 );
+        m_confidence    = GetDouble( "confidence",     95 );
+        m_numResamples  = (size_t)GetDouble( "bootstrap",   1000 );
+        m_maxSamples    = (size_t)GetDouble( "max-samples", 20000 );
+        m_rng.seed( (uint64_t)GetDouble( "seed", 1 ) );
+    }
+
+    //Returns the number of regressions, or -1 if nothing could be compared
+    int Compare( const string& baselineDir, const string& candidateDir ) {
+        set<string> baselineNames  = ListMeasurements( baselineDir );
+        set<string> candidateNames = ListMeasurements( candidateDir );
+        map<string, string>::const_iterator only = m_options.find( "only" );
+
+        printf( "%-48s %10s %10s %26s %10s %10s %26s %9s  %s\n", "measurement",
+                "base p50", "cand p50", "p50 delta % [CI]", "base p99", "cand p99", "p99 delta % [CI]",
+                "MW p", "verdict" );
+
+        int numCompared    = 0;
+        int numRegressions = 0;
+        for( set<string>::const_iterator it = baselineNames.begin(); it != baselineNames.end(); ++it ) {
+            if( only != m_options.end() && *it != only->second )
+                continue;
+
+            if( candidateNames.count( *it ) == 0 ) {
+                printf( "%-48s only in baseline\n", it->c_str() );
+                continue;
+            }
+
+            vector<uint64_t> baseline, candidate;
+            bool             baseHigherIsBetter, candHigherIsBetter;
+            if( ! LoadSamples( baselineDir, *it, &baseline, &baseHigherIsBetter ) ||
+                ! LoadSamples( candidateDir, *it, &candidate, &candHigherIsBetter ) ) {
+                printf( "%-48s cannot be read\n", it->c_str() );
+                continue;
+            }
+            if( baseline.empty() || candidate.empty() ) {
+                printf( "%-48s has no samples\n", it->c_str() );
+                continue;
+            }
+
+            numCompared++;
+            if( CompareMeasurement( *it, baseline, candidate, baseHigherIsBetter || candHigherIsBetter ) )
+                numRegressions++;
+        }
+
+        for( set<string>::const_iterator it = candidateNames.begin(); it != candidateNames.end(); ++it ) {
+            if( baselineNames.count( *it ) == 0 && ( only == m_options.end() || *it == only->second ) )
+                printf( "%-48s only in candidate\n", it->c_str() );
+        }
+
+        if( numCompared == 0 )
+            return -1;
+
+        printf( "%d of %d measurements regressed (median threshold %.1f%%, p99 threshold %.1f%%, alpha %g)\n",
+                numRegressions, numCompared, m_threshold, m_tailThreshold, m_alpha );
+        return numRegressions;
+    }
+
+private:
+    map<string, string> m_options;
+    double              m_threshold;
+    double              m_tailThreshold;
+    double              m_alpha;
+    double              m_confidence;
+    size_t              m_numResamples;
+    size_t              m_maxSamples;
+    mt19937_64          m_rng;
+
+    double GetDouble( const string& name, double defaultValue ) const
+    {
+        map<string, string>::const_iterator it = m_options.find( name );
+        if( it == m_options.end() )
+            return defaultValue;
+
+        return strtod( it->second.c_str(), NULL );
+    }
+
+    bool CompareMeasurement( const string& name, vector<uint64_t>& baseline, vector<uint64_t>& candidate,
+                             bool higherIsBetter )
+    {
+        sort( baseline.begin(),  baseline.end() );
+        sort( candidate.begin(), candidate.end() );
+
+        const double baseP50 = Quantile( baseline,  0.5 );
+        const double candP50 = Quantile( candidate, 0.5 );
+        const double baseP99 = Quantile( baseline,  0.99 );
+        const double candP99 = Quantile( candidate, 0.99 );
+
+        Interval p50Interval, p99Interval;
+        BootstrapDeltas( baseline, candidate, &p50Interval, &p99Interval );
+        double pValue = MannWhitneyPValue( baseline, candidate );
+
+        //Deltas are candidate over baseline: a higher throughput is a positive delta but better
+        const bool significant = pValue < m_alpha;
+        bool       regressed, improved;
+        if( higherIsBetter ) {
+            regressed = ( significant && p50Interval.high < -m_threshold ) ||
+                        ( m_tailThreshold > 0 && p99Interval.high < -m_tailThreshold );
+            improved  = significant && p50Interval.low > m_threshold;
+        }
+        else {
+            regressed = ( significant && p50Interval.low > m_threshold ) ||
+                        ( m_tailThreshold > 0 && p99Interval.low > m_tailThreshold );
+            improved  = significant && p50Interval.high < -m_threshold;
+        }
+
+        char p50Text[ 64 ], p99Text[ 64 ];
+        snprintf( p50Text, sizeof( p50Text ), "%+7.2f [%+7.2f,%+7.2f]", DeltaPercent( baseP50, candP50 ),
+                  p50Interval.low, p50Interval.high );
+        snprintf( p99Text, sizeof( p99Text ), "%+7.2f [%+7.2f,%+7.2f]", DeltaPercent( baseP99, candP99 ),
+                  p99Interval.low, p99Interval.high );
+        printf( "%-48s %10.0f %10.0f %26s %10.0f %10.0f %26s %9.2g  %s\n", name.c_str(),
+                baseP50, candP50, p50Text, baseP99, candP99, p99Text, pValue,
+                regressed ? "REGRESSION" : improved ? "improvement" : "no change" );
+
+        return regressed;
+    }
+
+    //Percentile bootstrap of the median and p99 deltas. Large inputs are first subsampled
+    //to max-samples per side, which only widens the intervals.
+    void BootstrapDeltas( const vector<uint64_t>& baseline, const vector<uint64_t>& candidate,
+                          Interval* p50Interval, Interval* p99Interval )
+    {
+        vector<uint64_t> baseSubset = Subsample( baseline );
+        vector<uint64_t> candSubset = Subsample( candidate );
+        vector<uint64_t> baseResample( baseSubset.size() ), candResample( candSubset.size() );
+        vector<double>   p50Deltas, p99Deltas;
+
+        for( size_t r = 0; r < m_numResamples; ++r ) {
+            Resample( baseSubset, &baseResample );
+            Resample( candSubset, &candResample );
+            p50Deltas.push_back( DeltaPercent( ResampledQuantile( &baseResample, 0.5 ),
+                                               ResampledQuantile( &candResample, 0.5 ) ) );
+            p99Deltas.push_back( DeltaPercent( ResampledQuantile( &baseResample, 0.99 ),
+                                               ResampledQuantile( &candResample, 0.99 ) ) );
+        }
+
+        *p50Interval = PercentileInterval( &p50Deltas );
+        *p99Interval = PercentileInterval( &p99Deltas );
+    }
+
+    vector<uint64_t> Subsample( const vector<uint64_t>& samples )
+    {
+        if( samples.size() <= m_maxSamples )
+            return samples;
+
+        vector<uint64_t> subset( m_maxSamples );
+        for( size_t i = 0; i < m_maxSamples; ++i )
+            subset[ i ] = samples[ m_rng() % samples.size() ];
+        return subset;
+    }
+
+    void Resample( const vector<uint64_t>& samples, vector<uint64_t>* resample )
+    {
+        for( size_t i = 0; i < samples.size(); ++i )
+            (*resample)[ i ] = samples[ m_rng() % samples.size() ];
+    }
+
+    static double ResampledQuantile( vector<uint64_t>* resample, double quantile )
+    {
+        size_t idx = (size_t)( quantile * ( resample->size() - 1 ) );
+        nth_element( resample->begin(), resample->begin() + idx, resample->end() );
+        return (*resample)[ idx ];
+    }
+
+    Interval PercentileInterval( vector<double>* deltas )
+    {
+        Interval interval = { 0, 0 };
+        if( deltas->empty() )
+            return interval;
+
+        sort( deltas->begin(), deltas->end() );
+        double tail    = ( 100.0 - m_confidence ) / 200.0;
+        interval.low   = (*deltas)[ (size_t)( tail * ( deltas->size() - 1 ) ) ];
+        interval.high  = (*deltas)[ (size_t)( ( 1.0 - tail ) * ( deltas->size() - 1 ) ) ];
+        return interval;
+    }
+
+    //Two-sided Mann-Whitney U test, normal approximation with tie correction.
+    //Both inputs must be sorted; ranks are assigned by merging them.
+    static double MannWhitneyPValue( const vector<uint64_t>& baseline, const vector<uint64_t>& candidate )
+    {
+        const double n1 = baseline.size();
+        const double n2 = candidate.size();
+        const double n  = n1 + n2;
+
+        double baseRankSum = 0;
+        double tieSum      = 0;
+        double rank        = 0;
+        size_t i = 0, j = 0;
+        while( i < baseline.size() || j < candidate.size() ) {
+            uint64_t value = ( j == candidate.size() || ( i < baseline.size() && baseline[ i ] <= candidate[ j ] ) ) ?
+                             baseline[ i ] : candidate[ j ];
+
+            double numBase = 0, numCand = 0;
+            while( i < baseline.size() && baseline[ i ] == value ) {
+                numBase++;
+                i++;
+            }
+            while( j < candidate.size() && candidate[ j ] == value ) {
+                numCand++;
+                j++;
+            }
+
+            double ties = numBase + numCand;
+            baseRankSum += numBase * ( rank + ( ties + 1 ) / 2 );
+            tieSum      += ties * ties * ties - ties;
+            rank        += ties;
+        }
+
+        double u        = baseRankSum - n1 * ( n1 + 1 ) / 2;
+        double mean     = n1 * n2 / 2;
+        double variance = n1 * n2 / 12 * ( ( n + 1 ) - tieSum / ( n * ( n - 1 ) ) );
+        if( variance <= 0 )
+            return 1;
+
+        double z = ( u - mean ) / sqrt( variance );
+        return erfc( fabs( z ) / sqrt( 2.0 ) );
+    }
+};
+
+int main( int argc, char *argv[] )
+{
+    map<string, string> options;
+    vector<string>      directories;
+    for( int i = 1; i < argc; ++i ) {
+        string arg = argv[ i ];
+        if( arg == "--help" ) {
+            PrintUsage();
+            return 0;
+        }
+
+        if( arg.compare( 0, 2, "--" ) != 0 ) {
+            directories.push_back( arg );
+            continue;
+        }
+
+        size_t separator = arg.find( '=' );
+        if( separator == string::npos ) {
+            PrintUsage();
+            return 2;
+        }
+        options[ arg.substr( 2, separator - 2 ) ] = arg.substr( separator + 1 );
+    }
+
+    if( directories.size() != 2 ) {
+        PrintUsage();
+        return 2;
+    }
+
+    if( options.count( "max-samples" ) > 0 && strtod( options[ "max-samples" ].c_str(), NULL ) < 1 ) {
+        printf( "Error! --max-samples must be at least 1\n" );
+        return 2;
+    }
+
+    Comparator comparator( options );
+    int numRegressions = comparator.Compare( directories[ 0 ], directories[ 1 ] );
+    if( numRegressions < 0 ) {
+        printf( "Error! No measurement found in both %s and %s\n", directories[ 0 ].c_str(), directories[ 1 ].c_str() );
+        return 2;
+    }
+
+    return numRegressions > 0 ? 1 : 0;
+}
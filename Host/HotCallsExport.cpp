@@ -0,0 +1,153 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//hotcalls_export: converts binary measurement columns (App/MeasurementStore.h) to the
+//CSV files the benchmark used to write, and prints the run metadata they carry.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../App/MeasurementStore.h"
+
+using namespace std;
+
+static void PrintUsage()
+{
+    printf( "Usage: hotcalls_export [--metadata] [--no-csv] <column.hcm | measurements directory> ...\n" );
+    printf( "Writes <column>.csv next to every column. --metadata prints the header of each column.\n" );
+}
+
+static bool EndsWith( const string& value, const string& suffix )
+{
+    return value.size() >= suffix.size() &&
+           value.compare( value.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+static void PrintMetadata( const MeasurementHeader* header )
+{
+    time_t timestamp = header->fields.timestamp;
+
+    printf( "  name        %.*s\n", (int)sizeof( header->fields.name ), header->fields.name );
+    printf( "  rows        %lu (requested %lu)\n", header->fields.numRows, header->fields.iterations );
+    printf( "  created     %s",    ctime( &timestamp ) );
+    printf( "  host        %.*s\n", (int)sizeof( header->fields.host ), header->fields.host );
+    printf( "  cpu         %.*s\n", (int)sizeof( header->fields.cpuModel ), header->fields.cpuModel );
+    printf( "  tsc         %lu Hz\n", header->fields.tscFrequencyHz );
+    printf( "  sgx mode    %.*s\n", (int)sizeof( header->fields.sgxMode ), header->fields.sgxMode );
+    printf( "  build       %.*s\n", (int)sizeof( header->fields.buildFlags ), header->fields.buildFlags );
+    if( header->fields.extra[ 0 ] != '\0' )
+        printf( "  extra:\n%.*s", (int)sizeof( header->fields.extra ), header->fields.extra );
+}
+
+static bool ExportColumn( const string& path, bool printMetadata, bool writeCsv )
+{
+    MeasurementColumn column;
+    if( ! MeasurementColumn_open( &column, path.c_str() ) ) {
+        printf( "Error! %s is not a measurement column\n", path.c_str() );
+        return false;
+    }
+
+    bool ok = true;
+    printf( "%s\n", path.c_str() );
+    if( printMetadata )
+        PrintMetadata( column.header );
+
+    if( writeCsv ) {
+        string csvPath = path.substr( 0, path.size() - strlen( MEASUREMENT_STORE_EXTENSION ) ) + ".csv";
+        ok = MeasurementColumn_exportCsv( &column, csvPath.c_str() );
+        if( ! ok )
+            printf( "Error! Cannot write %s\n", csvPath.c_str() );
+    }
+
+    MeasurementColumn_release( &column );
+    return ok;
+}
+
+//Columns of a measurements directory, sorted by name
+static vector<string> ListColumns( const string& directory )
+{
+    vector<string> columns;
+    DIR* dir = opendir( directory.c_str() );
+    if( dir == NULL )
+        return columns;
+
+    struct dirent* entry;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        if( EndsWith( entry->d_name, MEASUREMENT_STORE_EXTENSION ) )
+            columns.push_back( directory + "/" + entry->d_name );
+    }
+    closedir( dir );
+
+    sort( columns.begin(), columns.end() );
+    return columns;
+}
+
+int main( int argc, char *argv[] )
+{
+    bool           printMetadata = false;
+    bool           writeCsv      = true;
+    vector<string> paths;
+    for( int i = 1; i < argc; ++i ) {
+        string arg = argv[ i ];
+        if( arg == "--metadata" )
+            printMetadata = true;
+        else if( arg == "--no-csv" )
+            writeCsv = false;
+        else if( arg.compare( 0, 2, "--" ) == 0 ) {
+            PrintUsage();
+            return arg == "--help" ? 0 : 2;
+        }
+        else
+            paths.push_back( arg );
+    }
+
+    if( paths.empty() ) {
+        PrintUsage();
+        return 2;
+    }
+
+    int numFailures = 0;
+    for( size_t i = 0; i < paths.size(); ++i ) {
+        struct stat st;
+        if( stat( paths[ i ].c_str(), &st ) != 0 ) {
+            printf( "Error! %s does not exist\n", paths[ i ].c_str() );
+            numFailures++;
+            continue;
+        }
+
+        vector<string> columns;
+        if( S_ISDIR( st.st_mode ) )
+            columns = ListColumns( paths[ i ] );
+        else
+            columns.push_back( paths[ i ] );
+
+        for( size_t c = 0; c < columns.size(); ++c ) {
+            if( ! ExportColumn( columns[ c ], printMetadata, writeCsv ) )
+                numFailures++;
+        }
+    }
+
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "HotCallsHost.h"
+
+typedef struct {
+    HotCall*        hotCall;
+    HotCallTable*   callTable;
+} ResponderArgs;
+
+static void* ResponderThread( void* argsAsVoidP )
+{
+    ResponderArgs args = *(ResponderArgs*)argsAsVoidP;
+    free( argsAsVoidP );
+
+    HotCall_waitForCall( args.hotCall, args.callTable );
+
+    return NULL;
+}
+
+int HotCallResponder_start( HotCall* hotCall, HotCallTable* callTable, int cpu )
+{
+    ResponderArgs* args = (ResponderArgs*)malloc( sizeof( ResponderArgs ) );
+    if( args == NULL )
+        return ENOMEM;
+    args->hotCall   = hotCall;
+    args->callTable = callTable;
+
+    int ret = CreatePinnedThread( &hotCall->responderThread, cpu, ResponderThread, args );
+    if( ret != 0 )
+        free( args );
+
+    return ret;
+}
+
+void HotCallResponder_stop( HotCall* hotCall )
+{
+    StopResponder( hotCall );
+    pthread_join( hotCall->responderThread, NULL );
+}
@@ -0,0 +1,47 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//libhotcalls: the HotCall channel as a cross-thread call mechanism between plain
+//threads, without an enclave or the SGX SDK. The protocol itself is the header-only
+//include/hot_calls.h; this adds responder thread management and the shared memory
+//allocator from App/SharedMemory.h.
+
+#ifndef _HOT_CALLS_HOST_H_
+#define _HOT_CALLS_HOST_H_
+
+#include <pthread.h>
+
+#include "../include/hot_calls.h"
+#include "../App/SharedMemory.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+//Spawns a thread serving hotCall from callTable, pinned to cpu (or unpinned for cpu < 0).
+//callTable must outlive the responder. Returns 0, ENOMEM or a pthread_create error.
+int  HotCallResponder_start( HotCall* hotCall, HotCallTable* callTable, int cpu );
+
+//Stops the responder of hotCall and waits for its thread to exit
+void HotCallResponder_stop( HotCall* hotCall );
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* !_HOT_CALLS_HOST_H_ */
@@ -0,0 +1,53 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+#include "PeerEnclave_t.h"
+#include "sgx_trts.h"
+
+#include "../include/common.h"
+
+
+void PeerMessageEcall( void* data )
+{
+	//The message is untrusted: it must not point the response write into this enclave
+	PeerMessage *message = (PeerMessage*)data;
+	if( ! sgx_is_outside_enclave( message, sizeof( PeerMessage ) ) )
+		return;
+
+	uint64_t request  = __atomic_load_n( &message->request, __ATOMIC_RELAXED );
+	message->response = PeerMessage_respond( request );
+}
+
+void EcallStartPeerResponder( HotCall* peerChannel )
+{
+	//peerChannel is untrusted memory shared with the main enclave; messages on it are not
+	//protected, a real pair seals them (include/hot_calls_sealed.h)
+	void (*callbacks[1])(void*);
+    callbacks[ PEER_MESSAGE_CALL_ID ] = PeerMessageEcall;
+
+    HotCallTable callTable;
+    callTable.numEntries = 1;
+    callTable.callbacks  = callbacks;
+
+    HotCall_waitForCall( peerChannel, &callTable );
+}
+
+void EcallPeerHandleMessage( PeerMessage* message )
+{
+	PeerMessageEcall( message );
+}
@@ -30,5 +30,143 @@ typedef struct {
     uint64_t  counter;
 } OcallParams;
 
+//Call IDs served by the priority lanes responder (EcallStartLaneResponder)
+enum {
+    LANE_CRITICAL_CALL_ID   = 0,
+    LANE_BULK_CALL_ID       = 1,
+};
+
+typedef struct {
+    uint8_t*  buffer;
+    uint64_t  size;
+    uint64_t  checksum;
+} BulkCallParams;
+
+//Call IDs served by the trusted arena responder (EcallStartArenaResponder)
+enum {
+    ALLOC_MALLOC_CALL_ID    = 0,
+    ALLOC_ARENA_CALL_ID     = 1,
+};
+
+typedef struct {
+    uint32_t  numAllocations;
+    uint32_t  maxSize;
+    uint64_t  checksum;
+} AllocationWorkParams;
+
+//Call IDs served by the sealed payload responder (EcallStartSealedResponder). Both take a
+//HotSealedBatch; every slot starts with a 64-bit counter the enclave increments.
+enum {
+    SEALED_PLAIN_CALL_ID    = 0,    //payload in plaintext, processed in place
+    SEALED_BATCH_CALL_ID    = 1,    //payload sealed, see include/hot_calls_sealed.h
+};
+
+//Operations of the in-enclave key-value store (Enclave/KvStore.h), served by EcallStartKvResponder
+//and EcallKvExecute
+enum {
+    KV_OP_READ              = 0,
+    KV_OP_UPDATE            = 1,
+    KV_OP_INSERT            = 2,
+    KV_OP_SCAN              = 3,    //scanLength consecutive keys starting at key
+    KV_OP_READ_MODIFY_WRITE = 4,    //read, then increment the counter in the first 8 bytes
+};
+
+enum {
+    KV_STATUS_OK            = 0,
+    KV_STATUS_NOT_FOUND     = 1,
+    KV_STATUS_FULL          = 2,
+    KV_STATUS_NOT_READY     = 3,
+    KV_STATUS_INVALID       = 4,    //the request or its value buffer is not outside the enclave
+};
+
+typedef struct {
+    uint32_t  op;
+    uint32_t  scanLength;
+    uint64_t  key;
+    uint8_t*  value;        //valueSize bytes: written from by update/insert, read into by the others
+    uint32_t  numRecords;   //records found
+    int32_t   status;
+} KvRequest;
+
+//Record contents written by the loader and the benchmark, so reads can be checked. The first
+//8 bytes are the read-modify-write counter.
+#define KV_VALUE_COUNTER_SIZE   8
+
+static inline void KvValue_fill( uint8_t* value, uint32_t valueSize, uint64_t key )
+{
+    uint32_t i;
+    for( i = KV_VALUE_COUNTER_SIZE; i < valueSize; ++i )
+        value[ i ] = (uint8_t)( key + i );
+}
+
+static inline bool KvValue_check( const uint8_t* value, uint32_t valueSize, uint64_t key )
+{
+    uint32_t i;
+    for( i = KV_VALUE_COUNTER_SIZE; i < valueSize; ++i ) {
+        if( value[ i ] != (uint8_t)( key + i ) )
+            return false;
+    }
+    return true;
+}
+
+//Messages from the main enclave to the peer enclave (PeerEnclave/), served by the peer's
+//EcallStartPeerResponder and EcallPeerHandleMessage
+#define PEER_MESSAGE_CALL_ID    0
+
+typedef struct {
+    uint64_t  request;
+    uint64_t  response;     //written by the peer
+} PeerMessage;
+
+static inline uint64_t PeerMessage_respond( uint64_t request )
+{
+    return request * 2 + 1;
+}
+
+
+//Test data of the streaming benchmark (include/hot_stream.h): the stream is a sequence of
+//64-bit words, word k holding k * STREAM_DATA_MULTIPLIER. Offsets and lengths are multiples of 8.
+#define STREAM_DATA_MULTIPLIER  0x9E3779B97F4A7C15ULL
+
+static inline void StreamData_fill( uint8_t* buffer, uint64_t length, uint64_t offset )
+{
+    uint64_t* words    = (uint64_t*)buffer;
+    uint64_t  numWords = length / 8;
+    uint64_t  first    = offset / 8;
+    uint64_t  i;
+    for( i = 0; i < numWords; ++i )
+        words[ i ] = ( first + i ) * STREAM_DATA_MULTIPLIER;
+}
+
+static inline uint64_t StreamData_checksum( const uint8_t* buffer, uint64_t length )
+{
+    const uint64_t* words    = (const uint64_t*)buffer;
+    uint64_t        numWords = length / 8;
+    uint64_t        checksum = 0;
+    uint64_t        i;
+    for( i = 0; i < numWords; ++i )
+        checksum += words[ i ];
+    return checksum;
+}
+
+//Checksum of the first numBytes of the stream
+static inline uint64_t StreamData_expectedChecksum( uint64_t numBytes )
+{
+    uint64_t numWords = numBytes / 8;
+    uint64_t sumOfIndices = ( numWords % 2 == 0 ) ? ( numWords / 2 ) * ( numWords - 1 ) : numWords * ( ( numWords - 1 ) / 2 );
+    return sumOfIndices * STREAM_DATA_MULTIPLIER;
+}
+
+
+//Calls of the trace replay driver (App/HotCallTrace.h), served by EcallStartReplayResponder.
+//A recorded callID is replayed as callID % REPLAY_NUM_STUBS; every stub sums the payload bytes.
+#define REPLAY_NUM_STUBS        64
+
+typedef struct {
+    const uint8_t*  payload;
+    uint32_t        payloadSize;
+    uint64_t        checksum;       //written by the stub
+    uint64_t        numCalls;       //incremented by the stub
+} ReplayCall;
 
 #endif
\ No newline at end of file
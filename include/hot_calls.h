@@ -28,8 +28,11 @@
 
 
 // #include <stdlib.h>
-#include <sgx_spinlock.h>
 #include <stdbool.h>
+#include "hot_spinlock.h"
+#ifdef HOTCALL_TRACE
+#include "hot_calls_trace.h"
+#endif
 // #include "utils.h"
 
 
@@ -39,7 +42,7 @@ typedef unsigned long int pthread_t;
 
 typedef struct {
     pthread_t       responderThread;
-    sgx_spinlock_t  spinlock;
+    HotSpinlock     spinlock;
     void*           data;
     uint16_t        callID;
     bool            keepPolling;
@@ -54,12 +57,27 @@ typedef struct
     void (**callbacks)(void*);
 } HotCallTable;
 
-#define HOTCALL_INITIALIZER  {0, SGX_SPINLOCK_INITIALIZER, NULL, 0, true, false, false, false }
+#define HOTCALL_INITIALIZER  {0, HOTSPIN_INITIALIZER, NULL, 0, true, false, false, false }
+
+//A batch is posted as a single call with this callID: the caller publishes the whole vector
+//with one request, the responder runs the entries in order and completes them with one isDone
+#define HOTCALL_BATCH_CALL_ID   0xFFFF
+
+typedef struct {
+    uint16_t        callID;
+    void*           data;
+} HotCallBatchEntry;
+
+typedef struct {
+    uint32_t            numEntries;
+    uint32_t            numRejected;    //entries with an unknown callID, set by the responder
+    HotCallBatchEntry*  entries;
+} HotCallBatch;
 
 static void HotCall_init( HotCall* hotCall )
 {
     hotCall->responderThread    = 0;
-    hotCall->spinlock           = SGX_SPINLOCK_INITIALIZER;
+    HotSpin_init( &hotCall->spinlock );
     hotCall->data               = NULL; 
     hotCall->callID             = 0;
     hotCall->keepPolling        = true;
@@ -68,6 +86,15 @@ static void HotCall_init( HotCall* hotCall )
     hotCall->busy               = false;
 }
 
+//Enclave builds (-nostdinc) cannot reach the compiler's intrinsics, host builds must not redefine them
+#if defined( __has_include )
+#if __has_include( <xmmintrin.h> )
+#include <xmmintrin.h>
+#define HOTCALLS_HAVE_XMMINTRIN
+#endif
+#endif
+
+#ifndef HOTCALLS_HAVE_XMMINTRIN
 static inline void _mm_pause(void) __attribute__((always_inline));
 static inline void _mm_pause(void)
 {
@@ -75,27 +102,70 @@ static inline void _mm_pause(void)
         "pause"
     );
 }
+#endif
 
 
-static inline int HotCall_requestCall( HotCall* hotCall, uint16_t callID, void *data )
+//Runs one posted call on the responder side, expanding batches
+static inline void HotCall_dispatch( HotCallTable* callTable, uint16_t callID, void *data )
+{
+    uint32_t i;
+
+    if( callID < callTable->numEntries ) {
+        callTable->callbacks[ callID ]( data );
+        return;
+    }
+
+    if( callID != HOTCALL_BATCH_CALL_ID )
+        return;
+
+    //The batch is in untrusted memory and may change under us: every field is loaded exactly
+    //once (atomic loads, which the compiler cannot repeat) before it is checked and used
+    HotCallBatch*      batch       = (HotCallBatch*)data;
+    uint32_t           numEntries  = __atomic_load_n( &batch->numEntries, __ATOMIC_RELAXED );
+    HotCallBatchEntry* entries     = __atomic_load_n( &batch->entries,    __ATOMIC_RELAXED );
+    uint32_t           numRejected = 0;
+    for( i = 0; i < numEntries; ++i ) {
+        uint16_t entryCallID = __atomic_load_n( &entries[ i ].callID, __ATOMIC_RELAXED );
+        void*    entryData   = __atomic_load_n( &entries[ i ].data,   __ATOMIC_RELAXED );
+        if( entryCallID < callTable->numEntries )
+            callTable->callbacks[ entryCallID ]( entryData );
+        else
+            numRejected++;
+    }
+    //Rejection accounting for the caller
+    batch->numRejected = numRejected;
+}
+
+//Posts a call without waiting for it. Returns the number of retries, or -1 if the
+//channel stayed busy. A posted call must be completed with HotCall_waitForResult.
+//payloadSize is only recorded by request tracing (include/hot_calls_trace.h).
+static inline int HotCall_postCallSized( HotCall* hotCall, uint16_t callID, void *data, uint32_t payloadSize )
 {
     int i = 0;
+    HotSpinNode lockNode;
     const uint32_t MAX_RETRIES = 10;
     uint32_t numRetries = 0;
+#ifndef HOTCALL_TRACE
+    (void)payloadSize;
+#endif
     //REquest call
     while( true ) {
-        sgx_spin_lock( &hotCall->spinlock );
+        HotSpin_lock( &hotCall->spinlock, &lockNode );
         if( hotCall->busy == false ) {
             hotCall->busy        = true;
             hotCall->isDone      = false;
             hotCall->runFunction = true;
             hotCall->callID      = callID;
             hotCall->data        = data;
-            sgx_spin_unlock( &hotCall->spinlock );
+            HotSpin_unlock( &hotCall->spinlock, &lockNode );
+#ifdef HOTCALL_TRACE
+            //Only calls that were posted: callers retry rejected attempts
+            HotCallTrace_request( callID, payloadSize );
+#endif
             break;
         }
         //else:
-        sgx_spin_unlock( &hotCall->spinlock );
+        HotSpin_unlock( &hotCall->spinlock, &lockNode );
 
         numRetries++;
         if( numRetries > MAX_RETRIES )
@@ -105,34 +175,69 @@ static inline int HotCall_requestCall( HotCall* hotCall, uint16_t callID, void *
             _mm_pause();
     }
 
+    return numRetries;
+}
+
+static inline int HotCall_postCall( HotCall* hotCall, uint16_t callID, void *data )
+{
+    return HotCall_postCallSized( hotCall, callID, data, 0 );
+}
+
+static inline void HotCall_waitForResult( HotCall* hotCall )
+{
+    int i = 0;
+    HotSpinNode lockNode;
+
     //wait for answer
     while( true )
     {
-        sgx_spin_lock( &hotCall->spinlock );
+        HotSpin_lock( &hotCall->spinlock, &lockNode );
         if( hotCall->isDone == true ){
             hotCall->busy = false;
-            sgx_spin_unlock( &hotCall->spinlock );
+            HotSpin_unlock( &hotCall->spinlock, &lockNode );
             break;
         }
 
-        sgx_spin_unlock( &hotCall->spinlock );
+        HotSpin_unlock( &hotCall->spinlock, &lockNode );
         for( i = 0; i<3; ++i)
             _mm_pause();
     }
+}
+
+static inline int HotCall_requestCallSized( HotCall* hotCall, uint16_t callID, void *data, uint32_t payloadSize )
+{
+    int numRetries = HotCall_postCallSized( hotCall, callID, data, payloadSize );
+    if( numRetries < 0 )
+        return numRetries;
+
+    HotCall_waitForResult( hotCall );
 
     return numRetries;
 }
 
+static inline int HotCall_requestCall( HotCall* hotCall, uint16_t callID, void *data )
+{
+    return HotCall_requestCallSized( hotCall, callID, data, 0 );
+}
+
+//Posts all entries of batch with one request and returns once every entry has run.
+//Same return value as HotCall_requestCall; batch->numRejected counts unknown callIDs.
+static inline int HotCall_requestBatch( HotCall* hotCall, HotCallBatch* batch )
+{
+    return HotCall_requestCall( hotCall, HOTCALL_BATCH_CALL_ID, batch );
+}
+
 static inline void HotCall_waitForCall( HotCall *hotCall, HotCallTable* callTable )  __attribute__((always_inline));
 static inline void HotCall_waitForCall( HotCall *hotCall, HotCallTable* callTable ) 
 {
     static int i;
+    HotSpinNode lockNode;
     // volatile void *data;
     while( true )
     {
-        sgx_spin_lock( &hotCall->spinlock );
+        HotSpin_lock( &hotCall->spinlock, &lockNode );
         if( hotCall->keepPolling != true ) {
-            sgx_spin_unlock( &hotCall->spinlock );
+            HotSpin_unlock( &hotCall->spinlock, &lockNode );
             break;
         }
 
@@ -140,25 +245,18 @@ static inline void HotCall_waitForCall( HotCall *hotCall, HotCallTable* callTabl
         {
             volatile uint16_t callID = hotCall->callID;
             void *data = hotCall->data;
-            sgx_spin_unlock( &hotCall->spinlock );
-            if( callID < callTable->numEntries ) {
-                // printf( "Calling callback %d\n", callID );
-                callTable->callbacks[ callID ]( data );
-            }
-            else {
-                // printf( "Invalid callID\n" );
-                // exit(42);
-            }
+            HotSpin_unlock( &hotCall->spinlock, &lockNode );
+            HotCall_dispatch( callTable, callID, data );
             // DoWork( hotCall->data );
             // data = (int*)hotCall->data;
             // printf( "Enclave: Data is at %p\n", data );
             // *data += 1;
-            sgx_spin_lock( &hotCall->spinlock );
+            HotSpin_lock( &hotCall->spinlock, &lockNode );
             hotCall->isDone      = true;
             hotCall->runFunction = false;
         }
         
-        sgx_spin_unlock( &hotCall->spinlock );
+        HotSpin_unlock( &hotCall->spinlock, &lockNode );
         for( i = 0; i<3; ++i)
             _mm_pause();
         
@@ -171,9 +269,10 @@ static inline void HotCall_waitForCall( HotCall *hotCall, HotCallTable* callTabl
 static inline void StopResponder( HotCall *hotCall );
 static inline void StopResponder( HotCall *hotCall )
 {
-    sgx_spin_lock( &hotCall->spinlock );
+    HotSpinNode lockNode;
+    HotSpin_lock( &hotCall->spinlock, &lockNode );
     hotCall->keepPolling = false;
-    sgx_spin_unlock( &hotCall->spinlock );
+    HotSpin_unlock( &hotCall->spinlock, &lockNode );
 }
 
 
@@ -0,0 +1,190 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Priority lanes on top of the basic HotCall channel.
+//Every lane is a regular HotCall, so callers of the same lane still compete for
+//its busy slot, but callers of different lanes never do. A single responder
+//polls all lanes and always serves the highest priority pending lane (lane 0 is
+//the most urgent). A lower lane that was passed over starvationLimit times in a
+//row is served next regardless of its priority.
+
+#ifndef __HOT_CALLS_LANES_H
+#define __HOT_CALLS_LANES_H
+
+#include "hot_calls.h"
+
+#define HOTCALL_MAX_LANES                   4
+#define HOTCALL_DEFAULT_STARVATION_LIMIT    16
+#define HOTCALL_LANE_ERROR_INVALID          -2  //No such lane; unlike a busy lane, retrying does not help
+
+typedef struct {
+    //Updated by callers (atomically, several callers may share a lane)
+    uint64_t numRequests;
+    uint64_t numRetries;
+    uint64_t numRejected;
+    //Updated by the responder only
+    uint64_t numServed;
+    uint64_t numStarvationGrants;
+} HotLaneCounters;
+
+typedef struct {
+    HotCall         hotCall;
+    uint32_t        numSkipped; //times passed over by a higher lane while pending
+    HotLaneCounters counters;
+} __attribute__((aligned(64))) HotLane;
+
+typedef struct {
+    pthread_t       responderThread;
+    uint16_t        numLanes;
+    uint32_t        starvationLimit;
+    bool            keepPolling;
+    HotLane         lanes[ HOTCALL_MAX_LANES ];
+} HotLaneChannel;
+
+static void HotLaneChannel_init( HotLaneChannel* channel, uint16_t numLanes, uint32_t starvationLimit )
+{
+    uint16_t lane;
+
+    if( numLanes > HOTCALL_MAX_LANES )
+        numLanes = HOTCALL_MAX_LANES;
+
+    channel->responderThread = 0;
+    channel->numLanes        = numLanes;
+    channel->starvationLimit = starvationLimit;
+    channel->keepPolling     = true;
+    for( lane = 0; lane < HOTCALL_MAX_LANES; ++lane ) {
+        HotCall_init( &channel->lanes[ lane ].hotCall );
+        channel->lanes[ lane ].numSkipped                    = 0;
+        channel->lanes[ lane ].counters.numRequests          = 0;
+        channel->lanes[ lane ].counters.numRetries           = 0;
+        channel->lanes[ lane ].counters.numRejected          = 0;
+        channel->lanes[ lane ].counters.numServed            = 0;
+        channel->lanes[ lane ].counters.numStarvationGrants  = 0;
+    }
+}
+
+//Returns the number of retries, or -1 if the lane stayed busy (same as HotCall_requestCall),
+//or HOTCALL_LANE_ERROR_INVALID if lane is not below numLanes
+static inline int HotLaneChannel_requestCall( HotLaneChannel* channel, uint16_t lane, uint16_t callID, void *data )
+{
+    if( lane >= channel->numLanes )
+        return HOTCALL_LANE_ERROR_INVALID;
+
+    HotLane *hotLane = &channel->lanes[ lane ];
+    int numRetries   = HotCall_requestCall( &hotLane->hotCall, callID, data );
+
+    if( numRetries < 0 ) {
+        __sync_fetch_and_add( &hotLane->counters.numRejected, 1 );
+        return numRetries;
+    }
+
+    __sync_fetch_and_add( &hotLane->counters.numRequests, 1 );
+    if( numRetries > 0 )
+        __sync_fetch_and_add( &hotLane->counters.numRetries, numRetries );
+
+    return numRetries;
+}
+
+//Picks the lane to serve next, or -1 when no lane is pending.
+//runFunction is only peeked at here; HotLaneChannel_serveLane re-checks it under the lane's lock.
+static inline int HotLaneChannel_pickLane( HotLaneChannel* channel )
+{
+    int      lane;
+    int      chosen  = -1;
+    bool     starved = false;
+
+    for( lane = 0; lane < channel->numLanes; ++lane ) {
+        HotLane *hotLane = &channel->lanes[ lane ];
+        if( *(volatile bool*)&hotLane->hotCall.runFunction != true )
+            continue;
+
+        if( chosen < 0 ) {
+            chosen = lane;
+        }
+        else if( ! starved && hotLane->numSkipped >= channel->starvationLimit ) {
+            chosen  = lane;
+            starved = true;
+        }
+    }
+
+    if( chosen < 0 )
+        return -1;
+
+    //Every pending lane that lost this round is one step closer to starvation
+    for( lane = 0; lane < channel->numLanes; ++lane ) {
+        HotLane *hotLane = &channel->lanes[ lane ];
+        if( lane != chosen && *(volatile bool*)&hotLane->hotCall.runFunction == true )
+            hotLane->numSkipped++;
+    }
+
+    channel->lanes[ chosen ].numSkipped = 0;
+    if( starved )
+        channel->lanes[ chosen ].counters.numStarvationGrants++;
+
+    return chosen;
+}
+
+static inline void HotLaneChannel_serveLane( HotLaneChannel* channel, int lane, HotCallTable* callTable )
+{
+    HotCall *hotCall = &channel->lanes[ lane ].hotCall;
+    HotSpinNode lockNode;
+
+    HotSpin_lock( &hotCall->spinlock, &lockNode );
+    if( hotCall->runFunction != true ) {
+        HotSpin_unlock( &hotCall->spinlock, &lockNode );
+        return;
+    }
+
+    uint16_t callID = hotCall->callID;
+    void *data      = hotCall->data;
+    HotSpin_unlock( &hotCall->spinlock, &lockNode );
+
+    HotCall_dispatch( callTable, callID, data );
+
+    HotSpin_lock( &hotCall->spinlock, &lockNode );
+    hotCall->isDone      = true;
+    hotCall->runFunction = false;
+    HotSpin_unlock( &hotCall->spinlock, &lockNode );
+
+    channel->lanes[ lane ].counters.numServed++;
+}
+
+static inline void HotLaneChannel_waitForCalls( HotLaneChannel* channel, HotCallTable* callTable )
+{
+    int i;
+    int lane;
+
+    while( *(volatile bool*)&channel->keepPolling == true )
+    {
+        lane = HotLaneChannel_pickLane( channel );
+        if( lane >= 0 ) {
+            HotLaneChannel_serveLane( channel, lane, callTable );
+            continue;
+        }
+
+        for( i = 0; i<3; ++i)
+            _mm_pause();
+    }
+}
+
+static inline void HotLaneChannel_stop( HotLaneChannel* channel )
+{
+    *(volatile bool*)&channel->keepPolling = false;
+}
+
+#endif
@@ -0,0 +1,179 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Multiplexed responder: one thread serves up to HOTCALL_MUX_MAX_CHANNELS HotCall channels.
+//A caller posts on its own channel as usual, then sets the channel's bit in a readiness
+//bitmap. The responder ORs the bitmap words together (one cache line, vectorizable) to
+//check for work, claims a whole word with an atomic exchange and serves its set bits in
+//order. Channels register and unregister at runtime; a slot may only be removed while
+//its channel has no call outstanding.
+//The channel table is in untrusted memory. An enclave responder passes a check
+//(sgx_is_outside_enclave) that every channel pointer must pass before it is locked or written.
+
+#ifndef __HOT_CALLS_MUX_H
+#define __HOT_CALLS_MUX_H
+
+#include "hot_calls.h"
+
+#define HOTCALL_MUX_MAX_CHANNELS    256
+#define HOTCALL_MUX_NUM_WORDS       ( HOTCALL_MUX_MAX_CHANNELS / 64 )
+
+//Same signature as sgx_is_outside_enclave: nonzero if size bytes at address may be used
+typedef int (*HotCallMuxChannelCheck)( const void* address, size_t size );
+
+typedef struct {
+    uint64_t        readyBits[ HOTCALL_MUX_NUM_WORDS ]  __attribute__((aligned(64)));
+    uint64_t        activeBits[ HOTCALL_MUX_NUM_WORDS ] __attribute__((aligned(64)));
+    HotCall*        channels[ HOTCALL_MUX_MAX_CHANNELS ];
+    pthread_t       responderThread;
+    bool            keepPolling;
+    uint64_t        numServed;
+} HotCallMux;
+
+static inline void HotCallMux_init( HotCallMux* mux )
+{
+    int i;
+
+    for( i = 0; i < HOTCALL_MUX_NUM_WORDS; ++i ) {
+        mux->readyBits[ i ]  = 0;
+        mux->activeBits[ i ] = 0;
+    }
+    for( i = 0; i < HOTCALL_MUX_MAX_CHANNELS; ++i )
+        mux->channels[ i ] = NULL;
+
+    mux->responderThread = 0;
+    mux->keepPolling     = true;
+    mux->numServed       = 0;
+}
+
+//Registers hotCall and returns its slot, or -1 if every slot is taken
+static inline int HotCallMux_addChannel( HotCallMux* mux, HotCall* hotCall )
+{
+    int word;
+
+    for( word = 0; word < HOTCALL_MUX_NUM_WORDS; ++word ) {
+        uint64_t active = __atomic_load_n( &mux->activeBits[ word ], __ATOMIC_RELAXED );
+        while( ~active != 0 ) {
+            int      bit     = __builtin_ctzll( ~active );
+            uint64_t claimed = active | ( 1ULL << bit );
+            if( __atomic_compare_exchange_n( &mux->activeBits[ word ], &active, claimed, false,
+                                             __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) ) {
+                int slot = word * 64 + bit;
+                __atomic_store_n( &mux->channels[ slot ], hotCall, __ATOMIC_RELEASE );
+                return slot;
+            }
+            //active was reloaded by the failed exchange
+        }
+    }
+
+    return -1;
+}
+
+//The channel in slot must not have a call outstanding
+static inline void HotCallMux_removeChannel( HotCallMux* mux, int slot )
+{
+    __atomic_store_n( &mux->channels[ slot ], (HotCall*)NULL, __ATOMIC_RELEASE );
+    __atomic_fetch_and( &mux->activeBits[ slot / 64 ], ~( 1ULL << ( slot % 64 ) ), __ATOMIC_RELEASE );
+}
+
+//Same return value as HotCall_requestCall
+static inline int HotCallMux_requestCall( HotCallMux* mux, int slot, uint16_t callID, void *data )
+{
+    HotCall* hotCall    = mux->channels[ slot ];
+    int      numRetries = HotCall_postCall( hotCall, callID, data );
+    if( numRetries < 0 )
+        return numRetries;
+
+    __atomic_fetch_or( &mux->readyBits[ slot / 64 ], 1ULL << ( slot % 64 ), __ATOMIC_RELEASE );
+    HotCall_waitForResult( hotCall );
+
+    return numRetries;
+}
+
+static inline void HotCallMux_serveChannel( HotCallMux* mux, int slot, HotCallTable* callTable,
+                                            HotCallMuxChannelCheck channelCheck )
+{
+    HotCall *hotCall = __atomic_load_n( &mux->channels[ slot ], __ATOMIC_ACQUIRE );
+    HotSpinNode lockNode;
+
+    if( hotCall == NULL )
+        return;
+    if( channelCheck != NULL && ! channelCheck( hotCall, sizeof( HotCall ) ) )
+        return;
+
+    HotSpin_lock( &hotCall->spinlock, &lockNode );
+    if( hotCall->runFunction != true ) {
+        HotSpin_unlock( &hotCall->spinlock, &lockNode );
+        return;
+    }
+
+    uint16_t callID = hotCall->callID;
+    void *data      = hotCall->data;
+    HotSpin_unlock( &hotCall->spinlock, &lockNode );
+
+    HotCall_dispatch( callTable, callID, data );
+
+    HotSpin_lock( &hotCall->spinlock, &lockNode );
+    hotCall->isDone      = true;
+    hotCall->runFunction = false;
+    HotSpin_unlock( &hotCall->spinlock, &lockNode );
+
+    mux->numServed++;
+}
+
+//channelCheck may be NULL when the channels are trusted, as in the app
+static inline void HotCallMux_waitForCalls( HotCallMux* mux, HotCallTable* callTable,
+                                            HotCallMuxChannelCheck channelCheck )
+{
+    int i;
+    int word;
+
+    while( __atomic_load_n( &mux->keepPolling, __ATOMIC_RELAXED ) ) {
+        uint64_t pending = 0;
+
+        //Plain loads so the OR over the bitmap vectorizes; the barrier makes every pass reload it
+        __asm__ __volatile__( "" ::: "memory" );
+        for( word = 0; word < HOTCALL_MUX_NUM_WORDS; ++word )
+            pending |= mux->readyBits[ word ];
+
+        if( pending == 0 ) {
+            for( i = 0; i<3; ++i)
+                _mm_pause();
+            continue;
+        }
+
+        for( word = 0; word < HOTCALL_MUX_NUM_WORDS; ++word ) {
+            if( mux->readyBits[ word ] == 0 )
+                continue;
+
+            uint64_t ready = __atomic_exchange_n( &mux->readyBits[ word ], 0, __ATOMIC_ACQUIRE );
+            while( ready != 0 ) {
+                int bit = __builtin_ctzll( ready );
+                ready  &= ready - 1;
+                HotCallMux_serveChannel( mux, word * 64 + bit, callTable, channelCheck );
+            }
+        }
+    }
+}
+
+static inline void HotCallMux_stop( HotCallMux* mux )
+{
+    __atomic_store_n( &mux->keepPolling, false, __ATOMIC_RELEASE );
+}
+
+#endif
@@ -0,0 +1,78 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Sealed payloads: AES-128-GCM protected batches of fixed size slots, for hot calls whose
+//data must not sit in untrusted memory in plaintext. Each side of a channel keeps a
+//HotSealedSession: the session key and a sequence counter. The caller seals a whole batch
+//with one GCM pass under sequence N, the responder accepts it only if N is larger than any
+//sequence it accepted before, and seals its reply in place under the same N with the
+//response direction bit set, so no IV is ever used twice with one key.
+//The batch header is authenticated as additional data.
+//Untrusted side: App/GcmCipher.h. Enclave side: Enclave/SealedChannel.h.
+
+#ifndef __HOT_CALLS_SEALED_H
+#define __HOT_CALLS_SEALED_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOTCALL_SEALED_KEY_SIZE         16
+#define HOTCALL_SEALED_IV_SIZE          12
+#define HOTCALL_SEALED_MAC_SIZE         16
+#define HOTCALL_SEALED_AAD_SIZE         16
+
+#define HOTCALL_SEALED_REQUEST          0
+#define HOTCALL_SEALED_RESPONSE         0x80000000
+
+//Status of a batch, set by the responder
+#define HOTCALL_SEALED_OK               0
+#define HOTCALL_SEALED_ERROR_MAC        1   //Tampered with, or sealed under another key
+#define HOTCALL_SEALED_ERROR_REPLAY     2   //Sequence not larger than the last accepted one
+#define HOTCALL_SEALED_ERROR_SIZE       3   //Larger than the responder's buffers, or not in untrusted memory
+
+typedef struct {
+    uint32_t    numSlots;
+    uint32_t    slotSize;
+    uint64_t    sequence;
+    uint8_t     mac[ HOTCALL_SEALED_MAC_SIZE ];
+    uint8_t*    payload;        //numSlots * slotSize bytes: ciphertext, or plaintext for unsealed calls
+    int32_t     status;
+} HotSealedBatch;
+
+typedef struct {
+    uint8_t     key[ HOTCALL_SEALED_KEY_SIZE ];
+    uint32_t    channelID;      //below HOTCALL_SEALED_RESPONSE
+    uint64_t    sequence;       //caller: last sequence sent; responder: last sequence accepted
+} HotSealedSession;
+
+static inline void HotSealed_makeIv( uint8_t iv[ HOTCALL_SEALED_IV_SIZE ], uint32_t channelID,
+                                     uint32_t direction, uint64_t sequence )
+{
+    uint32_t prefix = channelID | direction;
+    memcpy( iv,     &prefix,   sizeof( prefix ) );
+    memcpy( iv + 4, &sequence, sizeof( sequence ) );
+}
+
+static inline void HotSealed_makeAad( uint8_t aad[ HOTCALL_SEALED_AAD_SIZE ], const HotSealedBatch* batch )
+{
+    memcpy( aad,     &batch->numSlots, sizeof( batch->numSlots ) );
+    memcpy( aad + 4, &batch->slotSize, sizeof( batch->slotSize ) );
+    memcpy( aad + 8, &batch->sequence, sizeof( batch->sequence ) );
+}
+
+#endif
@@ -0,0 +1,110 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Cross-process hot calls: a channel in a named shared memory segment (App/SharedChannels.h)
+//that a caller in another process posts to. Pointers mean nothing in the other process, so
+//a call carries its payload inside the channel and the responder hands the channel's own
+//payload to the callback. There is no spinlock (an MCS node on the caller's stack, or a lock
+//held by a process that died, would hang the responder): one caller owns a channel and the
+//state word moves IDLE->POSTED and DONE->IDLE on the caller side, POSTED->DONE on the responder
+//side, with atomics that work across processes. The payload is untrusted memory that the
+//caller can keep writing; a trusted callback must copy what it checks.
+
+#ifndef __HOT_CALLS_SHARED_H
+#define __HOT_CALLS_SHARED_H
+
+#include "hot_calls.h"
+
+#define HOTCALL_SHARED_IDLE             0
+#define HOTCALL_SHARED_POSTED           1
+#define HOTCALL_SHARED_DONE             2
+
+#define HOTCALL_SHARED_PAYLOAD_SIZE     4032    //The channel is one 4KB page
+
+typedef struct {
+    uint32_t        state;
+    uint16_t        callID;
+    bool            keepPolling;        //Cleared by the owner to stop the responder
+    uint32_t        payloadSize;
+    uint32_t        callerPid;          //0 while no caller is attached
+    uint64_t        callerStartTime;    //0 while a caller is attaching, see SharedChannels_claim
+    uint64_t        numServed;
+    uint8_t         payload[ HOTCALL_SHARED_PAYLOAD_SIZE ] __attribute__((aligned(64)));
+} __attribute__((aligned(64))) HotSharedChannel;
+
+static inline void HotSharedChannel_init( HotSharedChannel* channel )
+{
+    channel->state           = HOTCALL_SHARED_IDLE;
+    channel->callID          = 0;
+    channel->keepPolling     = true;
+    channel->payloadSize     = 0;
+    channel->callerPid       = 0;
+    channel->callerStartTime = 0;
+    channel->numServed       = 0;
+}
+
+//Caller side: the payload must be written before posting. False if a call is outstanding.
+static inline bool HotSharedChannel_post( HotSharedChannel* channel, uint16_t callID, uint32_t payloadSize )
+{
+    if( __atomic_load_n( &channel->state, __ATOMIC_ACQUIRE ) != HOTCALL_SHARED_IDLE )
+        return false;
+
+    channel->callID      = callID;
+    channel->payloadSize = payloadSize;
+    __atomic_store_n( &channel->state, HOTCALL_SHARED_POSTED, __ATOMIC_RELEASE );
+    return true;
+}
+
+//Caller side: true once the posted call completed; the channel is then idle again
+static inline bool HotSharedChannel_poll( HotSharedChannel* channel )
+{
+    if( __atomic_load_n( &channel->state, __ATOMIC_ACQUIRE ) != HOTCALL_SHARED_DONE )
+        return false;
+
+    __atomic_store_n( &channel->state, HOTCALL_SHARED_IDLE, __ATOMIC_RELEASE );
+    return true;
+}
+
+//Responder side. Batches carry pointers, so HOTCALL_BATCH_CALL_ID and unknown callIDs are
+//completed without running anything.
+static inline void HotSharedChannel_waitForCalls( HotSharedChannel* channel, HotCallTable* callTable )
+{
+    int i;
+
+    while( __atomic_load_n( &channel->keepPolling, __ATOMIC_RELAXED ) ) {
+        if( __atomic_load_n( &channel->state, __ATOMIC_ACQUIRE ) != HOTCALL_SHARED_POSTED ) {
+            for( i = 0; i<3; ++i)
+                _mm_pause();
+            continue;
+        }
+
+        uint16_t callID = channel->callID;
+        if( callID < callTable->numEntries )
+            callTable->callbacks[ callID ]( channel->payload );
+
+        channel->numServed++;
+        __atomic_store_n( &channel->state, HOTCALL_SHARED_DONE, __ATOMIC_RELEASE );
+    }
+}
+
+static inline void HotSharedChannel_stop( HotSharedChannel* channel )
+{
+    __atomic_store_n( &channel->keepPolling, false, __ATOMIC_RELEASE );
+}
+
+#endif
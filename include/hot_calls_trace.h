@@ -0,0 +1,57 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Request tracing. Built with HOTCALL_TRACE (make HOTCALL_TRACE=1, app side only: an SGX1
+//enclave cannot read the TSC), every hot call request records its TSC, callID, payload size
+//and thread while tracing is on. HotCall_requestCallSized passes the payload size, all other
+//requests record 0. When tracing is off a request pays one load and a not-taken branch.
+//The recorder and the trace file are in App/HotCallTrace.h.
+
+#ifndef __HOT_CALLS_TRACE_H
+#define __HOT_CALLS_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+typedef struct {
+    uint64_t        tsc;
+    uint16_t        callID;
+    uint16_t        thread;             //Numbered in the order threads first made a request
+    uint32_t        payloadSize;
+} HotCallTraceRecord;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool hotCallTraceEnabled;
+void HotCallTrace_record( uint16_t callID, uint32_t payloadSize );
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void HotCallTrace_request( uint16_t callID, uint32_t payloadSize )
+{
+    if( __builtin_expect( __atomic_load_n( &hotCallTraceEnabled, __ATOMIC_RELAXED ), 0 ) )
+        HotCallTrace_record( callID, payloadSize );
+}
+
+#endif
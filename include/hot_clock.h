@@ -0,0 +1,111 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Clock page: an untrusted publisher thread (App/ClockPublisher.h) keeps writing the TSC
+//and a monotonic time in ns into shared memory, under a seqlock. Code that cannot run
+//RDTSC(P) itself, like an SGX1 enclave, reads it with HotClock_read.
+//The page is untrusted: a hostile publisher can report any time it likes. The staleness
+//bound only protects against a publisher that stopped or was descheduled.
+
+#ifndef __HOT_CLOCK_H
+#define __HOT_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define HOTCLOCK_OK                 0
+#define HOTCLOCK_ERROR_STOPPED      1   //No publisher is running
+#define HOTCLOCK_ERROR_STALE        2   //The publisher did not update within the wait bound
+#define HOTCLOCK_ERROR_TORN         3   //Could not get a consistent snapshot
+
+#define HOTCLOCK_DEFAULT_WAIT_SPINS 100000
+#define HOTCLOCK_MAX_READ_RETRIES   1000
+
+//One cache line, written by the publisher only
+typedef struct {
+    uint32_t        sequence;           //Odd while an update is in progress
+    bool            publisherRunning;
+    uint64_t        tsc;
+    uint64_t        ns;
+} __attribute__((aligned(64))) HotClockPage;
+
+typedef struct {
+    uint64_t        tsc;
+    uint64_t        ns;
+    uint32_t        sequence;
+} HotClockSample;
+
+static inline void HotClock_pause( void )
+{
+    __asm__ __volatile__( "pause" ::: "memory" );
+}
+
+//One attempt at a consistent snapshot; fails while an update is in progress
+static inline bool HotClock_trySnapshot( const HotClockPage* page, HotClockSample* sample )
+{
+    uint32_t before = __atomic_load_n( &page->sequence, __ATOMIC_ACQUIRE );
+    if( before & 1 )
+        return false;
+
+    sample->tsc      = __atomic_load_n( &page->tsc, __ATOMIC_RELAXED );
+    sample->ns       = __atomic_load_n( &page->ns,  __ATOMIC_RELAXED );
+    sample->sequence = before;
+
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return __atomic_load_n( &page->sequence, __ATOMIC_RELAXED ) == before;
+}
+
+//Reads the clock.
+//maxWaitSpins == 0: returns the latest published sample. While the publisher runs it is at
+//  most one publisher period old. HOTCLOCK_ERROR_TORN if no consistent snapshot was taken
+//  in HOTCLOCK_MAX_READ_RETRIES attempts.
+//maxWaitSpins > 0: waits for an update that started after this call, so the sample is never
+//  older than the call itself. Gives up with HOTCLOCK_ERROR_STALE after maxWaitSpins pauses,
+//  including a publisher stalled in the middle of an update.
+static inline int HotClock_read( const HotClockPage* page, uint32_t maxWaitSpins, HotClockSample* sample )
+{
+    uint32_t spins;
+
+    if( ! __atomic_load_n( &page->publisherRunning, __ATOMIC_ACQUIRE ) )
+        return HOTCLOCK_ERROR_STOPPED;
+
+    if( maxWaitSpins == 0 ) {
+        for( spins = 0; spins < HOTCLOCK_MAX_READ_RETRIES; ++spins ) {
+            if( HotClock_trySnapshot( page, sample ) )
+                return HOTCLOCK_OK;
+            HotClock_pause();
+        }
+        return HOTCLOCK_ERROR_TORN;
+    }
+
+    //An update in progress at entry may hold values from before it; wait for the one after
+    uint32_t entry    = __atomic_load_n( &page->sequence, __ATOMIC_ACQUIRE );
+    uint32_t required = ( entry & 1 ) ? entry + 3 : entry + 2;
+    for( spins = 0; spins < maxWaitSpins; ++spins ) {
+        if( HotClock_trySnapshot( page, sample ) && (int32_t)( sample->sequence - required ) >= 0 )
+            return HOTCLOCK_OK;
+
+        HotClock_pause();
+    }
+
+    return HOTCLOCK_ERROR_STALE;
+}
+
+#endif
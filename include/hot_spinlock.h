@@ -0,0 +1,173 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Spinlocks for the HotCall protocol, usable both in the app and in the enclave
+//(plain C with GCC atomic builtins, no SDK or libc dependency).
+//
+//  TTAS   - test-and-test-and-set, the same algorithm as the SDK's sgx_spin_lock.
+//           Cheapest when uncontended, unfair, and every release wakes all waiters.
+//  TICKET - FIFO. Waiters still spin on one shared line.
+//  MCS    - FIFO queue lock. Every waiter spins on its own node, so a release
+//           touches only the next waiter's cache line.
+//
+//The protocol uses HotSpinlock, chosen at build time with HOTCALL_LOCK_TTAS (default) or
+//HOTCALL_LOCK_TICKET. Both sides of a channel must agree.
+//All locks take a HotSpinNode, which must stay alive from lock to unlock; only MCS uses it.
+//MCS cannot be the protocol lock: the enclave would publish the address of a node on its
+//stack in untrusted memory, and the app cannot write that node to hand the lock over.
+
+#ifndef __HOT_SPINLOCK_H
+#define __HOT_SPINLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+static inline void HotSpin_pause(void) __attribute__((always_inline));
+static inline void HotSpin_pause(void)
+{
+    __asm __volatile(
+        "pause"
+    );
+}
+
+typedef struct HotSpinNode {
+    struct HotSpinNode* volatile    next;
+    volatile uint32_t               locked;
+} HotSpinNode;
+
+// ---------- TTAS ----------
+
+typedef struct {
+    volatile uint32_t locked;
+} HotSpinTTAS;
+
+#define HOTSPIN_TTAS_INITIALIZER    { 0 }
+
+static inline void HotSpinTTAS_lock( HotSpinTTAS* lock, HotSpinNode* node )
+{
+    (void)node;
+    while( __atomic_exchange_n( &lock->locked, 1, __ATOMIC_ACQUIRE ) != 0 ) {
+        while( __atomic_load_n( &lock->locked, __ATOMIC_RELAXED ) != 0 )
+            HotSpin_pause();
+    }
+}
+
+static inline void HotSpinTTAS_unlock( HotSpinTTAS* lock, HotSpinNode* node )
+{
+    (void)node;
+    __atomic_store_n( &lock->locked, 0, __ATOMIC_RELEASE );
+}
+
+// ---------- Ticket ----------
+
+typedef struct {
+    volatile uint32_t next;
+    volatile uint32_t owner;
+} HotSpinTicket;
+
+#define HOTSPIN_TICKET_INITIALIZER  { 0, 0 }
+
+static inline void HotSpinTicket_lock( HotSpinTicket* lock, HotSpinNode* node )
+{
+    (void)node;
+    uint32_t ticket = __atomic_fetch_add( &lock->next, 1, __ATOMIC_RELAXED );
+    uint32_t owner;
+    while( ( owner = __atomic_load_n( &lock->owner, __ATOMIC_ACQUIRE ) ) != ticket ) {
+        //Back off in proportion to the place in line, to keep the owner's line quieter
+        uint32_t waitersAhead = ticket - owner;
+        while( waitersAhead-- > 0 )
+            HotSpin_pause();
+    }
+}
+
+static inline void HotSpinTicket_unlock( HotSpinTicket* lock, HotSpinNode* node )
+{
+    (void)node;
+    //Only the holder writes owner
+    __atomic_store_n( &lock->owner, lock->owner + 1, __ATOMIC_RELEASE );
+}
+
+// ---------- MCS ----------
+
+typedef struct {
+    HotSpinNode* volatile tail;
+} HotSpinMCS;
+
+#define HOTSPIN_MCS_INITIALIZER     { NULL }
+
+static inline void HotSpinMCS_lock( HotSpinMCS* lock, HotSpinNode* node )
+{
+    node->next   = NULL;
+    node->locked = 1;
+
+    HotSpinNode* predecessor = __atomic_exchange_n( &lock->tail, node, __ATOMIC_ACQ_REL );
+    if( predecessor == NULL )
+        return;
+
+    __atomic_store_n( &predecessor->next, node, __ATOMIC_RELEASE );
+    while( __atomic_load_n( &node->locked, __ATOMIC_ACQUIRE ) != 0 )
+        HotSpin_pause();
+}
+
+static inline void HotSpinMCS_unlock( HotSpinMCS* lock, HotSpinNode* node )
+{
+    HotSpinNode* successor = __atomic_load_n( &node->next, __ATOMIC_ACQUIRE );
+    if( successor == NULL ) {
+        HotSpinNode* expected = node;
+        if( __atomic_compare_exchange_n( &lock->tail, &expected, NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) )
+            return;
+
+        //A new waiter swapped itself in but has not linked to us yet
+        while( ( successor = __atomic_load_n( &node->next, __ATOMIC_ACQUIRE ) ) == NULL )
+            HotSpin_pause();
+    }
+
+    __atomic_store_n( &successor->locked, 0, __ATOMIC_RELEASE );
+}
+
+// ---------- Lock used by the HotCall protocol ----------
+
+#if defined( HOTCALL_LOCK_TICKET )
+
+typedef HotSpinTicket HotSpinlock;
+#define HOTSPIN_INITIALIZER     HOTSPIN_TICKET_INITIALIZER
+#define HOTSPIN_LOCK_NAME       "ticket"
+#define HotSpin_lock            HotSpinTicket_lock
+#define HotSpin_unlock          HotSpinTicket_unlock
+
+#elif defined( HOTCALL_LOCK_MCS )
+
+#error "MCS cannot be the HotCall protocol lock: its queue nodes would live in enclave memory"
+
+#else
+
+typedef HotSpinTTAS HotSpinlock;
+#define HOTSPIN_INITIALIZER     HOTSPIN_TTAS_INITIALIZER
+#define HOTSPIN_LOCK_NAME       "ttas"
+#define HotSpin_lock            HotSpinTTAS_lock
+#define HotSpin_unlock          HotSpinTTAS_unlock
+
+#endif
+
+static inline void HotSpin_init( HotSpinlock* lock )
+{
+    HotSpinlock initialized = HOTSPIN_INITIALIZER;
+    *lock = initialized;
+}
+
+#endif
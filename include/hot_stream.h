@@ -0,0 +1,195 @@
+// ----------------------------------------
+// HotCalls
+// Copyright 2017 The Regents of the University of Michigan
+// Ofir Weisse, Valeria Bertacco and Todd Austin
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ---------------------------------------------
+
+//Streaming channel: a single-producer single-consumer ring of fixed-size chunks in shared
+//memory. The producer fills chunk i+1 while the consumer processes chunk i; a full ring holds
+//the producer back and an empty one the consumer. The producer closes the stream after its
+//last chunk; a consumer that gives up aborts it, which stops the producer.
+//Either side may be the enclave, so one ring serves each direction.
+//Each end keeps its own copy of the ring layout and its own position (HotStreamEnd), and only
+//reads the other end's position from shared memory. An enclave end must still check that the
+//ring lies outside the enclave, and must copy a chunk in before trusting what it reads.
+
+#ifndef __HOT_STREAM_H
+#define __HOT_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define HOTSTREAM_MAX_CHUNKS    64
+
+#define HOTSTREAM_OK            0
+#define HOTSTREAM_EMPTY         1   //No chunk yet, try again
+#define HOTSTREAM_FULL          2   //Every chunk is waiting for the consumer, try again
+#define HOTSTREAM_END           3   //Closed, and every chunk was consumed
+
+typedef struct {
+    uint32_t        length;             //Bytes used in the chunk, set before it is published
+} __attribute__((aligned(64))) HotStreamSlot;
+
+typedef struct {
+    uint64_t        head                __attribute__((aligned(64)));   //Chunks published, written by the producer
+    bool            closed;                                             //No chunk follows head
+    uint64_t        tail                __attribute__((aligned(64)));   //Chunks released, written by the consumer
+    bool            aborted;                                            //The consumer stopped, no chunk is released any more
+    uint8_t*        chunks              __attribute__((aligned(64)));
+    uint32_t        numChunks;          //A power of two, at most HOTSTREAM_MAX_CHUNKS
+    uint32_t        chunkSize;
+    HotStreamSlot   slots[ HOTSTREAM_MAX_CHUNKS ];
+} HotStream;
+
+typedef struct {
+    HotStream*      stream;
+    uint8_t*        chunks;
+    uint32_t        numChunks;
+    uint32_t        chunkSize;
+    uint64_t        position;           //Next chunk this end produces or consumes
+} HotStreamEnd;
+
+static inline void HotStream_pause( void )
+{
+    __asm__ __volatile__( "pause" ::: "memory" );
+}
+
+static inline bool HotStream_validLayout( uint32_t numChunks, uint32_t chunkSize )
+{
+    return numChunks > 0 && numChunks <= HOTSTREAM_MAX_CHUNKS && ( numChunks & ( numChunks - 1 ) ) == 0 &&
+           chunkSize > 0;
+}
+
+//chunks holds numChunks * chunkSize bytes. Returns false for an invalid layout.
+static inline bool HotStream_init( HotStream* stream, uint8_t* chunks, uint32_t numChunks, uint32_t chunkSize )
+{
+    if( ! HotStream_validLayout( numChunks, chunkSize ) )
+        return false;
+
+    stream->head      = 0;
+    stream->closed    = false;
+    stream->tail      = 0;
+    stream->aborted   = false;
+    stream->chunks    = chunks;
+    stream->numChunks = numChunks;
+    stream->chunkSize = chunkSize;
+    return true;
+}
+
+//Each end attaches once, before the stream is used; the layout is not read again
+static inline bool HotStreamEnd_attach( HotStreamEnd* end, HotStream* stream )
+{
+    end->stream    = stream;
+    end->chunks    = stream->chunks;
+    end->numChunks = stream->numChunks;
+    end->chunkSize = stream->chunkSize;
+    end->position  = 0;
+    return HotStream_validLayout( end->numChunks, end->chunkSize );
+}
+
+static inline uint8_t* HotStream_chunk( const HotStreamEnd* end, uint64_t position )
+{
+    return end->chunks + (uint64_t)( position & ( end->numChunks - 1 ) ) * end->chunkSize;
+}
+
+// ---------- producer ----------
+
+//The chunk to fill next, or NULL (HOTSTREAM_FULL) while the consumer is a whole ring behind
+static inline uint8_t* HotStream_tryAcquire( HotStreamEnd* producer )
+{
+    uint64_t tail = __atomic_load_n( &producer->stream->tail, __ATOMIC_ACQUIRE );
+    if( producer->position - tail >= producer->numChunks )
+        return NULL;
+
+    return HotStream_chunk( producer, producer->position );
+}
+
+//The chunk to fill next, or NULL once the consumer aborted the stream
+static inline uint8_t* HotStream_acquire( HotStreamEnd* producer )
+{
+    uint8_t* chunk;
+    while( ( chunk = HotStream_tryAcquire( producer ) ) == NULL ) {
+        if( __atomic_load_n( &producer->stream->aborted, __ATOMIC_ACQUIRE ) )
+            return NULL;
+        HotStream_pause();
+    }
+
+    return chunk;
+}
+
+//Hands the acquired chunk, with length bytes filled, to the consumer
+static inline void HotStream_publish( HotStreamEnd* producer, uint32_t length )
+{
+    HotStream* stream = producer->stream;
+    stream->slots[ producer->position & ( producer->numChunks - 1 ) ].length = length;
+    producer->position++;
+    __atomic_store_n( &stream->head, producer->position, __ATOMIC_RELEASE );
+}
+
+//End of stream: the consumer gets HOTSTREAM_END once it consumed every published chunk
+static inline void HotStream_close( HotStreamEnd* producer )
+{
+    __atomic_store_n( &producer->stream->closed, true, __ATOMIC_RELEASE );
+}
+
+// ---------- consumer ----------
+
+//HOTSTREAM_OK with the next chunk and its length (never more than chunkSize), HOTSTREAM_EMPTY
+//or HOTSTREAM_END. The chunk stays valid until HotStream_release.
+static inline int HotStream_tryNext( HotStreamEnd* consumer, const uint8_t** chunk, uint32_t* length )
+{
+    HotStream* stream = consumer->stream;
+    uint64_t   head   = __atomic_load_n( &stream->head, __ATOMIC_ACQUIRE );
+    if( head == consumer->position ) {
+        //closed is set after the last head, so head is final once closed is seen
+        if( ! __atomic_load_n( &stream->closed, __ATOMIC_ACQUIRE ) )
+            return HOTSTREAM_EMPTY;
+        head = __atomic_load_n( &stream->head, __ATOMIC_ACQUIRE );
+        if( head == consumer->position )
+            return HOTSTREAM_END;
+    }
+
+    uint32_t slotLength = stream->slots[ consumer->position & ( consumer->numChunks - 1 ) ].length;
+    *length = slotLength < consumer->chunkSize ? slotLength : consumer->chunkSize;
+    *chunk  = HotStream_chunk( consumer, consumer->position );
+    return HOTSTREAM_OK;
+}
+
+//HOTSTREAM_OK or HOTSTREAM_END
+static inline int HotStream_next( HotStreamEnd* consumer, const uint8_t** chunk, uint32_t* length )
+{
+    int ret;
+    while( ( ret = HotStream_tryNext( consumer, chunk, length ) ) == HOTSTREAM_EMPTY )
+        HotStream_pause();
+
+    return ret;
+}
+
+//Gives the chunk returned by HotStream_next back to the producer
+static inline void HotStream_release( HotStreamEnd* consumer )
+{
+    consumer->position++;
+    __atomic_store_n( &consumer->stream->tail, consumer->position, __ATOMIC_RELEASE );
+}
+
+//The consumer stops: a producer waiting for a chunk gets NULL from HotStream_acquire
+static inline void HotStream_abort( HotStreamEnd* consumer )
+{
+    __atomic_store_n( &consumer->stream->aborted, true, __ATOMIC_RELEASE );
+}
+
+#endif